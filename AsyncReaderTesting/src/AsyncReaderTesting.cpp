@@ -0,0 +1,152 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "io/AsyncFileReader.h"
+
+/*
+* Tests AsyncFileReader with random positional reads against a generated file.
+* Built once for each backend by the Linux build (see CMakeLists.txt). The first
+* argument names the backend the build must use. A build with ATLAN_IO_URING
+* exits with 77 (skipped) if the kernel can't create a ring and it fell back to threads
+*/
+
+const int SKIPPED = 77;
+
+struct readtest_t {
+	int queuedepth;
+	int readcount;
+	size_t maxlength;
+	unsigned seed;
+};
+
+// Byte at each offset of the test file. Cheap to verify without keeping a copy
+char ExpectedByte(uint64_t offset)
+{
+	return static_cast<char>((offset * 2654435761u) >> 13);
+}
+
+bool WriteTestFile(const std::filesystem::path& path, size_t length)
+{
+	std::vector<char> data(length);
+	for(size_t i = 0; i < length; i++)
+		data[i] = ExpectedByte(i);
+
+	std::ofstream writer(path, std::ios_base::binary);
+	writer.write(data.data(), data.size());
+	writer.close();
+	return !writer.fail();
+}
+
+// Returns the number of reads that returned the wrong data or status
+int RunTest(const readtest_t& test, const std::filesystem::path& path, size_t filelength, const std::string& backend)
+{
+	std::mt19937_64 rng(test.seed);
+	AsyncFileReader reader(test.queuedepth);
+	if (!reader.Open(path)) {
+		std::cout << "Could not open " << path << "\n";
+		return 1;
+	}
+	const std::string used = reader.Backend();
+	if (used != backend) {
+		std::cout << "Expected the " << backend << " backend, got " << used << "\n";
+		return 1;
+	}
+
+	// Far more reads than the queue holds are submitted up front, some crossing the end of the file
+	std::vector<AsyncFileReader::request_t> requests;
+	for (int i = 0; i < test.readcount; i++) {
+		AsyncFileReader::request_t r;
+		r.length = 1 + rng() % test.maxlength;
+		r.offset = rng() % (filelength + test.maxlength / 2);
+		r.userdata = static_cast<uint64_t>(i);
+		requests.push_back(r);
+	}
+
+	int failures = 0, completions = 0, pastend = 0;
+	std::vector<bool> seen(requests.size(), false);
+	for(const AsyncFileReader::request_t& r : requests)
+		reader.Submit(r);
+
+	AsyncFileReader::completion_t c;
+	while (reader.Wait(c)) {
+		completions++;
+		const AsyncFileReader::request_t& r = requests[c.userdata];
+		const bool inbounds = r.offset + r.length <= filelength;
+		if(!inbounds)
+			pastend++;
+
+		bool okay = !seen[c.userdata] && c.okay == inbounds && c.length == r.length && c.capacity >= r.length;
+		seen[c.userdata] = true;
+		for (size_t k = 0; okay && inbounds && k < r.length; k++)
+			okay = c.buffer[k] == ExpectedByte(r.offset + k);
+
+		if(!okay)
+			failures++;
+		reader.Release(c);
+	}
+	if(completions != test.readcount)
+		failures++;
+
+	// Closing with reads in flight must not leak or crash
+	for(size_t i = 0; i < requests.size() / 2; i++)
+		reader.Submit(requests[i]);
+	reader.Close();
+	if(reader.InFlight() != 0 || std::string(reader.Backend()) != "none")
+		failures++;
+
+	std::cout << used << " depth " << test.queuedepth << ", seed " << test.seed << ": " << completions << " reads, "
+		<< pastend << " past the end, " << failures << " failures\n";
+	return failures;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		std::cout << "Usage: AsyncReaderTesting <io_uring | thread pool>\n";
+		return 1;
+	}
+	const std::string backend = argv[1];
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / ("atlan_asyncread_" + std::to_string(std::random_device()()) + ".bin");
+	const size_t FILE_LENGTH = 24 * 1024 * 1024;
+
+	if (!WriteTestFile(path, FILE_LENGTH)) {
+		std::cout << "Could not write " << path << "\n";
+		return 1;
+	}
+
+	{
+		AsyncFileReader probe;
+		probe.Open(path);
+		if (backend == "io_uring" && std::string(probe.Backend()) == "thread pool") {
+			std::cout << "SKIPPED: The kernel can't create an io_uring\n";
+			probe.Close();
+			std::filesystem::remove(path);
+			return SKIPPED;
+		}
+	}
+
+	std::vector<readtest_t> tests;
+	for (unsigned seed = 1; seed <= 3; seed++) {
+		tests.push_back({1, 500, 4096, seed});
+		tests.push_back({8, 2000, 64 * 1024, seed});
+		tests.push_back({AsyncFileReader::DEFAULT_QUEUE_DEPTH, 400, 2 * 1024 * 1024, seed});
+	}
+
+	int failures = 0;
+	for (const readtest_t& test : tests) {
+		if(RunTest(test, path, FILE_LENGTH, backend) != 0)
+			failures++;
+	}
+
+	// A missing file must fail to open
+	AsyncFileReader missing;
+	if(missing.Open(path.string() + ".missing"))
+		failures++;
+
+	std::filesystem::remove(path);
+	std::cout << (failures == 0 ? "PASSED" : "FAILED") << ": " << tests.size() + 1 - failures << " of " << tests.size() + 1 << " tests\n";
+	return failures == 0 ? 0 : 1;
+}
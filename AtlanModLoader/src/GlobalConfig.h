@@ -9,7 +9,8 @@ enum ArgFlags {
 	argflag_nolaunch = 1 << 3,
 	argflag_forceload = 1 << 4,
 	argflag_neverpatch = 1 << 5,
-	argflag_noExitTimer = 1 << 6
+	argflag_noExitTimer = 1 << 6,
+	argflag_watch = 1 << 7
 };
 
 // What version the output resource archive should be
@@ -5,18 +5,24 @@
 #include "archives/StreamDB.h"
 #include "archives/idImage.h"
 #include "atlan/AtlanOodle.h"
-#include "entityslayer/Oodle.h"
+#include "atlan/AtlanCodec.h"
 #include "hash/HashLib.h"
 #include "io/BinaryReader.h"
 #include "io/BinaryWriter.h"
 #include "archives/ResourceStructs.h"
+#include "archives/ResourceCatalog.h"
+#include "archives/ResourceArchiveWriter.h"
+#include "io/BufferedFileWriter.h"
 #include "atlan/AtlanLogger.h"
 #include "ReserialMain.h"
+#include "entityslayer/EntityParser.h"
 #include <set>
 #include <unordered_map>
 #include <iostream>
 #include <fstream>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <cassert>
 
 #ifndef _DEBUG
@@ -24,73 +30,21 @@
 #define assert(OP) (OP)
 #endif
 
-class StringTable {
-	private:
-	std::string blob;
-	std::vector<uint64_t> offsets;
-	std::unordered_map<std::string, uint64_t> offsetmap; // Maps strings to their index in the table / offset list
-
-	public:
-	StringTable() {
-		blob.reserve(100000);
-		offsets.reserve(1000);
-		offsetmap.reserve(1000);
-	}
-
-
-	/*
-	* Returns the offset for a string
-	* Adds the string to the table if it doesn't exist
-	*/
-	uint64_t indexof(const std::string_view s) {
-		const auto iter = offsetmap.find(std::string(s));
-		if (iter == offsetmap.end())
-		{
-			uint64_t index = offsets.size();
-
-			offsets.push_back(blob.size());
-			blob.append(s);
-			blob.push_back('\0');
-			offsetmap.emplace(s, index);
-			return index;
-		}
-		else 
-		{
-			return iter->second;
-		}
-	}
-
-	/*
-	* Copies data over to a string chunk
-	* Once this is called, you can still use this object for locating
-	* offsets but you shouldn't modify it any further
-	*/
-	void finalize(StringChunk& s, uint32_t& finalSize) const {
-		s.numStrings = offsets.size();
-		
-		s.offsets = new uint64_t[offsets.size()];
-		memcpy(s.offsets, offsets.data(), offsets.size() * sizeof(uint64_t));
-		
-		s.dataBlock = new char[blob.size()];
-		memcpy(s.dataBlock, blob.data(), blob.size());
-
-		// String Count + Offset Chunk + String Blob
-		finalSize = static_cast<uint32_t>(sizeof(uint64_t) + s.numStrings * sizeof(uint64_t) + blob.size());
-
-		s.paddingCount = 8 - finalSize % 8;
-		finalSize += static_cast<uint32_t>(s.paddingCount);
-	}
-};
-
 #include <algorithm>
 
-// Build the resources and streamdb archive. 
-// If this returns false something went wrong and we should abort mod loading
-bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES, fspath outarchivepath, fspath outstreamdbpath) {
-	bool HotReloadMode = modfiles.size() == 1 
+// Hot reload archives hold a single unzipped mapentities file, padded so it can be rewritten in place
+bool IsHotReloadBuild(const std::vector<ModFile*>& modfiles) {
+	return modfiles.size() == 1 
 		&& !modfiles[0]->isAtlanCompressed 
 		&& modfiles[0]->parentMod->IsUnzipped 
 		&& modfiles[0]->typeenum == rt_mapentities;
+}
+
+// Build the resources and streamdb archive. 
+// If this returns false something went wrong and we should abort mod loading
+// maskentry receives the new archive's container mask hash
+bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES, fspath outarchivepath, fspath outstreamdbpath, containerMaskEntry_t& maskentry) {
+	bool HotReloadMode = IsHotReloadBuild(modfiles);
 	if (HotReloadMode) {
 		atlog << "Experimental Hot Reload Mode Engaged\n";
 	}
@@ -117,78 +71,30 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 		+ 9 * NUM_IMAGES * sizeof(idStreamDB::entry_t);
 	size_t streamdb_RunningOffset = streamdb_DataOffset + (16 - streamdb_DataOffset % 16);
 
-	ResourceArchive archive;
-	ResourceHeader& h = archive.header;
-	
 	/*
-	* Header Constants
+	* Stage the entries. The header, string table and dependency
+	* layout are computed when the archive is opened
 	*/
-	h.magic[0] = 'I'; h.magic[1] = 'D'; h.magic[2] = 'C'; h.magic[3] = 'L';
-	h.version = g_archiveversion;
-	h.flags = 0;
-	h.numSegments = 1;
-	h.segmentSize = 1099511627775UL;
-	h.metadataHash = 0;
-	h.numSpecialHashes = 0;
-	h.numMetaEntries = 0;
-	h.metaEntriesSize = 0;
-	h.resourceEntriesOffset = sizeof(ResourceHeader) + (g_archiveversion < 13 ? sizeof(ResourceMetaHeader) : 0);
-	h.numResources = static_cast<uint32_t>(modfiles.size());
-	h.stringTableOffset = h.resourceEntriesOffset + h.numResources * sizeof(ResourceEntry);
-	
-	
-	StringTable stable;
-
-	/*
-	* Build String Indices
-	*/
-	{
-		h.numStringIndices = static_cast<uint32_t>(modfiles.size() * 2);
-		archive.stringIndex = new uint64_t[h.numStringIndices];
-
-		uint64_t* ptr = archive.stringIndex;
-		for (const ModFile* f : modfiles) {
-			*ptr = stable.indexof(f->typestring);
-			*(ptr + 1) = stable.indexof(f->assetPath);
-			ptr += 2;
-		}
+	ResourceArchiveWriter ResourceWriter(g_archiveversion);
+	for (const ModFile* f : modfiles) {
+		ResourceWriter.AddEntry(f->typestring, f->assetPath);
+	}
+	if (!ResourceWriter.Open(outarchivepath)) {
+		atlog << "FATAL ERROR: Failed to open " << outarchivepath.string() << " for writing\n";
+		return false;
 	}
 
-	stable.finalize(archive.stringChunk, h.stringTableSize);
-
-	/*
-	* "Build" Dependencies - seems to be unnecessary. Dependencies only used by idStudio?
-	*/
-
-	h.resourceDepsOffset = h.stringTableOffset + h.stringTableSize;
-	h.numDependencies = 0;
-	h.numDepIndices = 0;
-	h.metaEntriesOffset = h.resourceDepsOffset;
-	h.resourceSpecialHashOffset = h.resourceDepsOffset + h.numDependencies * sizeof(ResourceDependency);
-
-	
-	/*
-	* Configure IDCL Size and Data Offset
-	*/
-
-	archive.metaheader.unknown = 0;
-	archive.metaheader.metaOffset = Get_ExpectedMetaOffset(h);
-	uint64_t idclsize = 4 + (archive.metaheader.metaOffset + 4) % 8; // Ensure data offset has an 8 byte alignment
-	h.dataOffset = archive.metaheader.metaOffset + idclsize;
-	assert(h.dataOffset % 8 == 0);
-
-	std::ofstream ResourceWriter(outarchivepath, std::ios_base::binary);
-	std::ofstream StreamDBWriter;
-	if(NUM_IMAGES)
-		StreamDBWriter.open(outstreamdbpath, std::ios_base::binary);
+	BufferedFileWriter StreamDBWriter;
+	if (NUM_IMAGES && !StreamDBWriter.Open(outstreamdbpath)) {
+		atlog << "FATAL ERROR: Failed to open " << outstreamdbpath.string() << " for writing\n";
+		return false;
+	}
 
 	/*
 	* Build the resource entries
 	*/
-	archive.entries = new ResourceEntry[modfiles.size()];
-	uint64_t runningDataOffset = h.dataOffset;
-	for(size_t MODFILE_INDEX = 0; MODFILE_INDEX < modfiles.size(); MODFILE_INDEX++) {
-		ResourceEntry& e = archive.entries[MODFILE_INDEX];
+	for(uint32_t MODFILE_INDEX = 0; MODFILE_INDEX < modfiles.size(); MODFILE_INDEX++) {
+		ResourceEntry& e = ResourceWriter.Entry(MODFILE_INDEX);
 		const ModFile& f = *modfiles[MODFILE_INDEX];
 
 		// Because of just-in-time loading, we can no longer filter out all invalid modfiles
@@ -206,28 +112,6 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 			return false;
 		}
 
-		/*
-		* Set universal values
-		*/
-		e.resourceTypeString = 0;
-		e.nameString = 1;
-		e.descString = -1;
-		e.strings = MODFILE_INDEX * 2;
-		e.specialHashes = 0;
-		e.metaEntries = 0;
-		e.reserved0 = 0;
-		e.reserved2 = 0;
-		e.reservedForVariations = 0;
-		e.numStrings = 2;
-		e.numSources = 0;
-		e.numSpecialHashes = 0;
-		e.numMetaEntries = 0;
-		e.depIndices = 0;
-		e.numDependencies = 0;
-		e.generationTimeStamp = 0;
-		for(int i = 0; i < sizeof(e.padding); i++) 
-			e.padding[i] = 0; // Indeterminant in release builds. Must set = 0 to stabilize hash for hot reloading
-
 		// Executable patcher disables these checksums. 
 		// Plus these are calculated using the uncompressed data - bad if we want to pre-compress mod files
 		// HashLib::ResourceMurmurHash
@@ -253,26 +137,19 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 
 		// Isolate the Hot Reload code path to keep everything else simpler
 		if (HotReloadMode) {
-			size_t HotReloadPadding;
 			e.dataSize = 40000000;
-			if (e.dataSize >= f.dataLength) {
-				HotReloadPadding = e.dataSize - f.dataLength;
-			}
-			else {
+			if (e.dataSize < f.dataLength) {
 				atlog << "ERROR: Hot Reload padding threshold exceeded. Please report this error.\n";
 				e.dataSize = f.dataLength;
-				HotReloadPadding = 0;
 			}
 			e.uncompressedSize = e.dataSize;
 			e.compMode = 0;
-			e.dataOffset = runningDataOffset;
-			ResourceWriter.seekp(e.dataOffset, std::ios_base::beg);
-			ResourceWriter.write((char*)f.dataBuffer, f.dataLength);
-
-			char* paddingbuffer = new char[HotReloadPadding];
-			memset(paddingbuffer, 0, HotReloadPadding);
-			ResourceWriter.write(paddingbuffer, HotReloadPadding);
-			delete[] paddingbuffer;
+
+			// The writer reserves the remaining space with zeros
+			if (!ResourceWriter.WriteData(MODFILE_INDEX, (char*)f.dataBuffer, f.dataLength)) {
+				atlog << "FATAL ERROR: Failed to write resource data\n";
+				return false;
+			}
 			break;
 		}
 
@@ -297,15 +174,10 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 			BufferToWrite = (char*)f.dataBuffer;
 		}
 
-		// TODO: There's a fair bit of padding between each resource data block.
-		// At a minimum, a data block has 8-byte alignment. It's unknown what the implications of ignoring
-		// these practices are
-		e.dataOffset = runningDataOffset;
-		runningDataOffset += e.dataSize;
-		runningDataOffset += 8 - runningDataOffset % 8;
-
-		ResourceWriter.seekp(e.dataOffset, std::ios_base::beg);
-		ResourceWriter.write(BufferToWrite, e.dataSize);
+		if (!ResourceWriter.WriteData(MODFILE_INDEX, BufferToWrite, e.dataSize)) {
+			atlog << "FATAL ERROR: Failed to write resource data\n";
+			return false;
+		}
 
 		// StreamDB Stuff
 		if(f.typeenum != rt_image)
@@ -321,8 +193,8 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 			streamdb_entry.offset16 = (u32)(streamdb_RunningOffset / 16);
 			streamdb_entries.push_back(streamdb_entry);
 
-			StreamDBWriter.seekp(streamdb_RunningOffset, std::ios_base::beg);
-			StreamDBWriter.write(BufferToWrite, streamdb_entry.length);
+			StreamDBWriter.PadTo(streamdb_RunningOffset);
+			StreamDBWriter.Write(BufferToWrite, streamdb_entry.length);
 			
 			assert(streamdb_RunningOffset % 16 == 0);
 			streamdb_RunningOffset += streamdb_entry.length + (16 - streamdb_entry.length % 16);
@@ -331,40 +203,16 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 		assert(BufferToWrite == (char*)f.dataBuffer + f.dataLength);
 	}
 
-	Audit_ResourceArchive(archive);
+	Audit_ResourceArchive(ResourceWriter.GetArchive());
 
 	/*
-	* Write the archive
+	* Write the archive metadata
 	*/
-
-	ResourceWriter.seekp(0, std::ios_base::beg);
-	ResourceWriter.write((char*)&archive.header, sizeof(ResourceHeader));
-
-	if (g_archiveversion < 13) {
-		ResourceWriter.write((char*)&archive.metaheader, sizeof(ResourceMetaHeader));
+	if (!ResourceWriter.Finish()) {
+		atlog << "FATAL ERROR: Failed to write " << outarchivepath.string() << "\n";
+		return false;
 	}
-
-	ResourceWriter.write((char*)archive.entries, sizeof(ResourceEntry) * h.numResources);
-
-	// String Chunk
-	uint64_t blobSize = h.stringTableSize - sizeof(uint64_t) - sizeof(uint64_t) * archive.stringChunk.numStrings - archive.stringChunk.paddingCount;
-	ResourceWriter.write((char*)&archive.stringChunk.numStrings, sizeof(uint64_t));
-	ResourceWriter.write((char*)archive.stringChunk.offsets, archive.stringChunk.numStrings * sizeof(uint64_t));
-	ResourceWriter.write(archive.stringChunk.dataBlock, blobSize);
-	for(uint64_t i = 0; i < archive.stringChunk.paddingCount; i++)
-		ResourceWriter.put('\0');
-
-	// Dependencies
-	ResourceWriter.write((char*)archive.dependencies, h.numDependencies * sizeof(ResourceDependency));
-	ResourceWriter.write((char*)archive.dependencyIndex, h.numDepIndices * sizeof(uint32_t));
-	ResourceWriter.write((char*)archive.stringIndex, h.numStringIndices * sizeof(uint64_t));
-
-	// IDCL
-	ResourceWriter.write("IDCL", 4);
-	for(int i = 0; i < idclsize - 4; i++);
-		ResourceWriter.put('\0');
-
-	ResourceWriter.close();
+	maskentry = ResourceWriter.ContainerMaskEntry();
 
 	/*
 	* Finish writing the StreamDB data
@@ -382,11 +230,14 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 
 	std::sort(streamdb_entries.begin(), streamdb_entries.end());
 
-	StreamDBWriter.seekp(0, std::ios_base::beg);
-	StreamDBWriter.write((char*)&streamdb.header, sizeof(streamdb.header));
-	StreamDBWriter.write((char*)streamdb_entries.data(), streamdb_entries.size() * sizeof(idStreamDB::entry_t));
-	StreamDBWriter.write((char*)&streamdb.prefetchheader, sizeof(streamdb.prefetchheader));
-	StreamDBWriter.close();
+	StreamDBWriter.Seek(0);
+	StreamDBWriter.Write((char*)&streamdb.header, sizeof(streamdb.header));
+	StreamDBWriter.Write((char*)streamdb_entries.data(), streamdb_entries.size() * sizeof(idStreamDB::entry_t));
+	StreamDBWriter.Write((char*)&streamdb.prefetchheader, sizeof(streamdb.prefetchheader));
+	if (!StreamDBWriter.Close()) {
+		atlog << "FATAL ERROR: Failed to write " << outstreamdbpath.string() << "\n";
+		return false;
+	}
 
 	#ifdef _DEBUG
 	idStreamDB audit;
@@ -396,9 +247,127 @@ bool BuildArchive(const std::vector<ModFile*>& modfiles, const size_t NUM_IMAGES
 	return true;
 }
 
+/*
+* With --watch, the loader keeps reloading the hot reload file into the archive after loading.
+* The parser stays alive between reloads, and caches each entity's serialized binary,
+* so a reload only reserializes the entities edited since the last one
+*/
+struct HotReloadState_t {
+	fspath sourcepath;                    // Empty if there's nothing to watch
+	fspath archivepath;
+	size_t archivelength = 0;             // Length of the data last written to the archive
+	std::unique_ptr<EntityParser> parser; // Created by the first reload of a text file
+};
+
+// Rewrites the hot reload entry's data in place. The entry is padded, so the archive's layout never changes
+bool HotReloadWrite(HotReloadState_t& state, const char* data, size_t length) {
+	ResourceArchive archive;
+	if (!Read_ResourceArchive(archive, state.archivepath, RF_StopAfterEntries) || archive.header.numResources != 1) {
+		atlog << "ERROR: Could not read " << state.archivepath.string() << "\n";
+		return false;
+	}
+	const ResourceEntry& e = archive.entries[0];
+	if (length > e.dataSize) {
+		atlog << "ERROR: Hot Reload padding threshold exceeded. Please restart the mod loader.\n";
+		return false;
+	}
+
+	// Zero what's left of the last data, so the padding stays empty
+	std::fstream writer(state.archivepath, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+	writer.seekp(e.dataOffset);
+	writer.write(data, length);
+	if (state.archivelength > length) {
+		std::vector<char> zeros(state.archivelength - length, 0);
+		writer.write(zeros.data(), zeros.size());
+	}
+	writer.close();
+	if (writer.fail()) {
+		atlog << "ERROR: Failed to write " << state.archivepath.string() << "\n";
+		return false;
+	}
+	state.archivelength = length;
+	return true;
+}
+
+// Reads the hot reload file and writes it's serialized data into the archive
+bool HotReload(HotReloadState_t& state) {
+	size_t length = 0;
+	bool compressed = false;
+	std::unique_ptr<char[]> text;
+	try {
+		text = EntityParser::ReadText(state.sourcepath.string(), length, compressed);
+	}
+	catch (std::runtime_error err) {
+		atlog << "ERROR: " << err.what() << "\n";
+		return false;
+	}
+
+	// Serialized files are copied as they are
+	if (Reserializer::IsSerialized(text.get(), length, rt_mapentities))
+		return HotReloadWrite(state, text.get(), length);
+
+	// Unchanged entities keep their nodes and serialized binary through a reload
+	const std::string_view view(text.get(), length);
+	if (state.parser == nullptr) {
+		try {
+			state.parser.reset(new EntityParser(ParsingMode::PERMISSIVE, view, false));
+		}
+		catch (std::runtime_error err) {
+			atlog << "ERROR: Failed to parse " << state.sourcepath.string() << ": " << err.what() << "\n";
+			return false;
+		}
+	}
+	else {
+		ParseResult result = state.parser->Reload(view);
+		if (!result.success) {
+			atlog << "ERROR: Failed to parse " << state.sourcepath.string() << " (Line " << result.errorLineNum << "): " << result.errorMessage << "\n";
+			return false;
+		}
+	}
+
+	BinaryWriter writer(state.archivelength + 10000);
+	int warnings = Reserializer::Serialize(*state.parser, writer, rt_mapentities);
+	if(warnings > 0)
+		atlog << "WARNING: " << warnings << " warnings thrown while serializing " << state.sourcepath.string() << "\n";
+	return HotReloadWrite(state, writer.GetBuffer(), writer.GetFilledSize());
+}
+
+/*
+* Reloads the hot reload file whenever it's saved, until ENTER is pressed.
+* It's reloaded once right away, so the parser and it's cache are ready before the first edit
+*/
+void HotReloadWatch(HotReloadState_t& state) {
+	atlog << "\n\nWatching for Changes:\n----------\n"
+		<< "Reloading " << state.sourcepath.string() << " whenever it's saved. Press ENTER to stop.\n";
+
+	std::error_code code;
+	std::filesystem::file_time_type lastwrite = std::filesystem::last_write_time(state.sourcepath, code);
+	HotReload(state);
+
+	std::atomic<bool> stop = false;
+	std::thread input([&stop]() {
+		getchar();
+		stop = true;
+	});
+
+	while (!stop) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+		std::filesystem::file_time_type writetime = std::filesystem::last_write_time(state.sourcepath, code);
+		if(code || writetime == lastwrite)
+			continue;
+		lastwrite = writetime;
+
+		atlanstamp timer("Hot Reload Time");
+		if(HotReload(state))
+			timer.log();
+	}
+	input.join();
+}
+
 #define MODDED_TIMESTAMP 123456
 
-void RebuildContainerMask(const fspath metapath, const fspath newarchivepath) {
+void RebuildContainerMask(const fspath metapath, const containerMaskEntry_t newentry) {
 	// Read the entire archive into memory
 	BinaryOpener open(metapath.string());
 	assert(open.Okay());
@@ -417,9 +386,6 @@ void RebuildContainerMask(const fspath metapath, const fspath newarchivepath) {
 	assert(e->defaultHash == e->dataCheckSum);
 
 	// TODO: If adding multiple archives, must do this for every archive
-	// Get data we'll be inserting into container mask
-	containerMaskEntry_t newentry = GetContainerMaskHash(newarchivepath);
-
 	// Number of uint64_t's in our bitmask.
 	// Ensure at least 1 just incase having 0 is bad
 	uint32_t bitmasklongs = static_cast<uint32_t>(newentry.numResources / 64 + (newentry.numResources % 64 ? 1 : 0) + 1);
@@ -430,7 +396,7 @@ void RebuildContainerMask(const fspath metapath, const fspath newarchivepath) {
 	// Decompress the Oodle-compressed container mask
 	char* decomp = new char[e->uncompressedSize + extraSize];
 	if (e->compMode == 2) {
-		if (!Oodle::DecompressBuffer(compressed, e->dataSize, decomp, e->uncompressedSize)) {
+		if (!AtlanCodec::Active().Decompress(compressed, e->dataSize, decomp, e->uncompressedSize)) {
 			atlog << "ERROR: FAILED TO DECOMPRESS CONTAINER MASK\n";
 			return;
 		}
@@ -601,7 +567,8 @@ bool CleanupLastLoad(const fspath gamedir)
 	return true;
 }
 
-void InjectorLoadMods(const fspath gamedir, const int argflags) {
+// With --watch, hotreload receives the file to watch if the archive was built for hot reloading
+void InjectorLoadMods(const fspath gamedir, const int argflags, HotReloadState_t& hotreload) {
 	fspath modsdir = gamedir / "mods";
 	fspath basedir = gamedir / "base";
 	fspath outdir = basedir / "modarchives";
@@ -799,42 +766,31 @@ void InjectorLoadMods(const fspath gamedir, const int argflags) {
 	if(find_defaulthashes.size() > 0) {
 		atlog << "Finding streamdb hashes for " << find_defaulthashes.size() << " mod files\n";
 
-		std::vector<std::string> archivelist = PackageMapSpec::GetPrioritizedArchiveList(gamedir, false);
-
-		std::string lookupstring;
-		for (const std::string& archivepath : archivelist) 
-		{
-			ResourceArchive r;
-			Read_ResourceArchive(r, basedir / archivepath, RF_SkipData);
-
-			for (uint32_t i = 0; i < r.header.numResources; i++) {
-
-				const ResourceEntry& e = r.entries[i];
-				const char* typestring, *namestring;
-				Get_EntryStrings(r, e, typestring, namestring);
-				lookupstring = typestring;
-				lookupstring.append(namestring);
-
-				const auto& iter = find_defaulthashes.find(lookupstring);
-				if (iter != find_defaulthashes.end()) {
-					ModFile* f = iter->second;
-					f->defaulthash = e.defaultHash;
-					f->resourceVersion = e.version;
-
-					find_defaulthashes.erase(lookupstring);
-
-					if(find_defaulthashes.empty())
-						goto LABEL_ALL_HASHES_FOUND;
-				}
-				
-			}
-		}
-		LABEL_ALL_HASHES_FOUND:
-		if (find_defaulthashes.empty()) {
-			atlog << "All hashes found\n";
+		// Every lookup fails without a catalog, so the reason is given here instead of as missing hashes
+		ResourceCatalog catalog;
+		if (!catalog.Load(gamedir)) {
+			atlog << "POTENTIALLY FATAL ERROR: Could not build the resource catalog, so no streamdb hashes can be found\n";
 		}
 		else {
-			atlog << "POTENTIALLY FATAL ERROR: Could not find one or more hashes for streamdb files\n";
+			for (auto iter = find_defaulthashes.begin(); iter != find_defaulthashes.end(); ) {
+				ModFile* f = iter->second;
+
+				const ResourceCatalog::entry_t* e = catalog.FindWinner(f->typestring, f->assetPath);
+				if (e) {
+					f->defaulthash = e->defaultHash;
+					f->resourceVersion = e->version;
+					iter = find_defaulthashes.erase(iter);
+				}
+				else {
+					++iter;
+				}
+			}
+			if (find_defaulthashes.empty()) {
+				atlog << "All hashes found\n";
+			}
+			else {
+				atlog << "POTENTIALLY FATAL ERROR: Could not find one or more hashes for streamdb files\n";
+			}
 		}
 	}
 
@@ -846,10 +802,18 @@ void InjectorLoadMods(const fspath gamedir, const int argflags) {
 	if (supermod.size() > 0) {
 		atlog << "\n\nBuilding Archives:\n----------\n";
 
-		bool okay = BuildArchive(supermod, streamdbsupermod.size(), outarchivepath, outstreamdbpath);
+		containerMaskEntry_t maskentry;
+		bool okay = BuildArchive(supermod, streamdbsupermod.size(), outarchivepath, outstreamdbpath, maskentry);
 		if(okay) {
 			PackageMapSpec::InjectCommonArchive(gamedir, outarchivepath, streamdbsupermod.size() > 0);
-			RebuildContainerMask(metapath, outarchivepath);
+			RebuildContainerMask(metapath, maskentry);
+
+			if ((argflags & argflag_watch) && IsHotReloadBuild(supermod)) {
+				const ModFile& f = *supermod[0];
+				hotreload.sourcepath = f.parentMod->folderPath / f.realPath;
+				hotreload.archivepath = outarchivepath;
+				hotreload.archivelength = f.dataLength;
+			}
 		}
 		else {
 			atlog << "Resource Mod Loading aborted due to the above error\n";
@@ -928,6 +892,11 @@ https://github.com/FlavorfulGecko5/EntityAtlan/
 			argflags |= argflag_forceload;
 		}
 
+		else if (arg == "--watch") {
+			atlog << "ARGS: Hot reload files will be reloaded whenever they're saved\n";
+			argflags |= argflag_watch;
+		}
+
 		else if(arg == "--gamedir") { // This is for debug builds
 			if(++i == argc)
 				goto LABEL_EXIT_HELP;
@@ -937,7 +906,7 @@ https://github.com/FlavorfulGecko5/EntityAtlan/
 
 		else {
 			LABEL_EXIT_HELP:
-			atlog << "AtlanModLoader.exe [--verbose] [--notimer] [--nolaunch] [--forceload] [--neverpatch] [--gamedir <Dark Ages Installation Folder>]\n";
+			atlog << "AtlanModLoader.exe [--verbose] [--notimer] [--nolaunch] [--forceload] [--neverpatch] [--watch] [--gamedir <Dark Ages Installation Folder>]\n";
 			return;
 		}
 	}
@@ -1130,7 +1099,8 @@ https://github.com/FlavorfulGecko5/EntityAtlan/
 	/*
 	* Run the mod loader
 	*/
-	InjectorLoadMods(gamedirectory, argflags);
+	HotReloadState_t hotreload;
+	InjectorLoadMods(gamedirectory, argflags, hotreload);
 
 	/*
 	* Finish up
@@ -1139,11 +1109,8 @@ https://github.com/FlavorfulGecko5/EntityAtlan/
 
 	if (argflags & argflag_nolaunch) {
 		atlog << "Game will not launch due to nolaunch argument\n";
-		return;
 	}
-
-	const fspath absdir = std::filesystem::absolute(gamedirectory);
-	if(std::filesystem::exists(gamedirectory / "steam_api64.dll")) {
+	else if(std::filesystem::exists(gamedirectory / "steam_api64.dll")) {
 		atlog << "Launching Game with Steam\n";
 		std::system("start \"\" \"steam://run/3017860//\"");
 	}
@@ -1151,7 +1118,15 @@ https://github.com/FlavorfulGecko5/EntityAtlan/
 		atlog << "Could not determine how to automatically launch your game\n"
 			<< "Please launch it manually.\n";
 	}
-	
+
+	/*
+	* Keep reloading the hot reload file while the game runs
+	*/
+	if (argflags & argflag_watch) {
+		if(hotreload.sourcepath.empty())
+			atlog << "Nothing to watch: --watch needs a single unzipped mapentities file to be loaded\n";
+		else HotReloadWatch(hotreload);
+	}
 }
 
 int main(int argc, char* argv[]) {
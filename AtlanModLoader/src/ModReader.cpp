@@ -236,6 +236,7 @@ void ModReader::ReadLooseModv2(ModDef& moddef, const fspath modsfolder, const fs
 
 	moddef.modName = "[Unzipped] ";
 	moddef.modName.append(modsfolder.stem().string());
+	moddef.folderPath = modsfolder;
 	moddef.IsUnzipped = true;
 	moddef.ActiveZip = false;
 
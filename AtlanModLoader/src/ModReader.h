@@ -27,6 +27,7 @@ struct ModDef {
 	bool IsUnzipped = false; // Is this the global unzipped mod?
 	bool ActiveZip = false; // If true, zip archive is alive
 	std::string modName;
+	fspath folderPath; // Folder of an unzipped mod
 	std::vector<ModFile> modFiles;
 	mz_zip_archive zipfile;
 };
@@ -13,6 +13,7 @@
 #include "io/BinaryWriter.h"
 #include "miniz/miniz.h"
 #include "atlan/AtlanOodle.h"
+#include "atlan/AtlanCompressionCache.h"
 #include "atlan/AtlanModConfig.h"
 #include "archives/idImage.h"
 
@@ -139,6 +140,11 @@ void PackagerMain(const char* OVERRIDE_IMAGE_ENCODER_PATH)
 	if (!Oodle::AtlanOodleInit("."))
 		return;
 
+	// Most repackaging runs only change a few files, so compressed outputs are kept between runs
+	AtlanCompressionCache CompressionCache;
+	if(!CompressionCache.Open("atlan_compression_cache"))
+		atlog << "WARNING: Could not open the compression cache. All files will be compressed\n";
+
 	// Keep init_heap values at zero or the finalized zip file will have some sort of offset error
 	mz_zip_archive zipfile;
 	mz_zip_archive* zptr = &zipfile;
@@ -253,7 +259,7 @@ void PackagerMain(const char* OVERRIDE_IMAGE_ENCODER_PATH)
 				size_t outputlength = 0, outputBufferLength = 0;
 
 				atlog << "Compressing " << zippedName << "\n";
-				if(!Oodle::AtlanCompress(serialized.GetBuffer(), serialized.GetFilledSize(), compbuffer, outputlength, outputBufferLength))
+				if(!Oodle::AtlanCompress(serialized.GetBuffer(), serialized.GetFilledSize(), compbuffer, outputlength, outputBufferLength, &CompressionCache))
 					atlog << "ERROR: Failed to create Atlan Compression File\n";
 
 				assert(Oodle::IsAtlanCompFile(compbuffer, outputlength));
@@ -301,6 +307,7 @@ void PackagerMain(const char* OVERRIDE_IMAGE_ENCODER_PATH)
 				return;
 		}
 
+		ImageEncoder.m_cache = &CompressionCache;
 		ImageJobs.context = &ImageEncoder;
 		ImageJobs.zptr = zptr;
 
@@ -311,6 +318,12 @@ void PackagerMain(const char* OVERRIDE_IMAGE_ENCODER_PATH)
 			threadpool[i].join();
 	}
 
+	if (CompressionCache.IsOpen()) {
+		atlog << "Compression Cache: " << static_cast<int64_t>(CompressionCache.Hits()) << " reused, "
+			<< static_cast<int64_t>(CompressionCache.Misses()) << " compressed\n";
+		CompressionCache.Trim();
+	}
+
 	if(IgnoredFiles) {
 		atlog << "----------\n" << IgnoredFiles << " Files were not valid mod files and ignored\n";
 		atlog << IgnoreLog << "----------\n";
@@ -1,14 +1,19 @@
 #include "entityslayer/EntityParser.h"
 #include "archives/ResourceStructs.h"
+#include "archives/ResourceBatch.h"
+#include "archives/ResourceVFS.h"
+#include "archives/ExtractionManifest.h"
 #include "archives/PackageMapSpec.h"
 #include "archives/SoundArchive.h"
 #include "atlan/AtlanLogger.h"
 #include "atlan/AtlanOodle.h"
 #include "DeserialMain.h"
 #include "io/BinaryReader.h"
+#include "hash/HashLib.h"
 #include <iostream>
 #include <fstream>
 #include <set>
+#include <unordered_map>
 #include <thread>
 #include <mutex>
 #include <cassert>
@@ -27,6 +32,8 @@ struct configdata_t {
 	bool run_soundbank_extractor = false;
 
 	restypeset_t restypes;
+	int read_gap_kb = 256;
+	bool async_reads = true;
 
 	deserialconfig_t dsconfig;
 
@@ -338,6 +345,22 @@ void FixLegacyDeclPath(const fspath& outputdir) {
 	atlog << "Successfully renamed legacy decl dir\n";
 }
 
+// Hashes every setting that changes what the extractor and deserializer write.
+// Outputs produced under different settings can't be reused
+uint64_t OutputSettingsHash(const configdata_t& config) {
+	std::string settings;
+	for (const std::string& restype : config.restypes) {
+		settings.append(restype);
+		settings.push_back('\0');
+	}
+
+	const deserialconfig_t& ds = config.dsconfig;
+	for(bool setting : {ds.deserial_entitydefs, ds.deserial_logicdecls, ds.deserial_mapentities, ds.remove_binaries, ds.include_original, ds.indent})
+		settings.push_back(setting ? '1' : '0');
+
+	return HashLib::FarmHash64(settings.data(), settings.size());
+}
+
 void SoundBankExtractor(const fspath& inputdir, fspath outputdir) {
 
 	using namespace std::filesystem;
@@ -501,6 +524,13 @@ void ExtractorMain() {
 		}
 		atlog << "Found " << config.restypes.size() << " resource types\n";
 
+		if (!root["extractor"]["read_gap_kb"].ValueInt(config.read_gap_kb, 0, 65536)) {
+			atlog << "WARNING: Failed to read config int extractor/read_gap_kb: assuming default\n";
+		}
+		if (!root["extractor"]["async_reads"].ValueBool(config.async_reads)) {
+			atlog << "WARNING: Failed to read config bool extractor/async_reads: assuming default\n";
+		}
+
 		EntNode& audiotypes = root["audio_extractor"]["audio_types"];
 		for (int i = 0; i < audiotypes.getChildCount(); i++) {
 			EntNode& at = *audiotypes.ChildAt(i);
@@ -570,26 +600,35 @@ void ExtractorMain() {
 	if(!Oodle::AtlanOodleInit(config.inputdir))
 		return;
 
+	// Files unchanged since the previous run are neither extracted nor deserialized again
+	ExtractionManifest manifest;
+	manifest.Load(config.outputdir, OutputSettingsHash(config));
+	config.dsconfig.manifest = &manifest;
+
 	if (config.run_extractor) {
 		atlog << "Performing resource extraction\n";
 
 		FixLegacyDeclPath(config.outputdir);
 
-		idclMaskFile containerMask;
-		containerMask.Read(config.inputdir);
-
-		if (containerMask.maskcount == 0) {
-			atlog << "FATAL ERROR: Could not read container.mask\n";
+		// Resolves which copy of each file is extracted, accounting for archive priority and the container mask
+		ResourceVFS vfs;
+		if (!vfs.Build(config.inputdir)) {
+			atlog << "FATAL ERROR: Could not read container.mask or build the resource catalog\n";
 			return;
 		}
+		const ResourceCatalog& catalog = vfs.Catalog();
+		size_t extractedTotal = 0, unchangedTotal = 0, failedTotal = 0;
 
-		const fspath basepath = config.inputdir / "base";
-		std::unordered_map<std::string, bool> extractedFileMap;
-
-		size_t compsize = 24000;
-		size_t decompsize = 24000;
-		char* compbuffer = new char[compsize];
-		char* decompbuffer = new char[decompsize];
+		ResourceBatchDecompressor decompressor;
+		decompressor.SetReadGap(static_cast<uint64_t>(config.read_gap_kb) * 1024);
+		std::vector<uint32_t> batchentries;
+		std::vector<uint32_t> batchcatalog; // Catalog index of each batch entry
+		std::vector<fspath> batchoutputs;
+		struct batchresult_t {
+			EntryDataCode code = EntryDataCode::UNUSED;
+			bool written = false; // True once the output file is fully written
+		};
+		std::vector<batchresult_t> batchresults;
 
 		// Aliasing system for logic object descriptors
 		// Many of their filenames are too long to export verbatim.
@@ -601,64 +640,41 @@ void ExtractorMain() {
 
 		descriptorData.aliases.reserve(500000);
 
-		for(size_t i = 0; i < packages.size(); i++) {
-			fspath respath = basepath / packages[i];
+		// Catalog strings are interned, so each type string has a single offset.
+		// Caching the filter by offset avoids a string lookup per entry
+		std::unordered_map<uint64_t, bool> typefilter;
+
+		for(uint32_t archiveindex = 0; archiveindex < catalog.ArchiveCount(); archiveindex++) {
+			const ResourceCatalog::archive_t& a = catalog.Archive(archiveindex);
+			const fspath respath = catalog.ArchivePath(a);
 			int filecount = 0;
 
 			atlog << "Extracting from " << respath.filename() << "\n";
-			
-			ResourceArchive archive;
-			Read_ResourceArchive(archive, respath.string(), RF_SkipData);
-			std::ifstream archivestream(respath, std::ios_base::binary);
-
-			// A select few resource archives don't have a container mask blob. This is normal
-			const idclMaskFile::entry bitmask = containerMask.FindArchiveMask(respath);
-			const bool hasBitmask = bitmask.size >= archive.header.numResources;
 
-			for(uint32_t entryindex = 0; entryindex < archive.header.numResources; entryindex++) {
-				const ResourceEntry& e = archive.entries[entryindex];
+			batchentries.clear();
+			batchcatalog.clear();
+			batchoutputs.clear();
 
-				const char* typestring, *namestring;
-				Get_EntryStrings(archive, e, typestring, namestring);
+			for(uint32_t catalogindex = a.firstEntry; catalogindex < a.firstEntry + a.numEntries; catalogindex++) {
+				const ResourceCatalog::entry_t& e = catalog.Entry(catalogindex);
+				const char* typestring = catalog.String(e.typeString);
+				const char* namestring = catalog.String(e.nameString);
 
 				// Don't extract files with undesired types
-				if (config.restypes.count(typestring) == 0)
+				const auto& typeiter = typefilter.try_emplace(e.typeString, false);
+				if(typeiter.second)
+					typeiter.first->second = config.restypes.count(typestring) > 0;
+				if (!typeiter.first->second)
 					continue;
 
-				// Only proceed if a higher-priority archive doesn't have this file
-				{
-					std::string setstring = typestring;
-					setstring.push_back('/');
-					setstring.append(namestring);
-
-					const bool isloaded = hasBitmask ? bitmask.IsLoaded(entryindex) : true;
-
-					const auto& tryresult = extractedFileMap.try_emplace(setstring, isloaded);
-					if (!tryresult.second) { // Key already exists in map
-						
-						// Rare Edge Case: The first copy of the file we extracted is disabled by the container mask
-						// But another version in a lower-priority archive is enabled instead.
-						// We re-extract the enabled version of the file under the assumption that it's more accurate.
-						// MONITOR: If all copies of a file are disabled, there's no real way to determine which is the most
-						// "up-to-date" version. Best we can do is go in order of archive priority like we already are.
-						// TODO: investigate using generatedTimeStamps
-						if (isloaded && !tryresult.first->second) {
-							tryresult.first->second = true;
-							#ifdef _DEBUG
-							atlog << "Container Mask: Re-Extracting " << setstring << "\n";
-							#endif
-						}
-						else {
-							continue;
-						}
-
-					}
-					filecount++;
-				}
+				// Only proceed if this is the copy of the file the game loads
+				if(!vfs.IsResolved(catalogindex))
+					continue;
+				filecount++;
 
 				// Make adjustments to the output name string depending on the resource type
 				std::string adjustedNameString;
-				if (strcmp(typestring, "rs_streamfile") == 0) {
+				if (e.resourceType == rt_rs_streamfile) {
 
 					adjustedNameString = namestring;
 
@@ -667,7 +683,7 @@ void ExtractorMain() {
 						typestring = "decls";
 					}
 				}
-				else if (strcmp(typestring, "mapentities") == 0) {
+				else if (e.resourceType == rt_mapentities) {
 					adjustedNameString = namestring;
 					for (char& c : adjustedNameString) {
 						if(c == '/')
@@ -699,30 +715,88 @@ void ExtractorMain() {
 						atlog << "WARNING: Filepath " << output_path << " exceeding safe limit. Unexpected behavior may occur\n";
 				}
 
-
-				// Get the entry data
-				ResourceEntryData_t entrydata = Get_EntryData(e, archivestream, compbuffer, compsize, decompbuffer, decompsize);
-				if (entrydata.returncode != EntryDataCode::OK) {
-					if(entrydata.returncode == EntryDataCode::UNKNOWN_COMPRESSION) {
-						atlog << "ERROR: Unknown compression format " << e.compMode << " on file " << output_path << "\n";
-					}
-					else {
-						atlog << "ERROR: Failure code " << static_cast<int>(entrydata.returncode) << " on file " << output_path << "\n";
-						continue;
-					}
+				// Descriptor aliases must still be generated for skipped files, since they're numbered in order
+				if (manifest.IsCurrent(output_path, e)) {
+					unchangedTotal++;
+					continue;
 				}
 
-				// Write the file
-				std::ofstream outputstream(output_path, std::ios_base::binary);
-				outputstream.write(entrydata.buffer, entrydata.length);
+				batchentries.push_back(e.entryIndex);
+				batchcatalog.push_back(catalogindex);
+				batchoutputs.push_back(output_path);
+			}
+
+			// Archives without any files to extract don't need to be opened
+			if (batchentries.empty()) {
+				atlog << "Extracted 0 files from archive (" << filecount << " unchanged)\n";
+				continue;
+			}
+
+			// Decompress and write the selected files in parallel
+			auto writeoutput = [&](const ResourceBatchItem_t& item) {
+				batchresult_t& result = batchresults[item.batchindex];
+				result.code = item.data.returncode;
+
+				// Unknown compression formats are written out raw
+				if(item.data.returncode != EntryDataCode::OK && item.data.returncode != EntryDataCode::UNKNOWN_COMPRESSION)
+					return;
+
+				std::ofstream outputstream(batchoutputs[item.batchindex], std::ios_base::binary);
+				outputstream.write(item.data.buffer, item.data.length);
 				outputstream.close();
+				result.written = !outputstream.fail();
+			};
+			batchresults.assign(batchentries.size(), batchresult_t());
+
+			ResourceArchive archive;
+			if (!Read_ResourceArchive(archive, respath, config.async_reads ? RF_SkipData : RF_MapFile)) {
+				atlog << "ERROR: Failed to read archive " << respath << "\n";
+				failedTotal += batchentries.size();
+				continue;
+			}
+
+			if(config.async_reads)
+				decompressor.RunStreamed(archive, respath, batchentries, writeoutput);
+			else
+				decompressor.Run(archive, batchentries, writeoutput, false);
+
+			size_t writtencount = 0;
+			for (size_t b = 0; b < batchresults.size(); b++) {
+				// Recorded here, on one thread, rather than in the write callback.
+				// Files that failed to write stay out of the manifest, so the next run retries them
+				const batchresult_t& result = batchresults[b];
+				if (result.written) {
+					manifest.SetExtracted(batchoutputs[b], catalog.Entry(batchcatalog[b]));
+					writtencount++;
+				}
+
+				if (!result.written && (result.code == EntryDataCode::OK || result.code == EntryDataCode::UNKNOWN_COMPRESSION)) {
+					atlog << "ERROR: Failed to write file " << batchoutputs[b] << "\n";
+					continue;
+				}
+
+				if(result.code == EntryDataCode::OK)
+					continue;
+
+				if (result.code == EntryDataCode::UNKNOWN_COMPRESSION) {
+					atlog << "ERROR: Unknown compression format " << archive.entries[batchentries[b]].compMode << " on file " << batchoutputs[b] << "\n";
+				}
+				else {
+					atlog << "ERROR: Failure code " << static_cast<int>(result.code) << " on file " << batchoutputs[b] << "\n";
+				}
 			}
 
-			atlog << "Extracted " << filecount << " files from archive\n";
+			// Only files that were fully written count as extracted
+			const size_t failedcount = batchentries.size() - writtencount;
+			extractedTotal += writtencount;
+			failedTotal += failedcount;
+
+			atlog << "Extracted " << writtencount << " files from archive (" << filecount - batchentries.size() << " unchanged";
+			if(failedcount > 0)
+				atlog << ", " << failedcount << " failed";
+			atlog << ")\n";
 		}
 
-		delete[] compbuffer;
-		delete[] decompbuffer;
 
 		// Write the LogicObjectDescriptor alias file, if it's populated
 		if(descriptorData.total > 0) {
@@ -731,7 +805,13 @@ void ExtractorMain() {
 			descriptorwriter.close();
 		}
 
-		atlog << "Extraction Complete: " << extractedFileMap.size() << " files extracted in total\n";
+		atlog << "Extraction Complete: " << static_cast<int64_t>(extractedTotal) << " files extracted in total, "
+			<< static_cast<int64_t>(unchangedTotal) << " unchanged\n";
+		if(failedTotal > 0)
+			atlog << "ERROR: " << static_cast<int64_t>(failedTotal) << " files failed to extract. See the errors above\n";
+
+		if(!manifest.Save())
+			atlog << "WARNING: Failed to write the extraction manifest\n";
 	}
 	else {
 		atlog << "Skipping resource extraction\n";
@@ -739,6 +819,9 @@ void ExtractorMain() {
 
 	if(config.run_deserializer) {
 		Deserializer::DeserialMain(config.inputdir, config.outputdir, config.dsconfig);
+
+		if(!manifest.Save())
+			atlog << "WARNING: Failed to write the extraction manifest\n";
 	}
 	else {
 		atlog << "Skipping deserialization\n";
@@ -0,0 +1,325 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "atlan/AtlanCodec.h"
+#include "entityslayer/EntityParser.h"
+
+/*
+* Tests the EntityParser's command history. This project defines entityparser_history,
+* since every other project compiles the parser without it.
+*
+* Random edits are made to a parsed file, then randomly undone, redone and cancelled.
+* After every step the tree's text must match the snapshot taken when that state
+* was first reached.
+*
+* Reloads are tested by randomly editing a file's text and reloading it. The tree must
+* match a fresh parse of the text, and untouched entities must keep their cache entries
+*/
+
+#if entityparser_history == 0
+#error EntityParserTesting must be compiled with entityparser_history defined as 1
+#endif
+
+struct historytest_t {
+	ParsingMode mode;
+	size_t maxMemory;     // History budget
+	size_t minCompressed; // Smallest command that may be compressed
+	unsigned seed;
+};
+
+std::string RandomEntity(std::mt19937& rng, int index)
+{
+	std::string s = "entity {\n\tlayers {\n\t\t\"game/layer_" + std::to_string(index) + "\"\n\t}\n"
+		"\tentityDef ent_" + std::to_string(index) + " {\n\tclass = \"idTarget_Relay\";\n\tedit = {\n";
+
+	int listCount = rng() % 4;
+	for (int i = 0; i < listCount; i++)
+		s.append("\t\tlist = {\n\t\t\tnum = 2;\n\t\t\titem[0] = \"a\";\n\t\t\titem[1] = \"b\";\n\t\t}\n");
+	s.append("\t}\n}\n}\n");
+	return s;
+}
+
+std::string RandomFile(std::mt19937& rng, ParsingMode mode)
+{
+	std::string s;
+	if (mode == ParsingMode::JSON) {
+		s = "{";
+		for (int i = 0; i < 60; i++) {
+			if(i > 0)
+				s.push_back(',');
+			s.append("\"k" + std::to_string(i) + "\": {\"a\": 1, \"b\": [1, 2, {\"c\": 3}]}");
+		}
+		s.push_back('}');
+		return s;
+	}
+
+	s = "Version 7\nHierarchyVersion 1\n";
+	for (int i = 0; i < 60; i++)
+		s.append(RandomEntity(rng, i));
+	return s;
+}
+
+// Walks down from the root, stopping at a random depth
+EntNode* RandomNode(std::mt19937& rng, EntNode* node)
+{
+	while (node->getChildCount() > 0 && rng() % 3 != 0)
+		node = node->getChildBuffer()[rng() % node->getChildCount()];
+	return node;
+}
+
+std::string Snapshot(EntityParser& parser)
+{
+	std::string text;
+	parser.getRoot()->generateText(text);
+	return text;
+}
+
+// Makes a random edit. Returns true if the tree was changed
+bool RandomEdit(std::mt19937& rng, EntityParser& parser, bool json, int step)
+{
+	EntNode* root = parser.getRoot();
+	EntNode* node = RandomNode(rng, root);
+	std::string number = std::to_string(step);
+
+	switch (rng() % 4)
+	{
+		case 0: // Rename a value node
+		if(json || node == root || node->getChildCount() > 0)
+			return false;
+		if((node->getFlags() & EntNode::NF_Equals) == 0 || (node->getFlags() & EntNode::NF_Braces) != 0)
+			return false;
+		parser.EditText("edited\"v" + number + "\"", node, 6, false);
+		return true;
+
+		case 1: // Insert a subtree
+		{
+			std::string text;
+			if (json) {
+				// A JSON root holds a single document, so nothing is inserted beside it
+				if(node == root || node->getChildCount() == 0)
+					return false;
+
+				bool isArray = node->getChildCount() > 0 && node->getChildBuffer()[0]->getName().empty();
+				text = isArray ? "{\"deep\": 4}" : "\"ins" + number + "\": {\"deep\": " + number + "}";
+			}
+			else {
+				if(node != root && ((node->getFlags() & EntNode::NF_Braces) == 0 || node->getName() == "layers"))
+					return false;
+				text = "ins" + number + " = { deep = \"n\"; item[5] = 1; }";
+			}
+			int index = rng() % (node->getChildCount() + 1);
+			return parser.EditTree(text, node, index, 0, rng() % 2 == 0, false).success;
+		}
+
+		case 2: // Remove a range of children
+		{
+			if(node->getChildCount() == 0)
+				return false;
+			int index = rng() % node->getChildCount();
+			int count = 1 + rng() % (node->getChildCount() - index);
+			return parser.EditTree("", node, index, count, false, false).success;
+		}
+
+		default: // Move a child
+		if(json || node->getChildCount() < 2)
+			return false;
+		parser.EditPosition(node, rng() % node->getChildCount(), rng() % node->getChildCount(), false);
+		return true;
+	}
+}
+
+// Returns the number of states that didn't match their snapshot
+int RunTest(const historytest_t& test)
+{
+	const bool json = test.mode == ParsingMode::JSON;
+	std::mt19937 rng(test.seed);
+
+	std::string text = RandomFile(rng, test.mode);
+	EntityParser parser(test.mode, text, false, rng() % 2 == 0);
+	parser.SetHistoryBudget(test.maxMemory, test.minCompressed);
+	if(rng() % 2 == 0)
+		parser.BuildSearchIndex();
+
+	std::vector<std::string> states = {Snapshot(parser)};
+	size_t current = 0;
+	int mismatches = 0, undos = 0, redos = 0;
+
+	for (int step = 0; step < 4000; step++) {
+		int action = rng() % 10;
+
+		if (action < 5) {
+			bool edited = false;
+			int editCount = 1 + rng() % 3;
+			for (int i = 0; i < editCount; i++)
+				edited |= RandomEdit(rng, parser, json, step);
+
+			if (rng() % 8 == 0) {
+				parser.CancelGroupCommand();
+				if(Snapshot(parser) != states[current])
+					mismatches++;
+				continue;
+			}
+
+			parser.PushGroupCommand();
+			if(!edited)
+				continue;
+			states.resize(current + 1);
+			states.push_back(Snapshot(parser));
+			current++;
+		}
+		else if (action < 8) {
+			if(!parser.Undo())
+				continue;
+			undos++;
+			if(current == 0 || Snapshot(parser) != states[--current])
+				mismatches++;
+		}
+		else {
+			if (!parser.Redo()) {
+				if(current + 1 != states.size()) // Nothing may block a redo
+					mismatches++;
+				continue;
+			}
+			redos++;
+			if(++current >= states.size() || Snapshot(parser) != states[current])
+				mismatches++;
+		}
+	}
+
+	std::cout << (json ? "JSON" : "Entities") << " seed " << test.seed << ", budget " << test.maxMemory
+		<< ": " << undos << " undos, " << redos << " redos, " << parser.HistoryMemory() << " bytes retained, "
+		<< mismatches << " mismatches\n";
+
+	parser.ClearHistory();
+	if(parser.HistoryMemory() != 0)
+		mismatches++;
+	return mismatches;
+}
+
+std::string JoinEntities(const std::vector<std::string>& entities)
+{
+	std::string s = "Version 7\nHierarchyVersion 1\n";
+	for(const std::string& e : entities)
+		s.append(e);
+	return s;
+}
+
+// Returns the number of reloads that didn't match a fresh parse or lost a cache entry they shouldn't have
+int RunReloadTest(unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<std::string> entities;
+	for (int i = 0; i < 60; i++)
+		entities.push_back(RandomEntity(rng, i));
+
+	// Zero-copy nodes point into the first text, and the reloads' nodes are always copied
+	const std::string original = JoinEntities(entities);
+	EntityParser parser(ParsingMode::PERMISSIVE, original, false, rng() % 2 == 0);
+	int mismatches = 0, lostEntries = 0, step = 0;
+
+	for (; step < 500; step++) {
+		// Every entity is marked, so entries that survive the reload can be counted
+		EntNode* root = parser.getRoot();
+		for(int i = 0; i < root->getChildCount(); i++)
+			parser.GetEntityCache(*root->getChildBuffer()[i]).hasBinary = true;
+
+		int edited = -1;
+		switch (rng() % 4)
+		{
+			case 0: // Edit one entity in place
+			edited = rng() % entities.size();
+			entities[edited] = RandomEntity(rng, 1000 + step);
+			break;
+
+			case 1:
+			entities.insert(entities.begin() + rng() % (entities.size() + 1), RandomEntity(rng, 1000 + step));
+			break;
+
+			case 2:
+			if(entities.size() > 1)
+				entities.erase(entities.begin() + rng() % entities.size());
+			break;
+
+			default:
+			std::swap(entities[rng() % entities.size()], entities[rng() % entities.size()]);
+			break;
+		}
+
+		const std::string before = Snapshot(parser);
+		const std::string text = JoinEntities(entities);
+
+		// Text that can't be parsed leaves the tree alone
+		if (rng() % 8 == 0) {
+			if(parser.Reload(text + "entity {\n").success || Snapshot(parser) != before)
+				mismatches++;
+		}
+
+		if (!parser.Reload(text).success) {
+			mismatches++;
+			continue;
+		}
+		parser.PushGroupCommand();
+
+		EntityParser fresh(ParsingMode::PERMISSIVE, text, false);
+		const std::string after = Snapshot(parser);
+		if(after != Snapshot(fresh))
+			mismatches++;
+
+		// The version lines and every other entity are untouched by an edit in place
+		if (edited >= 0) {
+			int kept = 0;
+			for(int i = 0; i < root->getChildCount(); i++)
+				kept += parser.GetEntityCache(*root->getChildBuffer()[i]).hasBinary;
+			if(kept < root->getChildCount() - 1)
+				lostEntries++;
+		}
+
+		// A reload is undone like any other edit
+		if (rng() % 4 == 0) {
+			if(parser.Undo() && Snapshot(parser) != before)
+				mismatches++;
+			if(!parser.Redo() || Snapshot(parser) != after)
+				mismatches++;
+		}
+	}
+
+	std::cout << "Reload seed " << seed << ": " << step << " reloads, " << lostEntries << " lost cache entries, "
+		<< mismatches << " mismatches\n";
+	return mismatches + lostEntries;
+}
+
+int main()
+{
+	// Oodle may not be installed, and the history only needs a codec that round-trips
+	AtlanCodec::Select(AtlanCodec::CODEC_MINIZ);
+
+	const size_t DEFAULT_BUDGET = 100 * 1024 * 1024;
+	const size_t DEFAULT_COMPRESSED = 1024 * 1024;
+
+	// Small budgets force old groups to be compressed and deleted
+	std::vector<historytest_t> tests;
+	for (unsigned seed = 1; seed <= 4; seed++) {
+		for (ParsingMode mode : {ParsingMode::PERMISSIVE, ParsingMode::JSON}) {
+			tests.push_back({mode, DEFAULT_BUDGET, DEFAULT_COMPRESSED, seed});
+			tests.push_back({mode, 64 * 1024, 256, seed});
+			tests.push_back({mode, 4 * 1024, 0, seed});
+		}
+	}
+
+	const unsigned RELOAD_TESTS = 4;
+
+	int failures = 0;
+	for (const historytest_t& test : tests) {
+		if(RunTest(test) != 0)
+			failures++;
+	}
+	for (unsigned seed = 1; seed <= RELOAD_TESTS; seed++) {
+		if(RunReloadTest(seed) != 0)
+			failures++;
+	}
+
+	const size_t total = tests.size() + RELOAD_TESTS;
+	std::cout << (failures == 0 ? "PASSED" : "FAILED") << ": " << total - failures << " of " << total << " tests\n";
+	return failures == 0 ? 0 : 1;
+}
@@ -149,7 +149,8 @@ int main()
 	/*
 	* This assumes the files were originally deserialized with include_originals = false
 	*/
-	Deserializer::DeserialInit(gamedir, filedir, false);
+	if(!Deserializer::DeserialInit(gamedir, filedir, false))
+		return 1;
 
 	//RunTest(filedir / "entityDef", ".decl", rt_entityDef);
 	//RunTest(filedir / "logicClass", ".decl", rt_logicClass);
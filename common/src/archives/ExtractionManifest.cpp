@@ -0,0 +1,109 @@
+#include "ExtractionManifest.h"
+#include "io/BinaryReader.h"
+#include "io/BinaryWriter.h"
+
+#define MANIFEST_MAGIC 0x4D455441 // "ATEM"
+#define MANIFEST_VERSION 2
+
+fspath ExtractionManifest::DefaultPath(const fspath& outputdir)
+{
+	return outputdir / "atlan_extraction_manifest.bin";
+}
+
+std::string ExtractionManifest::Key(const fspath& path) const
+{
+	return path.lexically_normal().lexically_relative(outputdir).generic_string();
+}
+
+void ExtractionManifest::Load(const fspath& p_outputdir, uint64_t p_settingshash)
+{
+	outputdir = p_outputdir.lexically_normal();
+	settingshash = p_settingshash;
+	records.clear();
+
+	const fspath path = DefaultPath(outputdir);
+	if(!std::filesystem::exists(path))
+		return;
+
+	BinaryOpener opener(path.string());
+	if(!opener.Okay())
+		return;
+	BinaryReader reader = opener.ToReader();
+
+	uint32_t magic = 0, version = 0, count = 0;
+	uint64_t savedhash = 0;
+	if(!reader.ReadLE(magic) || magic != MANIFEST_MAGIC || !reader.ReadLE(version) || version != MANIFEST_VERSION)
+		return;
+	if(!reader.ReadLE(savedhash) || savedhash != settingshash || !reader.ReadLE(count))
+		return;
+
+	records.reserve(count);
+	for (uint32_t i = 0; i < count; i++) {
+		record_t r;
+		const char* key = nullptr, *finalpath = nullptr;
+		bool okay = reader.ReadLE(r.dataCheckSum) && reader.ReadLE(r.generationTimeStamp) && reader.ReadLE(r.dataSize)
+			&& reader.ReadCString(key) && reader.ReadCString(finalpath);
+
+		// A truncated manifest can't be trusted
+		if (!okay) {
+			records.clear();
+			return;
+		}
+		r.finalpath = finalpath;
+		records.emplace(key, r);
+	}
+}
+
+bool ExtractionManifest::Save() const
+{
+	BinaryWriter writer(records.size() * 128 + 64);
+	writer << static_cast<uint32_t>(MANIFEST_MAGIC) << static_cast<uint32_t>(MANIFEST_VERSION) << settingshash << static_cast<uint32_t>(records.size());
+
+	for (const auto& pair : records) {
+		writer << pair.second.dataCheckSum << pair.second.generationTimeStamp << pair.second.dataSize;
+		writer.WriteBytes(pair.first.c_str(), pair.first.size() + 1);
+		writer.WriteBytes(pair.second.finalpath.c_str(), pair.second.finalpath.size() + 1);
+	}
+	return writer.SaveTo(DefaultPath(outputdir).string());
+}
+
+bool ExtractionManifest::IsCurrent(const fspath& extractedpath, const ResourceCatalog::entry_t& e) const
+{
+	// Modded archives don't compute checksums, so those resources can't be fingerprinted
+	if(e.dataCheckSum == UINT64_MAX)
+		return false;
+
+	const auto iter = records.find(Key(extractedpath));
+	if(iter == records.end())
+		return false;
+
+	const record_t& r = iter->second;
+	return r.dataCheckSum == e.dataCheckSum && r.generationTimeStamp == e.generationTimeStamp && r.dataSize == e.dataSize
+		&& std::filesystem::exists(outputdir / r.finalpath);
+}
+
+void ExtractionManifest::SetExtracted(const fspath& extractedpath, const ResourceCatalog::entry_t& e)
+{
+	std::string key = Key(extractedpath);
+	record_t& r = records[key];
+	r.dataCheckSum = e.dataCheckSum;
+	r.generationTimeStamp = e.generationTimeStamp;
+	r.dataSize = e.dataSize;
+	r.finalpath = key;
+}
+
+bool ExtractionManifest::IsDeserialized(const fspath& extractedpath) const
+{
+	const std::string key = Key(extractedpath);
+	const auto iter = records.find(key);
+	if(iter == records.end() || iter->second.finalpath == key)
+		return false;
+	return std::filesystem::exists(outputdir / iter->second.finalpath);
+}
+
+void ExtractionManifest::SetDeserialized(const fspath& extractedpath, const fspath& deserializedpath)
+{
+	const auto iter = records.find(Key(extractedpath));
+	if(iter != records.end())
+		iter->second.finalpath = Key(deserializedpath);
+}
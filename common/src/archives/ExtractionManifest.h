@@ -0,0 +1,58 @@
+#pragma once
+#include "ResourceCatalog.h"
+#include <unordered_map>
+#include <string>
+
+/*
+* Record of what the extractor produced on it's previous runs
+*
+* Each extracted file is keyed by it's path relative to the output folder, and
+* stores the fingerprint of the resource it came from. When the deserializer
+* replaces an extracted file with it's deserialized form, that output becomes
+* the file expected to exist. A resource whose fingerprint is unchanged and
+* whose expected output still exists doesn't need to be extracted again.
+* Outputs are only reused while the settings that shape them are unchanged.
+*/
+class ExtractionManifest {
+	private:
+	struct record_t {
+		uint64_t dataCheckSum = 0;
+		uint64_t generationTimeStamp = 0;
+		uint64_t dataSize = 0;
+		std::string finalpath; // Relative path of the output expected to exist
+	};
+
+	fspath outputdir;
+	uint64_t settingshash = 0;
+	std::unordered_map<std::string, record_t> records;
+
+	std::string Key(const fspath& path) const;
+
+	public:
+
+	// Default location of the manifest within the output folder
+	static fspath DefaultPath(const fspath& outputdir);
+
+	/*
+	* Loads the manifest for an output folder. A missing or outdated manifest
+	* leaves it empty, so every resource is extracted.
+	*
+	* @param p_settingshash Hash of every setting that changes the outputs. If it differs
+	* from the hash the manifest was saved with, the manifest is discarded
+	*/
+	void Load(const fspath& p_outputdir, uint64_t p_settingshash);
+	bool Save() const;
+
+	size_t Count() const {return records.size();}
+
+	// True if the file was extracted from an identical resource and it's final output still exists
+	bool IsCurrent(const fspath& extractedpath, const ResourceCatalog::entry_t& e) const;
+
+	// Records a resource's extraction. It's final output is the extracted file until it's deserialized
+	void SetExtracted(const fspath& extractedpath, const ResourceCatalog::entry_t& e);
+
+	// True if the extracted file has since been deserialized and that output still exists
+	bool IsDeserialized(const fspath& extractedpath) const;
+
+	void SetDeserialized(const fspath& extractedpath, const fspath& deserializedpath);
+};
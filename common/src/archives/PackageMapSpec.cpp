@@ -1,51 +1,354 @@
 #include "PackageMapSpec.h"
-#include "entityslayer\EntityParser.h"
+#include "entityslayer/ParserSimd.h"
 #include <cassert>
+#include <cstring>
+#include <charconv>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
 
 #ifndef _DEBUG
 #undef assert
 #define assert(OP) (OP)
 #endif
 
-void PackageMapSpec::ToString(const fspath gamedir) {
-	EntityParser entparser((gamedir / "base/packagemapspec.json").string(), ParsingMode::JSON);
-	EntNode& jsonroot = *entparser.getRoot()->ChildAt(0);
-	
-	std::vector<std::string_view> filenames;
-	EntNode& filelist = jsonroot["\"files\""];
-	for(int i = 0; i < filelist.getChildCount(); i++) {
-		filenames.push_back(filelist.ChildAt(i)->ChildAt(0)->getValueUQ());
-		//std::cout << filenames.back() << "\n";
+/*
+* STRUCTURAL INDEX
+*
+* The packagemapspec is read without building a node tree. A first pass classifies
+* 64 characters at a time, listing the offset of every structural character,
+* string and scalar that isn't inside a string. The second pass walks those
+* offsets to copy out the three lists we need, and skips everything else.
+*/
+
+using namespace ParserSimd;
+
+// JSON's structural characters
+struct jsonstructural_t {
+	bool Stops(char c) const {
+		return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
 	}
 
-	std::vector<std::string_view> mapnames;
-	EntNode& maplist = jsonroot["\"maps\""];
-	for(int i = 0; i < maplist.getChildCount(); i++) {
-		mapnames.push_back(maplist.ChildAt(i)->ChildAt(0)->getValueUQ());
+	template<typename V> V Stops(V v) const {
+		return Or(Or(Or(Equal(v, '{'), Equal(v, '}')), Or(Equal(v, '['), Equal(v, ']'))), Or(Equal(v, ':'), Equal(v, ',')));
 	}
+};
 
-	std::vector<std::vector<int>> filemapping;
-	filemapping.resize(mapnames.size());
+struct jsonwhitespace_t {
+	bool Stops(char c) const {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	template<typename V> V Stops(V v) const {
+		return Or(Or(Equal(v, ' '), Equal(v, '\t')), Or(Equal(v, '\n'), Equal(v, '\r')));
+	}
+};
+
+// Lists the offsets of every structural character, opening quote and scalar outside of strings
+static bool IndexStructurals(std::string_view text, std::vector<uint32_t>& indices)
+{
+	indices.clear();
+	if(text.length() > UINT32_MAX)
+		return false;
+
+	uint64_t inStringCarry = 0;  // All ones if the previous block ended inside a string
+	uint64_t escapeCarry = 0;    // Set if the previous block ended with an unescaped backslash
+	uint64_t boundaryCarry = 1;  // Set if the previous character was whitespace or structural
+	char padded[64];
+
+	for (size_t blockStart = 0; blockStart < text.length(); blockStart += 64) {
+		const char* block = text.data() + blockStart;
+		if (text.length() - blockStart < 64) {
+			memset(padded, ' ', 64);
+			memcpy(padded, block, text.length() - blockStart);
+			block = padded;
+		}
+
+		// Backslashes are rare, so escapes are resolved one at a time
+		uint64_t quotes = Mask64(block, char_t{'"'});
+		uint64_t backslashes = Mask64(block, char_t{'\\'}) & ~escapeCarry;
+		uint64_t escaped = escapeCarry;
+		escapeCarry = 0;
+		while (backslashes) {
+			uint32_t i = FirstBit64(backslashes);
+			if (i == 63) {
+				escapeCarry = 1;
+				break;
+			}
+			escaped |= 2ULL << i;
+			backslashes &= ~(3ULL << i);
+		}
+		quotes &= ~escaped;
+
+		// A prefix XOR of the quotes covers each string from it's opening quote up to it's closing quote
+		uint64_t inString = quotes;
+		for (int shift = 1; shift < 64; shift <<= 1)
+			inString ^= inString << shift;
+		inString ^= inStringCarry;
+		inStringCarry = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+		uint64_t structurals = Mask64(block, jsonstructural_t()) & ~inString;
+		uint64_t boundaries = structurals | (Mask64(block, jsonwhitespace_t()) & ~inString);
+		uint64_t scalars = ~(boundaries | inString | quotes) & (boundaries << 1 | boundaryCarry);
+		boundaryCarry = boundaries >> 63;
+
+		uint64_t bits = structurals | (quotes & inString) | scalars;
+		while (bits) {
+			indices.push_back(static_cast<uint32_t>(blockStart + FirstBit64(bits)));
+			bits &= bits - 1;
+		}
+	}
+	return inStringCarry == 0;
+}
+
+// Walks a structural index
+struct jsonreader_t {
+	std::string_view text;
+	const std::vector<uint32_t>& indices;
+	size_t next = 0;
+
+	char Peek() const {
+		return next < indices.size() ? text[indices[next]] : '\0';
+	}
 
-	EntNode& mapfilerefs = jsonroot["\"mapFileRefs\""];
-	for(int i = 0; i < mapfilerefs.getChildCount(); i++) {
-		int fileindex = -1, mapindex = -1;
-		mapfilerefs.ChildAt(i)->ChildAt(0)->ValueInt(fileindex, -9999, 9999);
-		mapfilerefs.ChildAt(i)->ChildAt(1)->ValueInt(mapindex, -9999, 9999);
+	size_t Offset() const {
+		return next < indices.size() ? indices[next] : text.length();
+	}
+
+	bool Expect(char c) {
+		if(Peek() != c)
+			return false;
+		next++;
+		return true;
+	}
+
+	// Reads a string's contents, without unescaping them
+	bool String(std::string_view& writeTo) {
+		if(Peek() != '"')
+			return false;
+
+		size_t start = indices[next++] + 1, i = start;
+		while(i < text.length() && text[i] != '"')
+			i += text[i] == '\\' ? 2 : 1;
+		if(i >= text.length())
+			return false;
+
+		writeTo = text.substr(start, i - start);
+		return true;
+	}
+
+	bool Integer(int& writeTo, size_t& length) {
+		const char* first = text.data() + Offset();
+		std::from_chars_result result = std::from_chars(first, text.data() + text.length(), writeTo);
+		if(result.ec != std::errc())
+			return false;
+		length = result.ptr - first;
+		next++;
+		return true;
+	}
+
+	// Skips a value and all of it's contents
+	bool Skip() {
+		int depth = 0;
+		do {
+			char c = Peek();
+			if(c == '\0' || (depth == 0 && (c == ':' || c == ',' || c == '}' || c == ']')))
+				return false;
+			if(c == '{' || c == '[')
+				depth++;
+			else if(c == '}' || c == ']')
+				depth--;
+			next++;
+		} while (depth > 0);
+		return true;
+	}
+
+	// Passes every key to the callback, which must read the key's value
+	template<typename T>
+	bool Object(T& onKey) {
+		if(!Expect('{'))
+			return false;
+		if(Expect('}'))
+			return true;
 
-		assert(fileindex != -1);
-		assert(mapindex != -1);
+		std::string_view key;
+		do {
+			if(!String(key) || !Expect(':') || !onKey(key))
+				return false;
+		} while (Expect(','));
+		return Expect('}');
+	}
+
+	// Calls the callback on every element, which must read the element
+	template<typename T>
+	bool Array(T& onElement) {
+		if(!Expect('['))
+			return false;
+		if(Expect(']'))
+			return true;
 
-		filemapping[mapindex].push_back(fileindex);
+		do {
+			if(!onElement())
+				return false;
+		} while (Expect(','));
+		return Expect(']');
+	}
+};
+
+// Offsets of the text InjectCommonArchive edits
+struct speclayout_t {
+	size_t filesOpen = 0;                            // Opening bracket of the file list
+	size_t refsOpen = 0;                             // Opening bracket of the mapFileRefs list
+	bool foundFiles = false;
+	bool foundRefs = false;
+	std::vector<std::pair<size_t, size_t>> refFiles; // Offset and length of each mapFileRef's file index
+};
+
+static bool ScanSpec(std::string_view text, PackageMapSpec::spec_t& spec, speclayout_t& layout)
+{
+	std::vector<uint32_t> indices;
+	if(!IndexStructurals(text, indices))
+		return false;
+	jsonreader_t reader = {text, indices};
+
+	// Lists of objects, where we only need each object's name
+	auto NameList = [&reader](std::vector<std::string>& names) {
+		auto Element = [&reader, &names]() {
+			names.emplace_back();
+			auto Key = [&reader, &names](std::string_view key) {
+				std::string_view name;
+				if(key != "name")
+					return reader.Skip();
+				if(!reader.String(name))
+					return false;
+				names.back() = name;
+				return true;
+			};
+			return reader.Object(Key);
+		};
+		return reader.Array(Element);
+	};
+
+	auto RefElement = [&reader, &spec, &layout]() {
+		spec.mapFileRefs.push_back({-1, -1});
+		layout.refFiles.push_back({0, 0});
+		auto Key = [&reader, &spec, &layout](std::string_view key) {
+			size_t offset = reader.Offset(), length = 0;
+			if (key == "file") {
+				if(!reader.Integer(spec.mapFileRefs.back().file, length))
+					return false;
+				layout.refFiles.back() = {offset, length};
+				return true;
+			}
+			if(key == "map")
+				return reader.Integer(spec.mapFileRefs.back().map, length);
+			return reader.Skip();
+		};
+		return reader.Object(Key);
+	};
+
+	auto TopKey = [&](std::string_view key) {
+		if (key == "files") {
+			layout.filesOpen = reader.Offset();
+			layout.foundFiles = true;
+			return NameList(spec.files);
+		}
+		if (key == "maps") {
+			return NameList(spec.maps);
+		}
+		if (key == "mapFileRefs") {
+			layout.refsOpen = reader.Offset();
+			layout.foundRefs = true;
+			return reader.Array(RefElement);
+		}
+		return reader.Skip();
+	};
+
+	return reader.Object(TopKey) && reader.Peek() == '\0';
+}
+
+static bool ReadText(const fspath& path, std::string& text)
+{
+	std::ifstream input(path, std::ios_base::binary);
+	if(!input.good())
+		return false;
+
+	input.seekg(0, std::ios_base::end);
+	text.resize(static_cast<size_t>(input.tellg()));
+	input.seekg(0, std::ios_base::beg);
+	input.read(text.data(), text.length());
+	return input.good();
+}
+
+/*
+* SPEC CACHE
+*/
+
+struct cachedspec_t {
+	std::filesystem::file_time_type writeTime;
+	uintmax_t size = 0;
+	std::shared_ptr<const PackageMapSpec::spec_t> spec;
+};
+
+static std::mutex cacheLock;
+static std::unordered_map<std::string, cachedspec_t> specCache; // Keyed by the packagemapspec's path
+
+std::shared_ptr<const PackageMapSpec::spec_t> PackageMapSpec::Read(const fspath gamedir)
+{
+	const fspath pmspath = gamedir / "base/packagemapspec.json";
+
+	std::error_code error;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(pmspath, error);
+	if(error)
+		return nullptr;
+	uintmax_t size = std::filesystem::file_size(pmspath, error);
+	if(error)
+		return nullptr;
+
+	std::lock_guard<std::mutex> guard(cacheLock);
+	cachedspec_t& cached = specCache[pmspath.string()];
+	if(cached.spec && cached.writeTime == writeTime && cached.size == size)
+		return cached.spec;
+
+	std::string text;
+	speclayout_t layout;
+	std::shared_ptr<spec_t> spec = std::make_shared<spec_t>();
+	if (!ReadText(pmspath, text) || !ScanSpec(text, *spec, layout)) {
+		specCache.erase(pmspath.string());
+		return nullptr;
+	}
+
+	cached.writeTime = writeTime;
+	cached.size = size;
+	cached.spec = spec;
+	return spec;
+}
+
+void PackageMapSpec::ToString(const fspath gamedir) {
+	std::shared_ptr<const spec_t> spec = Read(gamedir);
+	if (!spec) {
+		std::cout << "Could not read the packagemapspec\n";
+		return;
+	}
+
+	std::vector<std::vector<int>> filemapping;
+	filemapping.resize(spec->maps.size());
+
+	for(const mapfileref_t& ref : spec->mapFileRefs) {
+		assert(ref.file != -1);
+		assert(ref.map != -1);
+
+		filemapping[ref.map].push_back(ref.file);
 	}
 
 
 	for(size_t i = 0; i < filemapping.size(); i++) {
-		std::cout << "\n" << mapnames[i] << "\n";
+		std::cout << "\n" << spec->maps[i] << "\n";
 
 		for(int fileindex : filemapping[i]) {
-			std::cout << "-" << filenames[fileindex] << "\n";
+			std::cout << "-" << spec->files[fileindex] << "\n";
 		}
 
 	}
@@ -56,8 +359,13 @@ void PackageMapSpec::ToString(const fspath gamedir) {
 void PackageMapSpec::InjectCommonArchive(const fspath gamedir, const fspath newarchivepath, bool includeStreamDB)
 {
 	const fspath pmspath = gamedir / "base/packagemapspec.json";
-	EntityParser entparser(pmspath.string(), ParsingMode::JSON);
-	EntNode& jsonroot = *entparser.getRoot()->ChildAt(0);
+	std::string text;
+	spec_t spec;
+	speclayout_t layout;
+	if(!ReadText(pmspath, text) || !ScanSpec(text, spec, layout))
+		throw std::runtime_error("Could not read the packagemapspec");
+	if(!layout.foundFiles || !layout.foundRefs)
+		throw std::runtime_error("The packagemapspec has no files or mapFileRefs list");
 
 	// Get the relative path appropriate for the packagemapspec
 	size_t substringIndex = pmspath.parent_path().string().size() + 1;
@@ -68,87 +376,116 @@ void PackageMapSpec::InjectCommonArchive(const fspath gamedir, const fspath newa
 	//std::cout << archrelativepath;
 
 	// Ensure first map is the common map
-	assert(jsonroot["\"maps\""].ChildAt(0)->ChildAt(0)->getValueUQ() == "common");
+	assert(spec.maps.size() > 0 && spec.maps[0] == "common");
+
+	/*
+	* The new text is spliced into the original, leaving the rest of it's formatting untouched.
+	* New list elements reuse the whitespace before each list's first element
+	*/
+	struct splice_t {
+		size_t offset;
+		size_t removeLength;
+		std::string insert;
+	};
+	std::vector<splice_t> splices;
 
-	char buffer[512];
+	auto InsertElements = [&text, &splices](size_t listOpen, const std::vector<std::string>& elements) {
+		size_t first = listOpen + 1;
+		while(first < text.length() && jsonwhitespace_t().Stops(text[first]))
+			first++;
+		std::string_view separator(text.data() + listOpen + 1, first - listOpen - 1);
+
+		std::string insert;
+		bool emptyList = text[first] == ']';
+		for (size_t i = 0; i < elements.size(); i++) {
+			insert.append(elements[i]);
+			if (!emptyList) {
+				insert.push_back(',');
+				insert.append(separator);
+			}
+			else if (i + 1 < elements.size()) {
+				insert.append(", ");
+			}
+		}
+		splices.push_back({first, 0, insert});
+	};
 
 	// Insert archive into beginning of file list
 	// We must insert it at the beginning since this list dictates patch priority
-	{
-		EntNode& filelist = jsonroot["\"files\""];
-		if (includeStreamDB) {
-			snprintf(buffer, 512, R"({ "name": "%s" })", "modarchives/common_mod.streamdb");
-			entparser.EditTree(buffer, &filelist, 0, 0, 0, 0);
-		}
-		snprintf(buffer, 512, R"({ "name": "%s" })", archrelativepath.c_str());
-		entparser.EditTree(buffer, &filelist, 0, 0, 0, 0);
+	std::vector<std::string> newFiles = {"{ \"name\": \"" + archrelativepath + "\" }"};
+	std::vector<std::string> newRefs = {R"({ "file": 0, "map": 0 })"};
+	if (includeStreamDB) {
+		newFiles.push_back(R"({ "name": "modarchives/common_mod.streamdb" })");
+		newRefs.push_back(R"({ "file": 1, "map": 0 })");
 	}
+	InsertElements(layout.filesOpen, newFiles);
+	InsertElements(layout.refsOpen, newRefs);
 
 	// Now we must increment every file number in the map list to account for the insertion
-	{
-		EntNode& mapfilerefs = jsonroot["\"mapFileRefs\""];
+	for (size_t i = 0; i < layout.refFiles.size(); i++) {
+		assert(spec.mapFileRefs[i].file != -1);
+		if(layout.refFiles[i].second == 0)
+			continue;
 
-		for (int i = 0; i < mapfilerefs.getChildCount(); i++) {
-			EntNode& mapping = *mapfilerefs.ChildAt(i);
-			EntNode& file = mapping["\"file\""];
-			int index = -1;
+		int index = spec.mapFileRefs[i].file + static_cast<int>(newFiles.size());
+		splices.push_back({layout.refFiles[i].first, layout.refFiles[i].second, std::to_string(index)});
+	}
 
-			assert(&file != EntNode::SEARCH_404);
-			assert(file.ValueInt(index, -999999, 999999));
-			index += includeStreamDB ? 2 : 1;
+	std::sort(splices.begin(), splices.end(), [](const splice_t& a, const splice_t& b) {
+		return a.offset < b.offset;
+	});
 
-			std::string newText = "\"file\"";
-			newText.append(std::to_string(index));
-			entparser.EditText(newText, &file, 6, 0); // Note: This is a very hacky function. 6 is length of "file" (including quotes)
-		}
+	std::string output;
+	output.reserve(text.length() + archrelativepath.length() + 128 + layout.refFiles.size());
+	size_t copied = 0;
+	for (const splice_t& s : splices) {
+		output.append(text, copied, s.offset - copied);
+		output.append(s.insert);
+		copied = s.offset + s.removeLength;
+	}
+	output.append(text, copied, std::string::npos);
 
-		// Finally, we insert the new archive into common's mapFileRef
-		if (includeStreamDB) {
-			entparser.EditTree(R"({ "file": 1, "map": 0 })", &mapfilerefs, 0, 0, 0, 0);
-		}
-		entparser.EditTree(R"({ "file": 0, "map": 0 })", &mapfilerefs, 0, 0, 0, 0);
+	bool written;
+	{
+		std::ofstream writer(pmspath, std::ios_base::binary);
+		writer.write(output.data(), output.length());
+		writer.close();
+		written = !writer.fail();
 	}
 
-	entparser.WriteToFile(pmspath.string(), 0);
+	{
+		std::lock_guard<std::mutex> guard(cacheLock);
+		specCache.erase(pmspath.string());
+	}
+	if(!written)
+		throw std::runtime_error("Could not write the packagemapspec");
 }
 
 std::vector<std::string> PackageMapSpec::GetPrioritizedArchiveList(const fspath gamedir, bool IncludeModArchives)
 {
-	fspath pathMapSpec = gamedir / "base/packagemapspec.json";
-	if(!std::filesystem::exists(pathMapSpec))
+	std::shared_ptr<const spec_t> spec = Read(gamedir);
+	if(!spec)
 		return {};
 
 	std::vector<std::string> packages;
-	try {
-		EntityParser parser(pathMapSpec.string(), ParsingMode::JSON);
-
-		EntNode* root = parser.getRoot()->ChildAt(0);
-		EntNode& files = (*root)["\"files\""];
-		packages.reserve(files.getChildCount());
-		// Get all resource archive names and their priorities
-		for (int i = 0; i < files.getChildCount(); i++) {
-			EntNode& name = (*files.ChildAt(i))["\"name\""];
-
-			assert(&name != EntNode::SEARCH_404);
-
-			std::string_view nameString = name.getValueUQ();
-			if (nameString.find("modarchives") != std::string::npos) {
-				if(!IncludeModArchives)
-					continue;
-			}
+	packages.reserve(spec->files.size());
 
-			// All of this...because the C++ 17 STL doesn't have EndsWith
-			std::string_view extString = ".resources";
-			size_t extIndex = nameString.rfind(extString);
-			if (extIndex != std::string_view::npos && extIndex + extString.length() == nameString.length())
-			{
-				//printf("%.*s\n", (int)nameString.length(), nameString.data());
-				packages.push_back(std::string(nameString));
-			}
+	// Get all resource archive names and their priorities
+	for (const std::string& name : spec->files) {
+		std::string_view nameString = name;
+		if (nameString.find("modarchives") != std::string::npos) {
+			if(!IncludeModArchives)
+				continue;
+		}
+
+		// All of this...because the C++ 17 STL doesn't have EndsWith
+		std::string_view extString = ".resources";
+		size_t extIndex = nameString.rfind(extString);
+		if (extIndex != std::string_view::npos && extIndex + extString.length() == nameString.length())
+		{
+			//printf("%.*s\n", (int)nameString.length(), nameString.data());
+			packages.push_back(name);
 		}
-	}
-	catch (std::exception e) {
-		return {};
 	}
 
 	return packages;
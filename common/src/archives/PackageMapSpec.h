@@ -1,5 +1,6 @@
 #pragma once
 #include <filesystem>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -7,6 +8,28 @@ typedef std::filesystem::path fspath;
 
 namespace PackageMapSpec
 {
+	struct mapfileref_t {
+		int file; // Index into the file list
+		int map;  // Index into the map list
+	};
+
+	/*
+	* Flat copy of the packagemapspec's lists. Names are taken verbatim
+	* from the file, without their quotes
+	*/
+	struct spec_t {
+		std::vector<std::string> files;
+		std::vector<std::string> maps;
+		std::vector<mapfileref_t> mapFileRefs;
+	};
+
+	/*
+	* Reads the packagemapspec. The result is cached for the rest of the process,
+	* and only read again once the file's size or last write time changes
+	* @return nullptr if the file is missing or malformed
+	*/
+	std::shared_ptr<const spec_t> Read(const fspath gamedir);
+
 	/* Prints a human-readable version of the PackageMapSpec*/
 	void ToString(const fspath gamedir);
 
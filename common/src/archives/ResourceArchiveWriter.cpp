@@ -0,0 +1,202 @@
+#include "ResourceArchiveWriter.h"
+#include "io/MappedFile.h"
+#include <cassert>
+
+#ifndef _DEBUG
+#undef assert
+#define assert(OP) (OP)
+#endif
+
+ResourceArchiveWriter::ResourceArchiveWriter(uint32_t version)
+{
+	blob.reserve(100000);
+	offsets.reserve(1000);
+	offsetmap.reserve(1000);
+
+	ResourceHeader& h = archive.header;
+	h.magic[0] = 'I'; h.magic[1] = 'D'; h.magic[2] = 'C'; h.magic[3] = 'L';
+	h.version = version;
+	h.flags = 0;
+	h.numSegments = 1;
+	h.segmentSize = 1099511627775UL;
+	h.metadataHash = 0;
+	h.numSpecialHashes = 0;
+	h.numMetaEntries = 0;
+	h.metaEntriesSize = 0;
+}
+
+/*
+* Returns the index of a string
+* Adds the string to the table if it doesn't exist
+*/
+uint64_t ResourceArchiveWriter::IndexOf(std::string_view s)
+{
+	const auto iter = offsetmap.find(std::string(s));
+	if (iter != offsetmap.end())
+		return iter->second;
+
+	uint64_t index = offsets.size();
+	offsets.push_back(blob.size());
+	blob.append(s);
+	blob.push_back('\0');
+	offsetmap.emplace(s, index);
+	return index;
+}
+
+uint32_t ResourceArchiveWriter::AddEntry(std::string_view type, std::string_view name)
+{
+	assert(!opened);
+	uint32_t index = static_cast<uint32_t>(staged.size());
+	stagedstrings.push_back(IndexOf(type));
+	stagedstrings.push_back(IndexOf(name));
+	stagedtypes.push_back(Get_ResourceType(type));
+
+	// Value-initialization zeroes the padding too.
+	// Indeterminate padding would destabilize the metadata hash when hot reloading
+	ResourceEntry& e = staged.emplace_back();
+	e.resourceTypeString = 0;
+	e.nameString = 1;
+	e.descString = -1;
+	e.strings = index * 2;
+	e.numStrings = 2;
+	return index;
+}
+
+bool ResourceArchiveWriter::Open(const fspath& outpath)
+{
+	assert(!opened);
+	ResourceHeader& h = archive.header;
+	const uint32_t numEntries = static_cast<uint32_t>(staged.size());
+
+	h.resourceEntriesOffset = sizeof(ResourceHeader) + (h.version < 13 ? sizeof(ResourceMetaHeader) : 0);
+	h.numResources = numEntries;
+	h.stringTableOffset = h.resourceEntriesOffset + h.numResources * sizeof(ResourceEntry);
+
+	archive.entries = new ResourceEntry[numEntries];
+	memcpy(archive.entries, staged.data(), numEntries * sizeof(ResourceEntry));
+	staged.clear();
+	staged.shrink_to_fit();
+
+	archive.entryTypes = new ResourceType[numEntries];
+	memcpy(archive.entryTypes, stagedtypes.data(), numEntries * sizeof(ResourceType));
+
+	h.numStringIndices = static_cast<uint32_t>(stagedstrings.size());
+	archive.stringIndex = new uint64_t[h.numStringIndices];
+	memcpy(archive.stringIndex, stagedstrings.data(), stagedstrings.size() * sizeof(uint64_t));
+
+	// String Chunk: String Count + Offset Chunk + String Blob, padded to an 8 byte alignment
+	StringChunk& s = archive.stringChunk;
+	s.numStrings = offsets.size();
+	s.offsets = new uint64_t[offsets.size()];
+	memcpy(s.offsets, offsets.data(), offsets.size() * sizeof(uint64_t));
+	s.dataBlock = new char[blob.size()];
+	memcpy(s.dataBlock, blob.data(), blob.size());
+
+	h.stringTableSize = static_cast<uint32_t>(sizeof(uint64_t) + s.numStrings * sizeof(uint64_t) + blob.size());
+	s.paddingCount = 8 - h.stringTableSize % 8;
+	h.stringTableSize += static_cast<uint32_t>(s.paddingCount);
+
+	// Dependencies - seem to be unnecessary. Only used by idStudio?
+	h.resourceDepsOffset = h.stringTableOffset + h.stringTableSize;
+	h.numDependencies = 0;
+	h.numDepIndices = 0;
+	h.metaEntriesOffset = h.resourceDepsOffset;
+	h.resourceSpecialHashOffset = h.resourceDepsOffset + h.numDependencies * sizeof(ResourceDependency);
+
+	// IDCL Size and Data Offset
+	archive.metaheader.unknown = 0;
+	archive.metaheader.metaOffset = Get_ExpectedMetaOffset(h);
+	idclsize = 4 + (archive.metaheader.metaOffset + 4) % 8; // Ensure data offset has an 8 byte alignment
+	h.dataOffset = archive.metaheader.metaOffset + idclsize;
+	assert(h.dataOffset % 8 == 0);
+
+	runningDataOffset = h.dataOffset;
+	nextData = 0;
+	opened = true;
+
+	if(!output.Open(outpath))
+		return false;
+	return output.Seek(h.dataOffset);
+}
+
+bool ResourceArchiveWriter::WriteData(uint32_t index, const char* data, size_t length)
+{
+	assert(opened);
+	assert(index == nextData);
+	ResourceEntry& e = archive.entries[index];
+	if(length > e.dataSize)
+		return false;
+
+	// TODO: There's a fair bit of padding between each resource data block.
+	// At a minimum, a data block has 8-byte alignment. It's unknown what the implications of ignoring
+	// these practices are
+	e.dataOffset = runningDataOffset;
+	runningDataOffset += e.dataSize;
+	runningDataOffset += 8 - runningDataOffset % 8;
+	nextData++;
+
+	return output.PadTo(e.dataOffset)
+		&& output.Write(data, length)
+		&& output.WriteZeros(e.dataSize - length);
+}
+
+bool ResourceArchiveWriter::CopyData(uint32_t index, const MappedFile& source, uint64_t offset, size_t length)
+{
+	if(!source.Okay() || offset + length > source.len())
+		return false;
+	return WriteData(index, source.data() + offset, length);
+}
+
+bool ResourceArchiveWriter::CopyData(uint32_t index, const fspath& source, uint64_t offset, size_t length)
+{
+	MappedFile mapping(source);
+	return CopyData(index, mapping, offset, length);
+}
+
+bool ResourceArchiveWriter::Finish()
+{
+	assert(opened);
+	const ResourceHeader& h = archive.header;
+
+	// A header must never describe entries whose data wasn't written
+	if (nextData != h.numResources) {
+		output.Close();
+		return false;
+	}
+
+	bool okay = output.Seek(0)
+		&& output.Write(reinterpret_cast<const char*>(&h), sizeof(ResourceHeader));
+	if (okay && h.version < 13) {
+		okay = output.Write(reinterpret_cast<const char*>(&archive.metaheader), sizeof(ResourceMetaHeader));
+	}
+
+	// Assemble the metadata span contiguously so it's container mask hash
+	// can be computed without reading the archive back
+	std::string metadata;
+	metadata.reserve(h.dataOffset - h.resourceEntriesOffset);
+	metadata.append(reinterpret_cast<const char*>(archive.entries), sizeof(ResourceEntry) * h.numResources);
+
+	// String Chunk
+	const StringChunk& s = archive.stringChunk;
+	metadata.append(reinterpret_cast<const char*>(&s.numStrings), sizeof(uint64_t));
+	metadata.append(reinterpret_cast<const char*>(s.offsets), s.numStrings * sizeof(uint64_t));
+	metadata.append(s.dataBlock, blob.size());
+	metadata.append(s.paddingCount, '\0');
+
+	// Dependencies
+	metadata.append(reinterpret_cast<const char*>(archive.dependencies), h.numDependencies * sizeof(ResourceDependency));
+	metadata.append(reinterpret_cast<const char*>(archive.dependencyIndex), h.numDepIndices * sizeof(uint32_t));
+	metadata.append(reinterpret_cast<const char*>(archive.stringIndex), h.numStringIndices * sizeof(uint64_t));
+
+	// IDCL
+	metadata.append("IDCL", 4);
+	maskentry.hash = GetContainerMaskHash(metadata.data(), metadata.size());
+	maskentry.numResources = h.numResources;
+
+	metadata.append(idclsize - 4, '\0');
+	okay = okay && output.Write(metadata.data(), metadata.size());
+	okay = okay && output.Position() == h.dataOffset;
+
+	// Always closed, even after a failure
+	return output.Close() && okay;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "ResourceStructs.h"
+#include "io/BufferedFileWriter.h"
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+/*
+* Builds a resource archive file
+*
+* Usage:
+* 1. Stage every entry with AddEntry
+* 2. Open the output file. The header, string and dependency layout is computed here
+* 3. Fill in each entry's fields, then write it's data in entry order. Data blocks are
+*    streamed sequentially through a large buffer with 8-byte alignment between them
+* 4. Finish, which writes the header and metadata in a single pass
+*/
+class ResourceArchiveWriter {
+	private:
+	ResourceArchive archive;
+	std::vector<ResourceEntry> staged;
+	std::vector<uint64_t> stagedstrings; // String table indices - type and name for each entry
+	std::vector<ResourceType> stagedtypes;
+	BufferedFileWriter output;
+
+	// String table
+	std::string blob;
+	std::vector<uint64_t> offsets;
+	std::unordered_map<std::string, uint64_t> offsetmap;
+
+	containerMaskEntry_t maskentry = {0, 0};
+	uint64_t idclsize = 0;
+	uint64_t runningDataOffset = 0;
+	uint32_t nextData = 0; // Index of the next entry to receive data
+	bool opened = false;
+
+	uint64_t IndexOf(std::string_view s);
+
+	public:
+	ResourceArchiveWriter(uint32_t version);
+
+	/*
+	* Stages an entry, setting it's strings and the values that are universal across entries
+	* Returns the entry's index
+	*/
+	uint32_t AddEntry(std::string_view type, std::string_view name);
+
+	ResourceEntry& Entry(uint32_t index) {
+		return opened ? archive.entries[index] : staged[index];
+	}
+
+	// The archive as it will be written. Entries are complete once their data is written
+	const ResourceArchive& GetArchive() const {
+		return archive;
+	}
+
+	// Computes the archive layout and positions the output at the data section
+	bool Open(const fspath& outpath);
+
+	/*
+	* Writes an entry's data. Entries must be written in order, and the entry's
+	* dataSize must be set beforehand. If length is less than dataSize, the remaining
+	* space is reserved with zeros. Sets the entry's dataOffset
+	*/
+	bool WriteData(uint32_t index, const char* data, size_t length);
+
+	// Copies an entry's data from a region of another file, without reading it into a separate buffer
+	bool CopyData(uint32_t index, const MappedFile& source, uint64_t offset, size_t length);
+	bool CopyData(uint32_t index, const fspath& source, uint64_t offset, size_t length);
+
+	// Writes the header and metadata sections and closes the file
+	bool Finish();
+
+	// The finished archive's container mask hash. Only valid after Finish
+	const containerMaskEntry_t& ContainerMaskEntry() const {
+		return maskentry;
+	}
+};
@@ -0,0 +1,224 @@
+#include "ResourceBatch.h"
+#include "io/MappedFile.h"
+#include "io/AsyncFileReader.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+ResourceBatchDecompressor::ResourceBatchDecompressor(int threadcount)
+{
+	if(threadcount <= 0)
+		threadcount = static_cast<int>(std::thread::hardware_concurrency());
+	if(threadcount <= 0)
+		threadcount = 1;
+
+	workercount = threadcount;
+	scratch = new ResourceEntryBuffers_t[workercount];
+}
+
+void ResourceBatchDecompressor::Run(const ResourceArchive& r, const std::vector<uint32_t>& entryindices, const ResourceBatchCallback& callback, bool ordered)
+{
+	if(entryindices.empty())
+		return;
+
+	// Mapped archives are paged in by the workers as they touch the data. Prefetching
+	// the coalesced ranges lets the OS fetch them as large sequential reads instead
+	const bool offsetorder = r.mapping && !ordered;
+	if (r.mapping) {
+		plan.Build(r, entryindices, readgap);
+		plan.Prefetch(*r.mapping);
+	}
+
+	std::atomic<size_t> nextclaim = 0;
+
+	// Ordered delivery: workers claim entries in ascending order, so the
+	// worker holding the next entry to deliver is never blocked by the others
+	std::mutex delivermutex;
+	std::condition_variable deliversignal;
+	size_t nextdeliver = 0;
+
+	auto worker = [&](int workerindex) {
+		ResourceEntryBuffers_t& buffers = scratch[workerindex];
+		ResourceBatchItem_t item;
+		item.workerindex = workerindex;
+
+		while (true) {
+			size_t claim = nextclaim.fetch_add(1);
+			if(claim >= entryindices.size())
+				break;
+
+			if (offsetorder) {
+				item.batchindex = plan.Slice(claim).batchindex;
+				item.entryindex = plan.Slice(claim).entryindex;
+			}
+			else {
+				item.batchindex = claim;
+				item.entryindex = entryindices[claim];
+			}
+			item.data = Get_EntryData(r, r.entries[item.entryindex], buffers.decomp_buffer, buffers.decomp_length);
+
+			if (ordered) {
+				std::unique_lock<std::mutex> lock(delivermutex);
+				deliversignal.wait(lock, [&]{return nextdeliver == item.batchindex;});
+				callback(item);
+				nextdeliver++;
+				lock.unlock();
+				deliversignal.notify_all();
+			}
+			else {
+				callback(item);
+			}
+		}
+	};
+
+	int threadsToUse = workercount;
+	if(static_cast<size_t>(threadsToUse) > entryindices.size())
+		threadsToUse = static_cast<int>(entryindices.size());
+
+	// No reason to spin up a thread for a single worker
+	if (threadsToUse == 1) {
+		worker(0);
+		return;
+	}
+
+	std::vector<std::thread> threadpool;
+	threadpool.reserve(threadsToUse);
+	for(int t = 0; t < threadsToUse; t++)
+		threadpool.emplace_back(worker, t);
+	for(std::thread& t : threadpool)
+		t.join();
+}
+
+void ResourceBatchDecompressor::RunStreamed(const ResourceArchive& r, const fspath& archivepath, const std::vector<uint32_t>& entryindices, const ResourceBatchCallback& callback)
+{
+	if(entryindices.empty())
+		return;
+
+	// Smaller ranges than the mapped path, since every range in flight holds a buffer
+	const uint64_t STREAMED_MAX_RANGE = 8 * 1024 * 1024;
+	plan.Build(r, entryindices, readgap, STREAMED_MAX_RANGE);
+
+	AsyncFileReader reader;
+	if (!reader.Open(archivepath)) {
+		ResourceBatchItem_t item;
+		for (size_t i = 0; i < entryindices.size(); i++) {
+			item.batchindex = i;
+			item.entryindex = entryindices[i];
+			item.data = {EntryDataCode::DATA_NOT_READ, nullptr, 0};
+			callback(item);
+		}
+		return;
+	}
+
+	// Ranges that have been read, waiting for a worker
+	std::mutex joblock;
+	std::condition_variable jobsignal;
+	std::condition_variable retiresignal;
+	std::deque<AsyncFileReader::completion_t> jobs;
+	size_t retired = 0;
+	bool readsdone = false;
+
+	auto worker = [&](int workerindex) {
+		ResourceEntryBuffers_t& buffers = scratch[workerindex];
+		ResourceBatchItem_t item;
+		item.workerindex = workerindex;
+
+		while (true) {
+			AsyncFileReader::completion_t job;
+			{
+				std::unique_lock<std::mutex> lock(joblock);
+				jobsignal.wait(lock, [&]{return readsdone || !jobs.empty();});
+				if(jobs.empty())
+					return;
+				job = jobs.front();
+				jobs.pop_front();
+			}
+
+			const ResourceReadPlan::range_t& range = plan.Range(job.userdata);
+			for (uint32_t i = range.firstSlice; i < range.firstSlice + range.numSlices; i++) {
+				const ResourceReadPlan::slice_t& slice = plan.Slice(i);
+				const ResourceEntry& e = r.entries[slice.entryindex];
+				item.batchindex = slice.batchindex;
+				item.entryindex = slice.entryindex;
+
+				if(job.okay)
+					item.data = Get_EntryData(e, job.buffer + (e.dataOffset - range.offset), buffers.decomp_buffer, buffers.decomp_length);
+				else item.data = {EntryDataCode::DATA_NOT_READ, nullptr, 0};
+				callback(item);
+			}
+
+			reader.Release(job);
+			{
+				std::lock_guard<std::mutex> guard(joblock);
+				retired++;
+			}
+			retiresignal.notify_one();
+		}
+	};
+
+	int threadsToUse = workercount;
+	if(static_cast<size_t>(threadsToUse) > plan.RangeCount())
+		threadsToUse = static_cast<int>(plan.RangeCount());
+
+	std::vector<std::thread> threadpool;
+	threadpool.reserve(threadsToUse);
+	for(int t = 0; t < threadsToUse; t++)
+		threadpool.emplace_back(worker, t);
+
+	// This thread drives the reads. The number of ranges read but not yet
+	// decompressed is capped, so fast disks can't outrun memory
+	const size_t window = AsyncFileReader::DEFAULT_QUEUE_DEPTH + threadsToUse;
+	size_t submitted = 0;
+
+	auto submitmore = [&]() {
+		size_t limit;
+		{
+			std::lock_guard<std::mutex> guard(joblock);
+			limit = retired + window;
+		}
+		for (; submitted < plan.RangeCount() && submitted < limit; submitted++) {
+			const ResourceReadPlan::range_t& range = plan.Range(submitted);
+			reader.Submit({range.offset, range.length, submitted});
+		}
+	};
+
+	submitmore();
+	while (submitted < plan.RangeCount() || reader.InFlight() > 0) {
+		if (reader.InFlight() == 0) {
+			std::unique_lock<std::mutex> lock(joblock);
+			retiresignal.wait(lock, [&]{return retired + window > submitted;});
+			lock.unlock();
+			submitmore();
+			continue;
+		}
+
+		AsyncFileReader::completion_t c;
+		reader.Wait(c);
+		{
+			std::lock_guard<std::mutex> guard(joblock);
+			jobs.push_back(c);
+		}
+		jobsignal.notify_one();
+		submitmore();
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(joblock);
+		readsdone = true;
+	}
+	jobsignal.notify_all();
+	for(std::thread& t : threadpool)
+		t.join();
+}
+
+void ResourceBatchDecompressor::Run(const ResourceArchive& r, const ResourceBatchPredicate& predicate, const ResourceBatchCallback& callback, bool ordered)
+{
+	std::vector<uint32_t> entryindices;
+	for (uint32_t i = 0; i < r.header.numResources; i++) {
+		if(predicate(i, r.entries[i]))
+			entryindices.push_back(i);
+	}
+	Run(r, entryindices, callback, ordered);
+}
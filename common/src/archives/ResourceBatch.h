@@ -0,0 +1,74 @@
+#pragma once
+#include "ResourceStructs.h"
+#include "ResourceReadPlan.h"
+#include <functional>
+#include <vector>
+
+struct ResourceBatchItem_t {
+	uint32_t entryindex = 0; // Index of the entry within the archive
+	size_t batchindex = 0;   // Position of the entry within the batch
+	int workerindex = 0;     // Index of the worker invoking the callback. Use it to select per-thread state
+	ResourceEntryData_t data;
+};
+
+typedef std::function<void(const ResourceBatchItem_t& item)> ResourceBatchCallback;
+typedef std::function<bool(uint32_t entryindex, const ResourceEntry& e)> ResourceBatchPredicate;
+
+/*
+* Decompresses batches of resource entries across a pool of worker threads
+*
+* The archive must have it's data section available (read with RF_ReadEverything or RF_MapFile).
+* Entries are fetched by calling Get_EntryData on each worker. For mapped archives, a read plan
+* of the batch is prefetched up front, and unordered batches are claimed in offset order so the
+* file is paged in sequentially. Every worker owns a
+* scratch buffer that is reused for every entry it decompresses, across all batches run
+* with this object. Data passed to the callback is only valid until the callback returns
+*/
+class ResourceBatchDecompressor {
+	private:
+	int workercount;
+	ResourceEntryBuffers_t* scratch; // One per worker
+	uint64_t readgap = ResourceReadPlan::DEFAULT_MAX_GAP;
+	ResourceReadPlan plan;
+
+	public:
+	// @param threadcount Number of workers. 0 selects the hardware thread count
+	ResourceBatchDecompressor(int threadcount = 0);
+
+	ResourceBatchDecompressor(const ResourceBatchDecompressor& b) = delete;
+	void operator=(const ResourceBatchDecompressor& b) = delete;
+
+	~ResourceBatchDecompressor() {
+		delete[] scratch;
+	}
+
+	int WorkerCount() const {return workercount;}
+
+	// Maximum distance between entries that are read together. See ResourceReadPlan
+	void SetReadGap(uint64_t bytes) {readgap = bytes;}
+
+	/*
+	* Decompresses the given entries, invoking the callback once per entry
+	*
+	* @param ordered If true, callbacks are invoked one at a time in the order of entryindices,
+	* so the callback needs no synchronization. Workers continue decompressing ahead while they wait their turn.
+	* If false, callbacks are invoked concurrently from the workers as soon as each entry is ready
+	*/
+	void Run(const ResourceArchive& r, const std::vector<uint32_t>& entryindices, const ResourceBatchCallback& callback, bool ordered);
+
+	/*
+	* Decompresses entries from an archive whose data section was not read (RF_SkipData)
+	*
+	* The entries are coalesced into a read plan whose ranges are read asynchronously,
+	* keeping the disk queue full while the workers decompress completed ranges.
+	* Callbacks are invoked concurrently, in the order reads complete. Entries whose read
+	* failed are delivered with EntryDataCode::DATA_NOT_READ
+	*/
+	void RunStreamed(const ResourceArchive& r, const fspath& archivepath, const std::vector<uint32_t>& entryindices, const ResourceBatchCallback& callback);
+
+	/*
+	* Decompresses every entry the predicate accepts. The predicate is evaluated
+	* on the calling thread in archive order before decompression begins
+	*/
+	void Run(const ResourceArchive& r, const ResourceBatchPredicate& predicate, const ResourceBatchCallback& callback, bool ordered);
+};
@@ -0,0 +1,346 @@
+#include "ResourceCatalog.h"
+#include "PackageMapSpec.h"
+#include "hash/HashLib.h"
+#include "io/MappedFile.h"
+#include "atlan/AtlanLogger.h"
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cassert>
+
+#ifndef _DEBUG
+#undef assert
+#define assert(OP) (OP)
+#endif
+
+#define CATALOG_VERSION 3
+
+ResourceEntry ResourceCatalog::entry_t::ToResourceEntry() const
+{
+	ResourceEntry e = {};
+	e.dataOffset = dataOffset;
+	e.dataSize = dataSize;
+	e.uncompressedSize = uncompressedSize;
+	e.dataCheckSum = dataCheckSum;
+	e.generationTimeStamp = generationTimeStamp;
+	e.defaultHash = defaultHash;
+	e.version = version;
+	e.compMode = compMode;
+	e.numDependencies = numDependencies;
+	return e;
+}
+
+fspath ResourceCatalog::DefaultPath(const fspath& gamedir)
+{
+	return gamedir / "atlan_resource_catalog.bin";
+}
+
+void ResourceCatalog::Unmap()
+{
+	delete mapping;
+	mapping = nullptr;
+	header = nullptr;
+	archives = nullptr;
+	entries = nullptr;
+	winners = nullptr;
+	dependencies = nullptr;
+	dependencyHashes = nullptr;
+	strings = nullptr;
+}
+
+bool ResourceCatalog::Map(const fspath& catalogpath)
+{
+	Unmap();
+	if(!std::filesystem::exists(catalogpath))
+		return false;
+
+	mapping = new MappedFile(catalogpath);
+	if (!mapping->Okay() || mapping->len() < sizeof(header_t)) {
+		Unmap();
+		return false;
+	}
+
+	const char* view = mapping->data();
+	const header_t* h = reinterpret_cast<const header_t*>(view);
+	if (memcmp(h->magic, "ATRC", 4) != 0 || h->version != CATALOG_VERSION || h->stringsOffset + h->stringBlockSize > mapping->len()) {
+		Unmap();
+		return false;
+	}
+
+	header = h;
+	archives = reinterpret_cast<const archive_t*>(view + h->archivesOffset);
+	entries = reinterpret_cast<const entry_t*>(view + h->entriesOffset);
+	winners = reinterpret_cast<const winner_t*>(view + h->winnersOffset);
+	dependencies = reinterpret_cast<const dependency_t*>(view + h->dependenciesOffset);
+	dependencyHashes = reinterpret_cast<const uint64_t*>(view + h->dependencyHashesOffset);
+	strings = view + h->stringsOffset;
+	return true;
+}
+
+const ResourceCatalog::entry_t* ResourceCatalog::FindWinner(uint64_t declhash) const
+{
+	if(!header)
+		return nullptr;
+
+	const winner_t* end = winners + header->numWinners;
+	const winner_t* w = std::lower_bound(winners, end, declhash, [](const winner_t& a, uint64_t b) {return a.declHash < b;});
+	if(w == end || w->declHash != declhash)
+		return nullptr;
+	return entries + w->entry;
+}
+
+const ResourceCatalog::entry_t* ResourceCatalog::FindWinner(std::string_view type, std::string_view name) const
+{
+	return FindWinner(HashLib::DeclHash(type, name));
+}
+
+const ResourceCatalog::dependency_t* ResourceCatalog::FindDependency(uint64_t hash) const
+{
+	if(!header)
+		return nullptr;
+
+	const dependency_t* end = dependencies + header->numDependencies;
+	const dependency_t* d = std::lower_bound(dependencies, end, hash, [](const dependency_t& a, uint64_t b) {return a.hash < b;});
+	if(d == end || d->hash != hash)
+		return nullptr;
+	return d;
+}
+
+/*
+* In-memory form of the catalog, assembled before it's written to disk
+*/
+struct CatalogBuilder {
+	std::vector<ResourceCatalog::archive_t> archives;
+	std::vector<ResourceCatalog::entry_t> entries;
+	std::vector<ResourceCatalog::dependency_t> dependencies;
+	std::vector<uint64_t> dependencyHashes;
+	std::unordered_map<uint64_t, uint32_t> dependencyMap;
+	std::string strings;
+	std::unordered_map<std::string, uint64_t> stringMap;
+
+	uint64_t Intern(const char* s) {
+		const auto& tryresult = stringMap.try_emplace(s, strings.size());
+		if (tryresult.second) {
+			strings.append(s);
+			strings.push_back('\0');
+		}
+		return tryresult.first->second;
+	}
+
+	void AddDependency(uint64_t hash, const char* typestring, const char* namestring) {
+		dependencyHashes.push_back(hash);
+		if (dependencyMap.try_emplace(hash, static_cast<uint32_t>(dependencies.size())).second) {
+			dependencies.push_back({hash, Intern(typestring), Intern(namestring)});
+		}
+	}
+};
+
+bool ResourceCatalog::Load(const fspath& gamedir)
+{
+	return Load(gamedir, DefaultPath(gamedir));
+}
+
+bool ResourceCatalog::Load(const fspath& gamedir, const fspath& catalogpath)
+{
+	basedir = gamedir / "base";
+	const std::vector<std::string> archivelist = PackageMapSpec::GetPrioritizedArchiveList(gamedir, false);
+	if (archivelist.empty()) {
+		atlog << "ERROR: Could not read the archive list from the packagemapspec\n";
+		return false;
+	}
+
+	struct archivestat_t {
+		uint64_t size;
+		int64_t writetime;
+	};
+	std::vector<archivestat_t> stats;
+	stats.reserve(archivelist.size());
+	for (const std::string& archivename : archivelist) {
+		const fspath archivepath = basedir / archivename;
+		std::error_code sizeerror, timeerror;
+		const uint64_t size = std::filesystem::file_size(archivepath, sizeerror);
+		const auto writetime = std::filesystem::last_write_time(archivepath, timeerror);
+		if (sizeerror || timeerror) {
+			atlog << "ERROR: Could not read archive " << archivepath << "\n";
+			return false;
+		}
+		stats.push_back({size, writetime.time_since_epoch().count()});
+	}
+
+	/*
+	* Determine if the existing catalog is up to date
+	*/
+	Map(catalogpath);
+	bool uptodate = header && header->numArchives == archivelist.size();
+	for (size_t i = 0; uptodate && i < archivelist.size(); i++) {
+		const archive_t& a = archives[i];
+		uptodate = a.fileSize == stats[i].size && a.lastWriteTime == stats[i].writetime && archivelist[i] == String(a.pathString);
+	}
+	if(uptodate)
+		return true;
+
+	/*
+	* Rebuild the catalog, carrying over records for unchanged archives
+	*/
+	std::unordered_map<std::string_view, uint32_t> oldarchives;
+	for(uint32_t i = 0; i < ArchiveCount(); i++)
+		oldarchives.emplace(String(archives[i].pathString), i);
+
+	CatalogBuilder b;
+	b.archives.reserve(archivelist.size());
+	int rescancount = 0;
+
+	for (size_t i = 0; i < archivelist.size(); i++) {
+		archive_t a;
+		a.pathString = b.Intern(archivelist[i].c_str());
+		a.fileSize = stats[i].size;
+		a.lastWriteTime = stats[i].writetime;
+		a.firstEntry = static_cast<uint32_t>(b.entries.size());
+
+		const uint32_t archiveindex = static_cast<uint32_t>(b.archives.size());
+		const auto& olditer = oldarchives.find(archivelist[i]);
+
+		if (olditer != oldarchives.end() && archives[olditer->second].fileSize == a.fileSize && archives[olditer->second].lastWriteTime == a.lastWriteTime) {
+			const archive_t& old = archives[olditer->second];
+			a.numEntries = old.numEntries;
+			a.maskHash = old.maskHash;
+
+			for (uint32_t k = old.firstEntry; k < old.firstEntry + old.numEntries; k++) {
+				entry_t e = entries[k];
+				e.archiveIndex = archiveindex;
+				e.typeString = b.Intern(String(e.typeString));
+				e.nameString = b.Intern(String(e.nameString));
+
+				const uint32_t firstdep = static_cast<uint32_t>(b.dependencyHashes.size());
+				for (uint16_t d = 0; d < e.numDependencies; d++) {
+					const dependency_t* dep = FindDependency(dependencyHashes[e.firstDependency + d]);
+					b.AddDependency(dep->hash, String(dep->typeString), String(dep->nameString));
+				}
+				e.firstDependency = firstdep;
+				b.entries.push_back(e);
+			}
+		}
+		else {
+			rescancount++;
+			ResourceArchive r;
+			if (!Read_ResourceArchive(r, basedir / archivelist[i], RF_MapFile)) {
+				atlog << "ERROR: Could not read archive " << basedir / archivelist[i] << "\n";
+				Unmap();
+				return false;
+			}
+			a.numEntries = r.header.numResources;
+			a.maskHash = GetContainerMaskHash(r).hash;
+
+			for (uint32_t k = 0; k < r.header.numResources; k++) {
+				const ResourceEntry& re = r.entries[k];
+				const char* typestring, *namestring;
+				Get_EntryStrings(r, re, typestring, namestring);
+
+				entry_t e = {};
+				e.declHash = HashLib::DeclHash(typestring, namestring);
+				e.typeString = b.Intern(typestring);
+				e.nameString = b.Intern(namestring);
+				e.dataOffset = re.dataOffset;
+				e.dataSize = re.dataSize;
+				e.uncompressedSize = re.uncompressedSize;
+				e.dataCheckSum = re.dataCheckSum;
+				e.generationTimeStamp = re.generationTimeStamp;
+				e.defaultHash = re.defaultHash;
+				e.archiveIndex = archiveindex;
+				e.entryIndex = k;
+				e.version = re.version;
+				e.compMode = re.compMode;
+				e.resourceType = r.entryTypes[k];
+				e.numDependencies = re.numDependencies;
+				e.firstDependency = static_cast<uint32_t>(b.dependencyHashes.size());
+
+				for (uint16_t d = 0; d < re.numDependencies; d++) {
+					const ResourceDependency& dep = r.dependencies[r.dependencyIndex[re.depIndices + d]];
+					const char* deptypestring, *depnamestring;
+					Get_DependencyStrings(r, dep, deptypestring, depnamestring);
+					b.AddDependency(HashLib::DeclHash(deptypestring, depnamestring), deptypestring, depnamestring);
+				}
+				b.entries.push_back(e);
+			}
+		}
+		b.archives.push_back(a);
+	}
+
+	// The old catalog must be released before it's overwritten
+	oldarchives.clear();
+	Unmap();
+
+	// First copy in priority order wins
+	std::vector<winner_t> winnerlist;
+	{
+		std::unordered_map<uint64_t, uint32_t> winnermap;
+		winnermap.reserve(b.entries.size());
+		for (uint32_t i = 0; i < b.entries.size(); i++) {
+			if(winnermap.try_emplace(b.entries[i].declHash, i).second)
+				winnerlist.push_back({b.entries[i].declHash, i, 0});
+		}
+	}
+	std::sort(winnerlist.begin(), winnerlist.end(), [](const winner_t& x, const winner_t& y) {return x.declHash < y.declHash;});
+	std::sort(b.dependencies.begin(), b.dependencies.end(), [](const dependency_t& x, const dependency_t& y) {return x.hash < y.hash;});
+
+	// Keep every section 8-byte aligned
+	while(b.strings.size() % 8 != 0)
+		b.strings.push_back('\0');
+
+	/*
+	* Write the catalog
+	*/
+	header_t h;
+	memcpy(h.magic, "ATRC", 4);
+	h.version = CATALOG_VERSION;
+	h.numArchives = static_cast<uint32_t>(b.archives.size());
+	h.numEntries = static_cast<uint32_t>(b.entries.size());
+	h.numWinners = static_cast<uint32_t>(winnerlist.size());
+	h.numDependencies = static_cast<uint32_t>(b.dependencies.size());
+	h.numDependencyHashes = b.dependencyHashes.size();
+	h.stringBlockSize = b.strings.size();
+	h.archivesOffset = sizeof(header_t);
+	h.entriesOffset = h.archivesOffset + b.archives.size() * sizeof(archive_t);
+	h.winnersOffset = h.entriesOffset + b.entries.size() * sizeof(entry_t);
+	h.dependenciesOffset = h.winnersOffset + winnerlist.size() * sizeof(winner_t);
+	h.dependencyHashesOffset = h.dependenciesOffset + b.dependencies.size() * sizeof(dependency_t);
+	h.stringsOffset = h.dependencyHashesOffset + b.dependencyHashes.size() * sizeof(uint64_t);
+
+	// Written beside the catalog and renamed over it, so a failed write never leaves a partial catalog behind
+	fspath temppath = catalogpath;
+	temppath += ".tmp";
+	{
+		std::ofstream writer(temppath, std::ios_base::binary);
+		if (!writer.good()) {
+			atlog << "ERROR: Could not write resource catalog " << catalogpath << "\n";
+			return false;
+		}
+		writer.write(reinterpret_cast<const char*>(&h), sizeof(header_t));
+		writer.write(reinterpret_cast<const char*>(b.archives.data()), b.archives.size() * sizeof(archive_t));
+		writer.write(reinterpret_cast<const char*>(b.entries.data()), b.entries.size() * sizeof(entry_t));
+		writer.write(reinterpret_cast<const char*>(winnerlist.data()), winnerlist.size() * sizeof(winner_t));
+		writer.write(reinterpret_cast<const char*>(b.dependencies.data()), b.dependencies.size() * sizeof(dependency_t));
+		writer.write(reinterpret_cast<const char*>(b.dependencyHashes.data()), b.dependencyHashes.size() * sizeof(uint64_t));
+		writer.write(b.strings.data(), b.strings.size());
+		writer.close();
+
+		std::error_code renameerror;
+		if(!writer.fail())
+			std::filesystem::rename(temppath, catalogpath, renameerror);
+		if (writer.fail() || renameerror) {
+			atlog << "ERROR: Could not write resource catalog " << catalogpath << "\n";
+			std::error_code removeerror;
+			std::filesystem::remove(temppath, removeerror);
+			return false;
+		}
+	}
+
+	atlog << "Resource catalog updated: rescanned " << rescancount << " of " << static_cast<int64_t>(archivelist.size()) << " archives\n";
+	if (!Map(catalogpath)) {
+		atlog << "ERROR: Could not read resource catalog " << catalogpath << "\n";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "ResourceStructs.h"
+#include <string_view>
+
+/*
+* Persistent index of every resource entry in the game's prioritized archives
+*
+* The catalog is a single flat file that's memory-mapped on load. Each archive's records are
+* keyed by the archive's path, size and last write time. When an archive changes, only that
+* archive is rescanned; records for unchanged archives are carried over from the previous catalog.
+* The archive's container mask hash is cached the same way, so unchanged archives are never rehashed.
+*
+* Archives and their entries are stored in priority order. For every type/name pair, the catalog
+* also stores the "winner" - the first copy found in priority order. Container masks are not
+* accounted for here.
+*/
+class ResourceCatalog {
+	public:
+
+	struct header_t {
+		char     magic[4];       // "ATRC"
+		uint32_t version;
+		uint32_t numArchives;
+		uint32_t numEntries;
+		uint32_t numWinners;
+		uint32_t numDependencies;
+		uint64_t numDependencyHashes;
+		uint64_t stringBlockSize;
+		uint64_t archivesOffset;
+		uint64_t entriesOffset;
+		uint64_t winnersOffset;
+		uint64_t dependenciesOffset;
+		uint64_t dependencyHashesOffset;
+		uint64_t stringsOffset;
+	};
+
+	struct archive_t {
+		uint64_t pathString;    // Archive path relative to the base folder, verbatim from the packagemapspec
+		uint64_t fileSize;
+		int64_t  lastWriteTime; // std::filesystem::file_time_type ticks
+		uint64_t maskHash;      // Metadata hash identifying the archive's container mask. See GetContainerMaskHash
+		uint32_t firstEntry;
+		uint32_t numEntries;
+	};
+
+	struct entry_t {
+		uint64_t declHash;      // HashLib::DeclHash(type, name)
+		uint64_t typeString;
+		uint64_t nameString;
+		uint64_t dataOffset;
+		uint64_t dataSize;
+		uint64_t uncompressedSize;
+		uint64_t dataCheckSum;
+		uint64_t generationTimeStamp;
+		uint64_t defaultHash;
+		uint32_t archiveIndex;
+		uint32_t entryIndex;     // Index of the entry within it's archive
+		uint32_t version;
+		uint32_t firstDependency; // Index into the dependency hash list
+		uint16_t numDependencies;
+		uint8_t  compMode;
+		uint8_t  padding;
+		ResourceType resourceType; // Classified type string. rt_unknown for types without an enum
+
+		// Builds an entry with the fields needed to read it's data with Get_EntryData
+		ResourceEntry ToResourceEntry() const;
+	};
+
+	struct dependency_t {
+		uint64_t hash; // HashLib::DeclHash(type, name)
+		uint64_t typeString;
+		uint64_t nameString;
+	};
+
+	struct winner_t {
+		uint64_t declHash;
+		uint32_t entry;
+		uint32_t padding;
+	};
+
+	private:
+	MappedFile* mapping = nullptr;
+	fspath basedir;
+
+	const header_t* header = nullptr;
+	const archive_t* archives = nullptr;
+	const entry_t* entries = nullptr;
+	const winner_t* winners = nullptr;           // Sorted by hash
+	const dependency_t* dependencies = nullptr;  // Sorted by hash
+	const uint64_t* dependencyHashes = nullptr;
+	const char* strings = nullptr;
+
+	bool Map(const fspath& catalogpath);
+	void Unmap();
+
+	public:
+	ResourceCatalog() {}
+	ResourceCatalog(const ResourceCatalog& b) = delete;
+	void operator=(const ResourceCatalog& b) = delete;
+
+	~ResourceCatalog() {
+		Unmap();
+	}
+
+	// Default location of the catalog for a given game installation
+	static fspath DefaultPath(const fspath& gamedir);
+
+	/*
+	* Loads the catalog for the given game installation, first rebuilding it
+	* for any archives that were added, removed, modified or reprioritized.
+	* Returns false if the catalog couldn't be built or loaded
+	*/
+	bool Load(const fspath& gamedir);
+	bool Load(const fspath& gamedir, const fspath& catalogpath);
+
+	uint32_t ArchiveCount() const {return header ? header->numArchives : 0;}
+	uint32_t EntryCount() const {return header ? header->numEntries : 0;}
+
+	const archive_t& Archive(uint32_t index) const {return archives[index];}
+	const entry_t& Entry(uint32_t index) const {return entries[index];}
+	const char* String(uint64_t offset) const {return strings + offset;}
+
+	// Absolute path to the archive
+	fspath ArchivePath(const archive_t& a) const {return basedir / String(a.pathString);}
+
+	// Hashes of an entry's dependencies. Resolve them to strings with FindDependency
+	const uint64_t* EntryDependencies(const entry_t& e) const {return dependencyHashes + e.firstDependency;}
+
+	// Returns the highest-priority copy of a resource, or nullptr if it does not exist
+	const entry_t* FindWinner(uint64_t declhash) const;
+	const entry_t* FindWinner(std::string_view type, std::string_view name) const;
+
+	// Returns nullptr if no resource depends on the given hash
+	const dependency_t* FindDependency(uint64_t hash) const;
+};
@@ -4,6 +4,7 @@ typedef unsigned uint32_t;
 
 enum ResourceType : uint32_t
 {
+	rt_unknown         = 0, // Any type without an enum value
 	rt_rs_streamfile   = 1 << 0,
 	rt_entityDef       = 1 << 1,
 	rt_logicClass      = 1 << 2,
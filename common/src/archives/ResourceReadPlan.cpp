@@ -0,0 +1,47 @@
+#include "ResourceReadPlan.h"
+#include "io/MappedFile.h"
+#include <algorithm>
+
+void ResourceReadPlan::Build(const ResourceArchive& r, const std::vector<uint32_t>& entryindices, uint64_t maxgap, uint64_t maxrange)
+{
+	slices.clear();
+	ranges.clear();
+	totallength = 0;
+
+	slices.reserve(entryindices.size());
+	for(size_t i = 0; i < entryindices.size(); i++)
+		slices.push_back({entryindices[i], static_cast<uint32_t>(i)});
+
+	std::sort(slices.begin(), slices.end(), [&r](const slice_t& a, const slice_t& b) {
+		return r.entries[a.entryindex].dataOffset < r.entries[b.entryindex].dataOffset;
+	});
+
+	for (uint32_t i = 0; i < slices.size(); i++) {
+		const ResourceEntry& e = r.entries[slices[i].entryindex];
+		const uint64_t entryend = e.dataOffset + e.dataSize;
+
+		if (!ranges.empty()) {
+			range_t& current = ranges.back();
+			const uint64_t currentend = current.offset + current.length;
+			const uint64_t mergedend = std::max(currentend, entryend);
+
+			// Entries may overlap or repeat, so the range only grows when an entry extends past it
+			if (e.dataOffset <= currentend + maxgap && mergedend - current.offset <= maxrange) {
+				current.length = mergedend - current.offset;
+				current.numSlices++;
+				continue;
+			}
+		}
+
+		ranges.push_back({e.dataOffset, e.dataSize, i, 1});
+	}
+
+	for (const range_t& range : ranges)
+		totallength += range.length;
+}
+
+void ResourceReadPlan::Prefetch(const MappedFile& mapping) const
+{
+	for(const range_t& range : ranges)
+		mapping.Prefetch(range.offset, range.length);
+}
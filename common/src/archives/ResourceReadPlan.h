@@ -0,0 +1,57 @@
+#pragma once
+#include "ResourceStructs.h"
+#include <vector>
+
+class MappedFile;
+
+/*
+* Schedules the reads for a batch of resource entries
+*
+* Entries are sorted by their offset in the archive, and entries separated by no
+* more than the maximum gap are merged into a single range. Reading range-by-range
+* turns thousands of small random reads into a few large sequential ones, with
+* each entry handed out as a slice of it's range
+*/
+class ResourceReadPlan {
+	public:
+	static const uint64_t DEFAULT_MAX_GAP = 256 * 1024;
+	static const uint64_t DEFAULT_MAX_RANGE = 64 * 1024 * 1024;
+
+	struct slice_t {
+		uint32_t entryindex; // Index of the entry within the archive
+		uint32_t batchindex; // Position of the entry in the list the plan was built from
+	};
+
+	struct range_t {
+		uint64_t offset; // Absolute file offset
+		uint64_t length;
+		uint32_t firstSlice;
+		uint32_t numSlices;
+	};
+
+	private:
+	std::vector<slice_t> slices; // Sorted by data offset
+	std::vector<range_t> ranges;
+	uint64_t totallength = 0;
+
+	public:
+
+	/*
+	* @param maxgap Entries separated by at most this many bytes share a range. Gaps are read and discarded
+	* @param maxrange Ranges stop growing past this length, bounding the read buffer.
+	* An entry larger than this is given a range of it's own
+	*/
+	void Build(const ResourceArchive& r, const std::vector<uint32_t>& entryindices, uint64_t maxgap = DEFAULT_MAX_GAP, uint64_t maxrange = DEFAULT_MAX_RANGE);
+
+	size_t RangeCount() const {return ranges.size();}
+	const range_t& Range(size_t index) const {return ranges[index];}
+
+	size_t SliceCount() const {return slices.size();}
+	const slice_t& Slice(size_t index) const {return slices[index];}
+
+	// Total bytes the plan reads, including gaps
+	uint64_t TotalLength() const {return totallength;}
+
+	// Hints every range to the operating system, so a mapped archive is paged in with large sequential reads
+	void Prefetch(const MappedFile& mapping) const;
+};
@@ -1,10 +1,14 @@
 #include "ResourceStructs.h"
 #include "hash/HashLib.h"
-#include "entityslayer/Oodle.h"
+#include "atlan/AtlanCodec.h"
 #include "io/BinaryReader.h"
+#include "io/MappedFile.h"
+#include "io/BufferedFileWriter.h"
+#include <algorithm>
+#include <vector>
 #include <fstream>
 #include <cassert>
-#include <set>
+#include <string_view>
 
 #ifndef _DEBUG
 #undef assert
@@ -50,7 +54,7 @@ ResourceEntryData_t Get_EntryData_Internal(const ResourceEntry& e, char* raw, ch
 				buffer = new char[e.uncompressedSize];
 				buffersize = e.uncompressedSize;
 			}
-			bool success = Oodle::DecompressBuffer(raw, e.dataSize - (e.compMode == 4 ? 12 : 0), buffer, e.uncompressedSize);
+			bool success = AtlanCodec::Active().Decompress(raw, e.dataSize - (e.compMode == 4 ? 12 : 0), buffer, e.uncompressedSize);
 
 			if(success)
 				return {EntryDataCode::OK, buffer, e.uncompressedSize};
@@ -88,12 +92,217 @@ ResourceEntryData_t Get_EntryData(const ResourceEntry& e, std::ifstream& archive
 	return Get_EntryData(e, archivestream, buffers.raw_buffer, buffers.raw_length, buffers.decomp_buffer, buffers.decomp_length);
 }
 
+ResourceEntryData_t Get_EntryData(const ResourceEntry& e, char* raw, char*& decompbuffer, size_t& decompsize)
+{
+	return Get_EntryData_Internal(e, raw, decompbuffer, decompsize);
+}
+
+ResourceEntryData_t Get_EntryPrefix(const ResourceArchive& r, const ResourceEntry& e, size_t prefixlength, char*& decompbuffer, size_t& decompsize)
+{
+	if (!r.bufferData)
+		return { EntryDataCode::DATA_NOT_READ, nullptr, 0 };
+
+	char* raw = r.bufferData + (e.dataOffset - r.header.dataOffset);
+	if(e.compMode != 2 && e.compMode != 4)
+		return Get_EntryData_Internal(e, raw, decompbuffer, decompsize);
+
+	Codec& codec = AtlanCodec::Active();
+	size_t length = codec.PrefixBufferSize(prefixlength, e.uncompressedSize);
+	if (decompsize < length) {
+		delete[] decompbuffer;
+		decompbuffer = new char[length];
+		decompsize = length;
+	}
+
+	size_t skip = e.compMode == 4 ? 12 : 0;
+	if(codec.DecompressPrefix(raw + skip, e.dataSize - skip, decompbuffer, prefixlength, e.uncompressedSize))
+		return { EntryDataCode::OK, decompbuffer, length };
+
+	// Some streams can't be cut short. Decompressing the whole entry always works
+	return Get_EntryData_Internal(e, raw, decompbuffer, decompsize);
+}
+
+
+ResourceType Get_ResourceType(std::string_view typeString)
+{
+	static const std::unordered_map<std::string_view, ResourceType> typemap = {
+		{"rs_streamfile", rt_rs_streamfile},
+		{"entityDef",     rt_entityDef},
+		{"logicClass",    rt_logicClass},
+		{"logicEntity",   rt_logicEntity},
+		{"logicFX",       rt_logicFX},
+		{"logicLibrary",  rt_logicLibrary},
+		{"logicUIWidget", rt_logicUIWidget},
+		{"mapentities",   rt_mapentities},
+		{"image",         rt_image},
+		{"audio",         rt_audio}
+	};
+
+	const auto iter = typemap.find(typeString);
+	return iter == typemap.end() ? rt_unknown : iter->second;
+}
+
+/*
+* Fills the archive's per-entry type array. Entries share a handful of type strings,
+* so each string index is classified once and the rest are array lookups.
+* Returns false if an entry's type string lies outside the string chunk
+*/
+bool Classify_ResourceArchive(ResourceArchive& r) {
+	r.entryTypes = new ResourceType[r.header.numResources];
+
+	const uint64_t stringBlockSize = r.header.stringTableSize - r.stringChunk.numStrings * sizeof(uint64_t) - sizeof(uint64_t);
+	std::vector<ResourceType> stringtypes(r.stringChunk.numStrings, rt_unknown);
+	std::vector<bool> classified(r.stringChunk.numStrings, false);
 
-void Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags) {
+	for (uint32_t i = 0; i < r.header.numResources; i++) {
+		const ResourceEntry& e = r.entries[i];
+		const uint64_t stringindex = e.strings + e.resourceTypeString;
+		if(stringindex >= r.header.numStringIndices)
+			return false;
+
+		uint64_t typeindex = r.stringIndex[stringindex];
+		if(typeindex >= r.stringChunk.numStrings)
+			return false;
+
+		if (!classified[typeindex]) {
+			if(r.stringChunk.offsets[typeindex] >= stringBlockSize)
+				return false;
+			stringtypes[typeindex] = Get_ResourceType(r.stringChunk.dataBlock + r.stringChunk.offsets[typeindex]);
+			classified[typeindex] = true;
+		}
+		r.entryTypes[i] = stringtypes[typeindex];
+	}
+	return true;
+}
+
+ResourceArchive::~ResourceArchive()
+{
+	delete[] entryTypes;
+
+	// Sections are views into the mapping
+	if (mapping) {
+		delete mapping;
+		return;
+	}
+
+	delete[] bufferData;
+	delete[] entries;
+	delete[] dependencies;
+	delete[] dependencyIndex;
+	delete[] stringIndex;
+	delete[] stringChunk.offsets;
+	delete[] stringChunk.dataBlock;
+}
+
+/*
+* Points every section of the archive into a read-only mapping of the file.
+* Sections are not guaranteed to be 8-byte aligned within the file (version 12
+* archives place the entries 124 bytes in), which x86 tolerates for these structs.
+* Returns false if the file can't be mapped or is too short for the sections it's header describes
+*/
+bool Map_ResourceArchive(ResourceArchive& r, const fspath& pathString, int flags) {
+	r.mapping = new MappedFile(pathString);
+
+	// Pointers into the mapping are typed as mutable to share the owning layout. They must never be written to
+	char* view = const_cast<char*>(r.mapping->data());
+	const size_t length = r.mapping->len();
+
+	// Section pointers must not be mistaken for owned buffers once the mapping is gone
+	auto Fail = [&r]() {
+		delete r.mapping;
+		r.mapping = nullptr;
+		r.header = ResourceHeader();
+		r.entries = nullptr;
+		r.stringChunk = StringChunk();
+		r.dependencies = nullptr;
+		r.dependencyIndex = nullptr;
+		r.stringIndex = nullptr;
+		r.bufferData = nullptr;
+		return false;
+	};
+	auto Fits = [length](uint64_t offset, uint64_t size) {
+		return offset <= length && size <= length - offset;
+	};
+
+	if(!r.mapping->Okay() || length < sizeof(ResourceHeader))
+		return Fail();
+
+	memcpy(&r.header, view, sizeof(ResourceHeader));
+	switch(r.header.version)
+	{
+		case 13:
+		break;
+
+		case 12:
+		if(length < sizeof(ResourceHeader) + sizeof(ResourceMetaHeader))
+			return Fail();
+		memcpy(&r.metaheader, view + sizeof(ResourceHeader), sizeof(ResourceMetaHeader));
+		break;
+
+		default:
+		return Fail();
+	}
+
+	if (flags & RF_HeaderOnly)
+		return true;
+
+	/*
+	* Every section must lie within the file before anything points into it.
+	* The container mask hash reads from the entries through the IDCL magic after the string indices
+	*/
+	const ResourceHeader& h = r.header;
+	const uint64_t metaoffset = Get_ExpectedMetaOffset(h);
+	if (!Fits(h.resourceEntriesOffset, h.numResources * sizeof(ResourceEntry))
+		|| !Fits(h.stringTableOffset, h.stringTableSize) || h.stringTableSize < sizeof(uint64_t)
+		|| h.resourceDepsOffset > metaoffset || h.resourceEntriesOffset > metaoffset || !Fits(metaoffset, 4)
+		|| h.dataOffset > length)
+		return Fail();
+
+	r.entries = reinterpret_cast<ResourceEntry*>(view + r.header.resourceEntriesOffset);
+	if(flags & RF_StopAfterEntries)
+		return true;
+
+	// String Chunk
+	char* stringchunk = view + r.header.stringTableOffset;
+	memcpy(&r.stringChunk.numStrings, stringchunk, sizeof(uint64_t));
+	if(r.stringChunk.numStrings > (r.header.stringTableSize - sizeof(uint64_t)) / sizeof(uint64_t))
+		return Fail();
+	r.stringChunk.offsets = reinterpret_cast<uint64_t*>(stringchunk + sizeof(uint64_t));
+	r.stringChunk.dataBlock = stringchunk + sizeof(uint64_t) + r.stringChunk.numStrings * sizeof(uint64_t);
+
+	// The final string must end inside the block, so no string can be read past it
+	size_t stringBlockSize = r.header.stringTableSize - r.stringChunk.numStrings * sizeof(uint64_t) - sizeof(uint64_t);
+	if(stringBlockSize == 0 || r.stringChunk.dataBlock[stringBlockSize - 1] != '\0')
+		return Fail();
+	while (stringBlockSize > 0 && r.stringChunk.dataBlock[--stringBlockSize] == '\0') {
+		r.stringChunk.paddingCount++;
+	}
+	r.stringChunk.paddingCount--; // We overcount by 1 due to the end string
+
+	// Dependency Data
+	char* depchunk = view + r.header.resourceDepsOffset;
+	r.dependencies = reinterpret_cast<ResourceDependency*>(depchunk);
+	depchunk += r.header.numDependencies * sizeof(ResourceDependency);
+	r.dependencyIndex = reinterpret_cast<uint32_t*>(depchunk);
+	depchunk += r.header.numDepIndices * sizeof(uint32_t);
+	r.stringIndex = reinterpret_cast<uint64_t*>(depchunk);
+	if(!Classify_ResourceArchive(r))
+		return Fail();
+
+	// Mapping the data section costs nothing until it's read
+	r.bufferData = view + r.header.dataOffset;
+	return true;
+}
+
+bool Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags) {
+
+	if (flags & RF_MapFile)
+		return Map_ResourceArchive(r, pathString, flags);
 
 	// Read the Header
 	std::ifstream opener(pathString, std::ios_base::binary);
-	assert(opener.good());
+	if(!opener.good())
+		return false;
 	opener.read(reinterpret_cast<char*>(&r.header), sizeof(ResourceHeader));
 
 	switch(r.header.version)
@@ -110,7 +319,7 @@ void Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags
 	}
 
 	if (flags & RF_HeaderOnly)
-		return;
+		return true;
 
 
 	// Read the Resource Entries
@@ -118,7 +327,7 @@ void Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags
 	opener.seekg(r.header.resourceEntriesOffset);
 	opener.read(reinterpret_cast<char*>(r.entries), r.header.numResources * sizeof(ResourceEntry));
 	if(flags & RF_StopAfterEntries)
-		return;
+		return true;
 
 
 	// Read the String Chunk
@@ -150,11 +359,13 @@ void Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags
 	opener.read(reinterpret_cast<char*>(r.dependencies), r.header.numDependencies * sizeof(ResourceDependency));
 	opener.read(reinterpret_cast<char*>(r.dependencyIndex), r.header.numDepIndices * sizeof(uint32_t));
 	opener.read(reinterpret_cast<char*>(r.stringIndex), r.header.numStringIndices * sizeof(uint64_t));
+	if(!Classify_ResourceArchive(r))
+		return false;
 
 	// TODO: must take note of IDCL size - develop assert for it
 	// TODO: Account for location of data now being = file_offset - data_offset
 	if (flags & RF_SkipData)
-		return;
+		return true;
 
 	// Determine size of data block
 	opener.seekg(0, std::ios_base::beg);
@@ -165,6 +376,69 @@ void Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags
 	// Read the data block
 	r.bufferData = new char[fileLength - r.header.dataOffset];
 	opener.read(r.bufferData, fileLength - r.header.dataOffset);
+	return true;
+}
+
+bool Write_ResourceArchive(const ResourceArchive& r, const fspath outpath, const char* const* entries)
+{
+	const ResourceHeader& h = r.header;
+	BufferedFileWriter output;
+	if(!output.Open(outpath))
+		return false;
+
+	output.Write(reinterpret_cast<const char*>(&h), sizeof(ResourceHeader));
+	if (h.version == 12) {
+		output.Write(reinterpret_cast<const char*>(&r.metaheader), sizeof(ResourceMetaHeader));
+	}
+
+	output.PadTo(h.resourceEntriesOffset);
+	output.Write(reinterpret_cast<const char*>(r.entries), h.numResources * sizeof(ResourceEntry));
+
+	// The string block we read includes it's padding
+	const size_t stringBlockSize = h.stringTableSize - r.stringChunk.numStrings * sizeof(uint64_t) - sizeof(uint64_t);
+	output.PadTo(h.stringTableOffset);
+	output.Write(reinterpret_cast<const char*>(&r.stringChunk.numStrings), sizeof(uint64_t));
+	output.Write(reinterpret_cast<const char*>(r.stringChunk.offsets), r.stringChunk.numStrings * sizeof(uint64_t));
+	output.Write(r.stringChunk.dataBlock, stringBlockSize);
+
+	output.PadTo(h.resourceDepsOffset);
+	output.Write(reinterpret_cast<const char*>(r.dependencies), h.numDependencies * sizeof(ResourceDependency));
+	output.Write(reinterpret_cast<const char*>(r.dependencyIndex), h.numDepIndices * sizeof(uint32_t));
+	output.Write(reinterpret_cast<const char*>(r.stringIndex), h.numStringIndices * sizeof(uint64_t));
+	output.Write("IDCL", 4);
+	output.PadTo(h.dataOffset);
+
+	if (entries == nullptr) {
+		if (!r.bufferData) {
+			output.Close();
+			return false;
+		}
+
+		uint64_t dataEnd = h.dataOffset;
+		if (r.mapping) {
+			dataEnd = r.mapping->len();
+		}
+		else for (uint32_t i = 0; i < h.numResources; i++) {
+			dataEnd = std::max(dataEnd, r.entries[i].dataOffset + r.entries[i].dataSize);
+		}
+		output.Write(r.bufferData, dataEnd - h.dataOffset);
+	}
+	else {
+		// Sequential writes need the data blocks in file order
+		std::vector<uint32_t> order(h.numResources);
+		for(uint32_t i = 0; i < h.numResources; i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&r](uint32_t a, uint32_t b) {return r.entries[a].dataOffset < r.entries[b].dataOffset;});
+
+		for (uint32_t i : order) {
+			const ResourceEntry& e = r.entries[i];
+			if(!output.PadTo(e.dataOffset))
+				break;
+			output.Write(entries[i], e.dataSize);
+		}
+	}
+
+	return output.Close();
 }
 
 void Audit_ResourceHeader(const ResourceHeader& h, const ResourceMetaHeader& metaheader)
@@ -203,10 +477,6 @@ void Audit_ResourceHeader(const ResourceHeader& h, const ResourceMetaHeader& met
 void Audit_ResourceArchive(const ResourceArchive& r) {
 	Audit_ResourceHeader(r.header, r.metaheader);
 
-	const std::set<std::string> logictypes = {
-		"logicClass", "logicEntity", "logicFX", "logicLibrary", "logicUIWidget"
-	};
-
 	// Insure string indices are in-bounds
 	for (uint32_t i = 0; i < r.header.numStringIndices; i++) {
 		uint64_t stringIndex = r.stringIndex[i];
@@ -230,8 +500,7 @@ void Audit_ResourceArchive(const ResourceArchive& r) {
 	for (uint64_t i = 0; i < r.header.numResources; i++) {
 
 		const ResourceEntry& e = r.entries[i];
-		const char *typeString = nullptr, *nameString = nullptr;
-		Get_EntryStrings(r, e, typeString, nameString);
+		const ResourceType type = r.entryTypes[i];
 
 		assert(e.resourceTypeString == 0);
 		assert(e.nameString == 1);
@@ -275,7 +544,7 @@ void Audit_ResourceArchive(const ResourceArchive& r) {
 		* - numDependencies     - CHECK BY FILE TYPE
 		*/
 
-		if(strcmp(typeString, "rs_streamfile") == 0) {
+		if(type == rt_rs_streamfile) {
 			assert(e.dataSize == e.uncompressedSize);
 			assert(e.dataCheckSum == e.defaultHash);
 			assert(e.version == 0);
@@ -284,7 +553,7 @@ void Audit_ResourceArchive(const ResourceArchive& r) {
 			assert(e.variation == 0);
 			assert(e.numDependencies == 0);
 		}
-		else if(strcmp(typeString, "entityDef") == 0) {
+		else if(type == rt_entityDef) {
 			//assert(e.dataSize != e.uncompressedSize);
 			assert(e.dataCheckSum == e.defaultHash);
 			assert(e.version == 21);
@@ -293,7 +562,7 @@ void Audit_ResourceArchive(const ResourceArchive& r) {
 			assert(e.variation == 70);
 			//assert(e.numDependencies == 0);
 		}
-		else if (strcmp(typeString, "image") == 0) {
+		else if (type == rt_image) {
 			assert(e.numDependencies == 1 || e.numDependencies == 0);
 			if(e.numDependencies == 1)
 				assert(e.defaultHash != e.dataCheckSum);
@@ -306,14 +575,14 @@ void Audit_ResourceArchive(const ResourceArchive& r) {
 			//if(e.flags == 1)
 			//	 printf("%s\n", nameString);
 		}
-		else if (strcmp(typeString, "mapentities") == 0) {
+		else if (type == rt_mapentities) {
 			//if(e.compMode == 0)
 			assert(e.dataCheckSum != e.defaultHash);
 			assert(e.version == 81 || e.version == 80 || e.version == 77);
 			assert(e.flags == 2);
 			assert(e.variation == 70);
 		}
-		else if (logictypes.count(typeString) > 0) {
+		else if (type & rtc_logic_decl) {
 			//printf("%s\n", typeString);
 			assert(e.dataCheckSum == e.defaultHash);
 			assert(e.version == 4);
@@ -332,9 +601,10 @@ void idclMaskFile::Read(const fspath gamedir)
 {
 	// Read the container mask blob into memory
 	{
+		// Leaves maskcount at 0 if the archive can't be read
 		ResourceArchive meta;
-		Read_ResourceArchive(meta, gamedir / "base" / "meta.resources", RF_ReadEverything);
-		assert(meta.header.numResources == 1);
+		if(!Read_ResourceArchive(meta, gamedir / "base" / "meta.resources", RF_MapFile) || meta.header.numResources != 1)
+			return;
 
 		char* decompbuffer = nullptr;
 		size_t decompsize = 0;
@@ -360,6 +630,8 @@ void idclMaskFile::Read(const fspath gamedir)
 		}
 
 		masks = new idclMaskFile::entry[maskcount];
+		maskindex.clear();
+		maskindex.reserve(maskcount);
 		for (uint32_t i = 0; i < maskcount; i++) {
 			idclMaskFile::entry& e = masks[i];
 
@@ -368,6 +640,7 @@ void idclMaskFile::Read(const fspath gamedir)
 			reader.ReadBytes(e.mask, e.size * sizeof(uint64_t));
 
 			e.size *= 64; // Convert mask size to bits
+			maskindex.emplace(e.hash, i); // First mask wins, as with a linear search
 		}
 		assert(reader.GetRemaining() == 0);
 	}
@@ -375,14 +648,28 @@ void idclMaskFile::Read(const fspath gamedir)
 
 const idclMaskFile::entry idclMaskFile::FindArchiveMask(const fspath archivepath)
 {
-	containerMaskEntry_t entry = GetContainerMaskHash(archivepath);
+	return FindMask(GetContainerMaskHash(archivepath).hash);
+}
 
-	for (uint32_t i = 0; i < maskcount; i++) {
-		if(masks[i].hash == entry.hash)
-			return masks[i];
-	}
+uint64_t GetContainerMaskHash(const char* metadata, size_t length) {
+	assert(metadata[length - 1] == 'L');
+	assert(metadata[length - 2] == 'C');
+	assert(metadata[length - 3] == 'D');
+	assert(metadata[length - 4] == 'I');
+	return HashLib::FarmHash64(metadata, length);
+}
+
+containerMaskEntry_t GetContainerMaskHash(const ResourceArchive& r) {
+	assert(r.mapping);
+	const ResourceHeader& h = r.header;
 
-	return idclMaskFile::entry();
+	size_t start = h.resourceEntriesOffset; // Assumes entries follow the header
+	size_t end = Get_ExpectedMetaOffset(h) + 4;
+
+	containerMaskEntry_t entrydata;
+	entrydata.hash = GetContainerMaskHash(r.mapping->data() + start, end - start);
+	entrydata.numResources = h.numResources;
+	return entrydata;
 }
 
 containerMaskEntry_t GetContainerMaskHash(const fspath archivepath) {
@@ -399,12 +686,8 @@ containerMaskEntry_t GetContainerMaskHash(const fspath archivepath) {
 
 	input.seekg(start, std::ios_base::beg);
 	input.read(buffer, len);
-	assert(buffer[len - 1] == 'L');
-	assert(buffer[len - 2] == 'C');
-	assert(buffer[len - 3] == 'D');
-	assert(buffer[len - 4] == 'I');
 
-	uint64_t hash = HashLib::FarmHash64(buffer, len);
+	uint64_t hash = GetContainerMaskHash(buffer, len);
 	delete[] buffer;
 
 	containerMaskEntry_t entrydata;
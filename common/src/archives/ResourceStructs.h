@@ -1,8 +1,12 @@
 #pragma once
 #include <filesystem>
 #include <iosfwd>
+#include <string_view>
+#include <unordered_map>
+#include "ResourceEnums.h"
 
 typedef std::filesystem::path fspath;
+class MappedFile;
 
 typedef unsigned char uint8_t;
 typedef unsigned short uint16_t;
@@ -92,7 +96,13 @@ struct ResourceDependency {
 	//uint64_t hashOrTimestamp;
 };
 
+/*
+* Archives read with RF_MapFile do not own their sections. Every pointer
+* below is a read-only view into the memory-mapped file, which is released
+* alongside the archive. Archives read without the flag own a copy of each section.
+*/
 struct ResourceArchive {
+	MappedFile* mapping = nullptr;
 	char* bufferData = nullptr;
 
 	ResourceHeader     header;
@@ -105,15 +115,11 @@ struct ResourceArchive {
 	uint32_t* dependencyIndex = nullptr; // header.numDepIndices
 	uint64_t* stringIndex = nullptr; // header.numStringIndices
 
-	~ResourceArchive() {
-		delete[] bufferData;
-		delete[] entries;
-		delete[] dependencies;
-		delete[] dependencyIndex;
-		delete[] stringIndex;
-		delete[] stringChunk.offsets;
-		delete[] stringChunk.dataBlock;
-	}
+	// Type of each entry, classified once from the string table. Size: header.numResources
+	// Always owned by the archive, even in RF_MapFile mode
+	ResourceType* entryTypes = nullptr;
+
+	~ResourceArchive();
 };
 
 struct containerMaskEntry_t {
@@ -123,6 +129,12 @@ struct containerMaskEntry_t {
 
 containerMaskEntry_t GetContainerMaskHash(const fspath archivepath);
 
+// Hashes the metadata of an archive read with RF_MapFile, without reopening the file
+containerMaskEntry_t GetContainerMaskHash(const ResourceArchive& r);
+
+// Hashes an archive's metadata span: the resource entries through to the end of the "IDCL" marker
+uint64_t GetContainerMaskHash(const char* metadata, size_t length);
+
 struct idclMaskFile {
 
 	struct entry {
@@ -142,6 +154,8 @@ struct idclMaskFile {
 
 	char* maskblob = nullptr; // Raw container mask data
 	size_t masksize = 0; // Container mask size
+
+	std::unordered_map<uint64_t, uint32_t> maskindex; // Archive metadata hash -> index into masks
 	
 	~idclMaskFile(){
 		delete[] maskblob;
@@ -153,6 +167,13 @@ struct idclMaskFile {
 	// Finds the container mask for a given archive.
 	// Returns an entry with hash == 0 if a container mask could not be found
 	const idclMaskFile::entry FindArchiveMask(const fspath archivepath);
+
+	// Finds the container mask for an archive's metadata hash (See GetContainerMaskHash)
+	// Returns an entry with hash == 0 if a container mask could not be found
+	const idclMaskFile::entry FindMask(uint64_t archivehash) const {
+		const auto iter = maskindex.find(archivehash);
+		return iter == maskindex.end() ? idclMaskFile::entry() : masks[iter->second];
+	}
 };
 
 void Audit_ResourceHeader(const ResourceHeader& h, const ResourceMetaHeader& metaheader);
@@ -162,20 +183,30 @@ enum ResourceFlags {
 	RF_ReadEverything = 0,
 	RF_SkipData = 1 << 0,
 	RF_HeaderOnly = 1 << 1,
-	RF_StopAfterEntries = 1 << 2
+	RF_StopAfterEntries = 1 << 2,
+
+	// Memory-map the archive instead of copying its sections into owned buffers.
+	// The data section is always available in this mode, so RF_SkipData is ignored
+	RF_MapFile = 1 << 3
 };
 
-void Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags);
+// Returns false if the archive can't be opened, or with RF_MapFile, if it's sections lie outside the file
+bool Read_ResourceArchive(ResourceArchive& r, const fspath pathString, int flags);
 
 
 /*
-* Writes the given archive to a file
+* Writes the given archive to a file, with every section at the offset given by it's header.
+* To build a new archive, use ResourceArchiveWriter instead
 * @param entries A list of buffers, one per resource entry. If nullptr, will write out the archive's data buffer instead
+* Returns false if the file could not be written
 */
-//void Write_ResourceArchive(const ResourceArchive& r, const fspath outpath, char** entries);
+bool Write_ResourceArchive(const ResourceArchive& r, const fspath outpath, const char* const* entries);
 
 void Get_EntryStrings(const ResourceArchive& r, const ResourceEntry& e, const char*& typeString, const char*& nameString);
 
+// Returns the enum for a resource type string, or rt_unknown
+ResourceType Get_ResourceType(std::string_view typeString);
+
 void Get_DependencyStrings(const ResourceArchive& r, const ResourceDependency& d, const char*& typestring, const char*& namestring);
 
 // Returns the offset where we *should* find the magic "IDCL" that denotes
@@ -225,9 +256,10 @@ struct ResourceEntryData_t {
 
 /*
 * Returns the correctly decompressed data for a given resource entry.
-* Resource Archive must have it's data section read to memory
+* Resource Archive must have it's data section read to memory, or be read with RF_MapFile
 *
-* If data is uncompressed or compression is unknown, returns a pointer within the archive's data buffer
+* If data is uncompressed or compression is unknown, returns a pointer within the archive's data buffer.
+* For mapped archives this is a pointer into the mapping - no copy is made
 *
 * If data is compressed, it will be decompressed to the provided dynamically allocated buffer.
 * If the provided buffer is too small, it will be deallocated and replaced with a new buffer to hold the data
@@ -250,4 +282,21 @@ ResourceEntryData_t Get_EntryData(const ResourceArchive& r, const ResourceEntry&
 */
 ResourceEntryData_t Get_EntryData(const ResourceEntry& e, std::ifstream& archivestream, char*& raw, size_t& rawsize, char*& decomp, size_t& decompsize);
 
-ResourceEntryData_t Get_EntryData(const ResourceEntry& e, std::ifstream& archivestream, ResourceEntryBuffers_t& buffers);
\ No newline at end of file
+ResourceEntryData_t Get_EntryData(const ResourceEntry& e, std::ifstream& archivestream, ResourceEntryBuffers_t& buffers);
+
+/*
+* Returns the correctly decompressed data for a given resource entry, from it's raw data
+* that has already been read to memory (i.e. as part of a larger read)
+*
+* @param raw Start of the entry's dataSize bytes
+*/
+ResourceEntryData_t Get_EntryData(const ResourceEntry& e, char* raw, char*& decompbuffer, size_t& decompsize);
+
+/*
+* Returns the start of a resource entry's decompressed data, for readers that only need it's header.
+* Decompression stops as soon as the codec allows once prefixlength bytes are produced.
+* The returned length is at least prefixlength, unless the entry is smaller
+*
+* Buffers follow the same rules as the other Get_EntryData functions
+*/
+ResourceEntryData_t Get_EntryPrefix(const ResourceArchive& r, const ResourceEntry& e, size_t prefixlength, char*& decompbuffer, size_t& decompsize);
\ No newline at end of file
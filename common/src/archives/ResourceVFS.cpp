@@ -0,0 +1,95 @@
+#include "ResourceVFS.h"
+#include "hash/HashLib.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define VFS_PREFETCH(ADDR) _mm_prefetch(reinterpret_cast<const char*>(ADDR), _MM_HINT_T0)
+#else
+#define VFS_PREFETCH(ADDR) ((void)(ADDR))
+#endif
+
+// Number of lookups to keep in flight ahead of the resolving loop
+#define VFS_PREFETCH_DISTANCE 16
+
+bool ResourceVFS::Build(const fspath& gamedir)
+{
+	table.clear();
+	resolvedcount = 0;
+
+	if(!catalog.Load(gamedir))
+		return false;
+
+	containerMask.Read(gamedir);
+	if(containerMask.maskcount == 0)
+		return false;
+
+	// Power of two capacity, at most half full
+	uint64_t capacity = 16;
+	while(capacity < static_cast<uint64_t>(catalog.EntryCount()) * 2)
+		capacity *= 2;
+	table.assign(capacity, {0, UINT32_MAX, 0});
+	tablemask = capacity - 1;
+
+	for (uint32_t archiveindex = 0; archiveindex < catalog.ArchiveCount(); archiveindex++) {
+		const ResourceCatalog::archive_t& a = catalog.Archive(archiveindex);
+
+		// A select few resource archives don't have a container mask blob. This is normal
+		const idclMaskFile::entry bitmask = containerMask.FindMask(a.maskHash);
+		const bool hasBitmask = bitmask.size >= a.numEntries;
+
+		for (uint32_t k = a.firstEntry; k < a.firstEntry + a.numEntries; k++) {
+			const ResourceCatalog::entry_t& e = catalog.Entry(k);
+			const bool isloaded = hasBitmask ? bitmask.IsLoaded(e.entryIndex) : true;
+
+			uint64_t i = e.declHash & tablemask;
+			while (table[i].entry != UINT32_MAX && table[i].declHash != e.declHash)
+				i = (i + 1) & tablemask;
+
+			slot_t& s = table[i];
+			if (s.entry == UINT32_MAX) {
+				s = {e.declHash, k, isloaded};
+				resolvedcount++;
+			}
+
+			// Rare Edge Case: A higher-priority copy of the file is disabled by the container mask
+			// but a lower-priority copy is enabled. The enabled copy is assumed to be more accurate.
+			// MONITOR: If all copies of a file are disabled, there's no real way to determine which is the most
+			// "up-to-date" version. Best we can do is go in order of archive priority.
+			else if (isloaded && !s.isLoaded) {
+				s.entry = k;
+				s.isLoaded = 1;
+			}
+		}
+	}
+	return true;
+}
+
+const ResourceCatalog::entry_t* ResourceVFS::Find(std::string_view type, std::string_view name) const
+{
+	return Find(HashLib::DeclHash(type, name));
+}
+
+void ResourceVFS::Prefetch(uint64_t declhash) const
+{
+	if(!table.empty())
+		VFS_PREFETCH(&table[declhash & tablemask]);
+}
+
+void ResourceVFS::FindBatch(const uint64_t* hashes, size_t count, const ResourceCatalog::entry_t** results) const
+{
+	if (table.empty()) {
+		for(size_t i = 0; i < count; i++)
+			results[i] = nullptr;
+		return;
+	}
+
+	size_t ahead = count < VFS_PREFETCH_DISTANCE ? count : VFS_PREFETCH_DISTANCE;
+	for(size_t i = 0; i < ahead; i++)
+		VFS_PREFETCH(&table[hashes[i] & tablemask]);
+
+	for (size_t i = 0; i < count; i++) {
+		if(i + VFS_PREFETCH_DISTANCE < count)
+			VFS_PREFETCH(&table[hashes[i + VFS_PREFETCH_DISTANCE] & tablemask]);
+		results[i] = Find(hashes[i]);
+	}
+}
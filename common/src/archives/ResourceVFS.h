@@ -0,0 +1,78 @@
+#pragma once
+#include "ResourceCatalog.h"
+#include <vector>
+#include <cstdint>
+
+/*
+* Priority-resolved view of every resource in the game
+*
+* Combines the resource catalog (prioritized archives from the packagemapspec)
+* with the container mask into a flat open-addressing hash table. Each
+* DeclHash(type, name) resolves to the copy of the resource the game loads:
+* the highest-priority copy enabled by the container mask. If every copy is
+* disabled by the mask, the highest-priority copy is used instead.
+*/
+class ResourceVFS {
+	private:
+	struct slot_t {
+		uint64_t declHash;
+		uint32_t entry;    // Index of the catalog entry. UINT32_MAX if the slot is empty
+		uint32_t isLoaded; // Container mask enables this copy
+	};
+
+	ResourceCatalog catalog;
+	idclMaskFile containerMask;
+	std::vector<slot_t> table;
+	uint64_t tablemask = 0;
+	size_t resolvedcount = 0;
+
+	const slot_t* FindSlot(uint64_t declhash) const {
+		if(table.empty()) // Never built, or the build failed
+			return nullptr;
+
+		uint64_t i = declhash & tablemask;
+		while (table[i].entry != UINT32_MAX) {
+			if(table[i].declHash == declhash)
+				return &table[i];
+			i = (i + 1) & tablemask;
+		}
+		return nullptr;
+	}
+
+	public:
+
+	/*
+	* Loads the resource catalog and container mask for the given game installation
+	* and resolves every resource. Returns false if either could not be read
+	*/
+	bool Build(const fspath& gamedir);
+
+	const ResourceCatalog& Catalog() const {return catalog;}
+	const idclMaskFile& ContainerMask() const {return containerMask;}
+
+	// Number of unique resources
+	size_t Count() const {return resolvedcount;}
+
+	// Returns the resolved copy of a resource, or nullptr if it does not exist
+	const ResourceCatalog::entry_t* Find(uint64_t declhash) const {
+		const slot_t* s = FindSlot(declhash);
+		return s ? &catalog.Entry(s->entry) : nullptr;
+	}
+
+	const ResourceCatalog::entry_t* Find(std::string_view type, std::string_view name) const;
+
+	// Returns true if the given catalog entry is the resolved copy of it's resource
+	bool IsResolved(uint32_t catalogentry) const {
+		const slot_t* s = FindSlot(catalog.Entry(catalogentry).declHash);
+		return s && s->entry == catalogentry;
+	}
+
+	// Requests the table slot for a hash be brought into cache ahead of a lookup
+	void Prefetch(uint64_t declhash) const;
+
+	/*
+	* Resolves a batch of hashes, prefetching table slots ahead of each lookup
+	* @param results Receives one entry per hash, or nullptr for hashes that don't exist
+	*/
+	void FindBatch(const uint64_t* hashes, size_t count, const ResourceCatalog::entry_t** results) const;
+};
@@ -167,6 +167,9 @@ struct ImageHeader {
     // (This is not read/written to the file, it's here for convenience because of optional flags)
     u32 HEADER_LENGTH; 
 
+    // Largest header length of any version. Only this many bytes of an image need to be decompressed to read it's header
+    static const size_t MAX_LENGTH = 64;
+
     bool Read(const char* data, const size_t length);
 
     void tostring(std::string& addto) const;
@@ -212,6 +215,7 @@ bool idImageHeaderMap_Build(idImageHeaderMap_t& map, const std::string& gamedir)
 
 struct ID3D11Device;
 struct ID3D11DeviceContext;
+class AtlanCompressionCache;
 enum D3D_FEATURE_LEVEL : int;
 
 struct idImageEncodingResults {
@@ -231,6 +235,7 @@ struct idImageEncodingContext {
     ID3D11DeviceContext* m_context = nullptr;
     D3D_FEATURE_LEVEL    m_featurelevel;
     idImageHeaderMap_t   m_headermap;
+    AtlanCompressionCache* m_cache = nullptr; // Optional. Reuses mip compression results across runs
     
     bool InitializeContext(const std::string& gamedir, int in_CompressionLevel);
     bool EncodeImage(const std::string& AssetPath, const std::string& EncodingInfo, const wchar_t* FilePath, idImageEncodingResults& results, std::string& OutputLog) const;
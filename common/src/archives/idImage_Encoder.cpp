@@ -6,7 +6,8 @@
 
 #include "idImage.h"
 #include "atlan/AtlanLogger.h"
-#include "entityslayer/Oodle.h"
+#include "atlan/AtlanCodec.h"
+#include "atlan/AtlanCompressionCache.h"
 #include "io/BinaryWriter.h"
 
 #ifdef _DEBUG
@@ -402,17 +403,21 @@ bool idImageEncodingContext::EncodeImage(const std::string& AssetPath, const std
 
 		// Some jank to avoid needing to copy the compressed data into the writer
 		// from a separate buffer
-		writer.EnsureAvailable(m.decompressedSize);
+		Codec& codec = AtlanCodec::Active();
+		size_t compressedCapacity = codec.CompressBound(m.decompressedSize);
+		writer.EnsureAvailable(compressedCapacity);
 		char* writeTo = writer.GetEditableNext();
 		
-		int OodleResult = Oodle::CompressBuffer((char*)mipimage->pixels, m.decompressedSize, writeTo, m_CompressionLevel);
-		if (OodleResult == 0) {
-			OutputLog.append("   ERROR: Failed to Oodle compress mip level ");
+		size_t compressedSize = 0;
+		bool compressed = m_cache ? m_cache->Compress(codec, (const char*)mipimage->pixels, m.decompressedSize, writeTo, compressedCapacity, compressedSize, m_CompressionLevel)
+			: codec.Compress((const char*)mipimage->pixels, m.decompressedSize, writeTo, compressedCapacity, compressedSize, m_CompressionLevel);
+		if (!compressed) {
+			OutputLog.append("   ERROR: Failed to compress mip level ");
 			OutputLog.append(std::to_string(i));
 			OutputLog.append("\n");
 			return false;
 		}
-		m.compressedSize = (u32)OodleResult;
+		m.compressedSize = (u32)compressedSize;
 		m.cumulativeSizeStreamDB = cumulativeSum;
 		cumulativeSum += m.compressedSize;
 		writer.AddBytes(m.compressedSize);
@@ -485,61 +490,109 @@ bool idAtlanImage::Read(const uint8_t* data, size_t length) {
 }
 
 #include "ResourceStructs.h"
-#include "PackageMapSpec.h"
+#include "ResourceCatalog.h"
 #include <fstream>
+#include <vector>
+#include <atomic>
+#include <thread>
 
 bool idImageHeaderMap_Build(idImageHeaderMap_t& HEADER_MAP, const std::string& gamedir)
 {
 	// TODO: The container mask is not accounted for in this
 	// Will need to monitor for any edge cases of textures not loading properly
 	HEADER_MAP.reserve(45000);
-	std::vector<std::string> ARCHIVE_LIST = PackageMapSpec::GetPrioritizedArchiveList(gamedir, false);
-	const fspath BASE_DIR = fspath(gamedir) / "base";
 
-	ResourceEntryBuffers_t entrybuffers;
+	ResourceCatalog CATALOG;
+	if(!CATALOG.Load(gamedir))
+		return false;
+
+	// Only the headers are needed, so each archive's entries take little work to read.
+	// Claims are made in priority order first, then the archives are read in parallel
+	struct headerbatch_t {
+		uint32_t archiveindex;
+		std::vector<uint32_t> entries;
+		std::vector<ImageHeader*> headers;
+	};
+	std::vector<headerbatch_t> BATCHES;
+	std::atomic<bool> BATCH_OKAY = true;
 
-	const char* TypeString = nullptr, *NameString = nullptr;
 	std::string NameStringSTD;
 
-	for (const std::string& ARCHIVE_NAME : ARCHIVE_LIST) {
-		const fspath ARCHIVE_PATH = BASE_DIR / ARCHIVE_NAME;
-		ResourceArchive r;
-		Read_ResourceArchive(r, ARCHIVE_PATH, RF_SkipData);
+	for (uint32_t ARCHIVE_INDEX = 0; ARCHIVE_INDEX < CATALOG.ArchiveCount(); ARCHIVE_INDEX++) {
+		const ResourceCatalog::archive_t& ARCHIVE = CATALOG.Archive(ARCHIVE_INDEX);
 
-		std::ifstream DATA_READER(ARCHIVE_PATH, std::ios_base::binary);
+		headerbatch_t& BATCH = BATCHES.emplace_back();
+		BATCH.archiveindex = ARCHIVE_INDEX;
 
-		for (uint32_t i = 0; i < r.header.numResources; i++) {
+		for (uint32_t i = ARCHIVE.firstEntry; i < ARCHIVE.firstEntry + ARCHIVE.numEntries; i++) {
 			
-			const ResourceEntry& e = r.entries[i];
-			Get_EntryStrings(r, e, TypeString, NameString);
+			const ResourceCatalog::entry_t& e = CATALOG.Entry(i);
 
-			if(strcmp(TypeString, "image") != 0)
+			if(e.resourceType != rt_image)
 				continue;
 
 			if (e.uncompressedSize == 0) {
-				//printf("%s\n", NameString);
+				//printf("%s\n", CATALOG.String(e.nameString));
 				continue;
 			}
 
-			NameStringSTD = NameString;
+			NameStringSTD = CATALOG.String(e.nameString);
 
-			if (HEADER_MAP.find(NameStringSTD) != HEADER_MAP.end()) {
+			// Higher-priority archives claim the name first
+			const auto& tryresult = HEADER_MAP.try_emplace(NameStringSTD);
+			if (!tryresult.second) {
 				continue;
 			}
 
-			ResourceEntryData_t entrydata = Get_EntryData(e, DATA_READER, entrybuffers);
-			if (entrydata.returncode != EntryDataCode::OK) {
-				return false;
-			}
+			BATCH.entries.push_back(e.entryIndex);
+			BATCH.headers.push_back(&tryresult.first->second);
+		}
 
-			ImageHeader imgheader;
-			if(!imgheader.Read(entrydata.buffer, entrydata.length))
-				return false;
+		if(BATCH.entries.empty())
+			BATCHES.pop_back();
+	}
+
+	// Map nodes are never relocated, so the header pointers stay valid
+	std::atomic<size_t> NEXT_BATCH = 0;
+	auto HeaderThread = [&]() {
+		char* buffer = nullptr;
+		size_t buffersize = 0;
+
+		for (size_t b = NEXT_BATCH++; b < BATCHES.size() && BATCH_OKAY; b = NEXT_BATCH++) {
+			const headerbatch_t& BATCH = BATCHES[b];
+
+			ResourceArchive r;
+			if (!Read_ResourceArchive(r, CATALOG.ArchivePath(CATALOG.Archive(BATCH.archiveindex)), RF_MapFile)) {
+				BATCH_OKAY = false;
+				break;
+			}
 
-			HEADER_MAP[NameStringSTD] = imgheader;
+			for (size_t i = 0; i < BATCH.entries.size(); i++) {
+				ResourceEntryData_t data = Get_EntryPrefix(r, r.entries[BATCH.entries[i]], ImageHeader::MAX_LENGTH, buffer, buffersize);
+				if (data.returncode != EntryDataCode::OK || !BATCH.headers[i]->Read(data.buffer, data.length)) {
+					BATCH_OKAY = false;
+					break;
+				}
+			}
 		}
-		
-	}
+		delete[] buffer;
+	};
+
+	size_t THREAD_COUNT = std::thread::hardware_concurrency();
+	if(THREAD_COUNT == 0)
+		THREAD_COUNT = 4;
+	if(THREAD_COUNT > BATCHES.size())
+		THREAD_COUNT = BATCHES.size();
+
+	std::vector<std::thread> THREADS;
+	for(size_t i = 1; i < THREAD_COUNT; i++)
+		THREADS.emplace_back(HeaderThread);
+	HeaderThread();
+	for(std::thread& t : THREADS)
+		t.join();
+
+	if(!BATCH_OKAY)
+		return false;
 
 	return HEADER_MAP.size() > 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,219 @@
+#include "AtlanCodec.h"
+#include "entityslayer/Oodle.h"
+#include "miniz/miniz.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/*
+* Oodle Leviathan, loaded from the Oodle core library at runtime
+*/
+class OodleCodec : public Codec {
+	public:
+	const char* Name() const override {
+		return "oodle";
+	}
+
+	bool Init() override {
+		return Oodle::IsInitialized() || Oodle::init();
+	}
+
+	size_t CompressBound(size_t inputlength) const override {
+		// Oodle can expand incompressible data by a small amount per block
+		return inputlength + inputlength / 64 + 65536;
+	}
+
+	size_t CompressScratchSize(size_t inputlength) const override {
+		return Oodle::CompressScratchSize(inputlength, 4);
+	}
+
+	size_t DecompressScratchSize(size_t outputlength) const override {
+		return Oodle::DecompressScratchSize(outputlength);
+	}
+
+	bool Recognizes(const char* input, size_t inputlength) const override {
+		return inputlength > 0 && static_cast<unsigned char>(input[0]) == 0x8C;
+	}
+
+	bool Compress(const char* input, size_t inputlength, char* output, size_t outputcapacity, size_t& outputlength, int level) override {
+		if(outputcapacity < CompressBound(inputlength))
+			return false;
+
+		// Oodle's signatures aren't const correct, but inputs are never written to
+		int result = Oodle::CompressBuffer(const_cast<char*>(input), inputlength, output, level < 0 ? 4 : level);
+		if(result <= 0)
+			return false;
+		outputlength = static_cast<size_t>(result);
+		return true;
+	}
+
+	bool Decompress(const char* input, size_t inputlength, char* output, size_t outputlength) override {
+		return Oodle::DecompressBuffer(const_cast<char*>(input), inputlength, output, outputlength);
+	}
+
+	// Oodle streams are split into independently sized blocks. Decoding can stop at any block boundary
+	static const size_t BLOCK_LENGTH = 256 * 1024;
+
+	size_t PrefixBufferSize(size_t prefixlength, size_t outputlength) const override {
+		size_t blocks = (prefixlength + BLOCK_LENGTH - 1) / BLOCK_LENGTH;
+		return blocks * BLOCK_LENGTH < outputlength ? blocks * BLOCK_LENGTH : outputlength;
+	}
+
+	bool DecompressPrefix(const char* input, size_t inputlength, char* output, size_t prefixlength, size_t outputlength) override {
+		return Oodle::DecompressBuffer(const_cast<char*>(input), inputlength, output, PrefixBufferSize(prefixlength, outputlength));
+	}
+};
+
+/*
+* zlib streams from the bundled miniz. Always available
+*/
+class MinizCodec : public Codec {
+	private:
+	static bool Fits(size_t length) {
+		return length <= static_cast<mz_ulong>(-1); // mz_ulong is 32 bits on Windows
+	}
+
+	public:
+	const char* Name() const override {
+		return "miniz";
+	}
+
+	bool Init() override {
+		return true;
+	}
+
+	size_t CompressBound(size_t inputlength) const override {
+		return Fits(inputlength) ? mz_compressBound(static_cast<mz_ulong>(inputlength)) : inputlength + inputlength / 64 + 65536;
+	}
+
+	size_t CompressScratchSize(size_t inputlength) const override {
+		return sizeof(tdefl_compressor);
+	}
+
+	size_t DecompressScratchSize(size_t outputlength) const override {
+		return sizeof(tinfl_decompressor) + TINFL_LZ_DICT_SIZE;
+	}
+
+	bool Recognizes(const char* input, size_t inputlength) const override {
+		if(inputlength < 2)
+			return false;
+
+		// zlib header: deflate method, and the first two bytes are a multiple of 31
+		unsigned char cmf = static_cast<unsigned char>(input[0]), flg = static_cast<unsigned char>(input[1]);
+		return (cmf & 0x0F) == 8 && (cmf << 8 | flg) % 31 == 0;
+	}
+
+	bool Compress(const char* input, size_t inputlength, char* output, size_t outputcapacity, size_t& outputlength, int level) override {
+		if(!Fits(inputlength) || !Fits(outputcapacity))
+			return false;
+
+		// Oodle levels run higher than zlib's at the slow end
+		int mzlevel = level < 0 ? MZ_DEFAULT_LEVEL : (level > 9 ? 9 : level);
+
+		mz_ulong length = static_cast<mz_ulong>(outputcapacity);
+		int result = mz_compress2(reinterpret_cast<unsigned char*>(output), &length,
+			reinterpret_cast<const unsigned char*>(input), static_cast<mz_ulong>(inputlength), mzlevel);
+		if(result != MZ_OK)
+			return false;
+		outputlength = length;
+		return true;
+	}
+
+	bool Decompress(const char* input, size_t inputlength, char* output, size_t outputlength) override {
+		if(!Fits(inputlength) || !Fits(outputlength))
+			return false;
+
+		mz_ulong length = static_cast<mz_ulong>(outputlength);
+		int result = mz_uncompress(reinterpret_cast<unsigned char*>(output), &length,
+			reinterpret_cast<const unsigned char*>(input), static_cast<mz_ulong>(inputlength));
+		return result == MZ_OK && length == outputlength;
+	}
+
+	size_t PrefixBufferSize(size_t prefixlength, size_t outputlength) const override {
+		return prefixlength < outputlength ? prefixlength : outputlength;
+	}
+
+	bool DecompressPrefix(const char* input, size_t inputlength, char* output, size_t prefixlength, size_t outputlength) override {
+		size_t wanted = PrefixBufferSize(prefixlength, outputlength);
+		if(!Fits(inputlength) || !Fits(wanted))
+			return false;
+
+		mz_stream stream;
+		memset(&stream, 0, sizeof(mz_stream));
+		stream.next_in = reinterpret_cast<const unsigned char*>(input);
+		stream.avail_in = static_cast<unsigned int>(inputlength);
+		stream.next_out = reinterpret_cast<unsigned char*>(output);
+		stream.avail_out = static_cast<unsigned int>(wanted);
+		if(mz_inflateInit(&stream) != MZ_OK)
+			return false;
+
+		// Inflate stops once the output buffer is full
+		int result = MZ_OK;
+		while(result == MZ_OK && stream.avail_out > 0)
+			result = mz_inflate(&stream, MZ_SYNC_FLUSH);
+		mz_inflateEnd(&stream);
+
+		return stream.total_out == wanted && (result == MZ_OK || result == MZ_STREAM_END || result == MZ_BUF_ERROR);
+	}
+};
+
+static OodleCodec codec_oodle;
+static MinizCodec codec_miniz;
+static Codec* const codecs[AtlanCodec::CODEC_COUNT] = {&codec_oodle, &codec_miniz};
+
+static AtlanCodec::codec_t& ActiveCodec() {
+	static AtlanCodec::codec_t active = [] {
+		std::string name;
+
+		#ifdef _WIN32
+		char* value = nullptr;
+		size_t length = 0;
+		if (_dupenv_s(&value, &length, ATLAN_CODEC_VARIABLE) == 0 && value != nullptr) {
+			name = value;
+			free(value);
+		}
+		#else
+		const char* value = std::getenv(ATLAN_CODEC_VARIABLE);
+		if(value != nullptr)
+			name = value;
+		#endif
+
+		for (int i = 0; i < AtlanCodec::CODEC_COUNT; i++) {
+			if(name == codecs[i]->Name())
+				return static_cast<AtlanCodec::codec_t>(i);
+		}
+		return AtlanCodec::CODEC_OODLE;
+	}();
+	return active;
+}
+
+Codec& AtlanCodec::Get(codec_t codec)
+{
+	return *codecs[codec];
+}
+
+Codec& AtlanCodec::Active()
+{
+	return *codecs[ActiveCodec()];
+}
+
+AtlanCodec::codec_t AtlanCodec::ActiveType()
+{
+	return ActiveCodec();
+}
+
+void AtlanCodec::Select(codec_t codec)
+{
+	ActiveCodec() = codec;
+}
+
+bool AtlanCodec::Select(const char* name)
+{
+	for (int i = 0; i < CODEC_COUNT; i++) {
+		if (strcmp(name, codecs[i]->Name()) == 0) {
+			Select(static_cast<codec_t>(i));
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+
+/*
+* A compression backend
+*
+* Every compress and decompress path goes through the active codec, so the tools can
+* run on hosts where Oodle is unavailable. Data can only be decompressed by the codec
+* that compressed it: the game only reads Oodle data, so the other codecs are only
+* useful for profiling and testing the pipelines.
+*
+* Thread safety: once Init succeeds, Compress and Decompress may be called from any
+* number of threads at once. Each call allocates and frees it's own working memory,
+* reported by the ScratchSize functions.
+*/
+class Codec {
+	public:
+	static const int DEFAULT_LEVEL = -1;
+
+	virtual ~Codec() = default;
+
+	virtual const char* Name() const = 0;
+
+	// Prepares the codec for use. Safe to call repeatedly. Returns false if the codec is unusable
+	virtual bool Init() = 0;
+
+	// Largest compressed size possible for an input of this length.
+	// Compression output buffers should be at least this large
+	virtual size_t CompressBound(size_t inputlength) const = 0;
+
+	// Working memory allocated by a single compress or decompress call
+	virtual size_t CompressScratchSize(size_t inputlength) const = 0;
+	virtual size_t DecompressScratchSize(size_t outputlength) const = 0;
+
+	// True if the data begins like a stream this codec produces
+	virtual bool Recognizes(const char* input, size_t inputlength) const = 0;
+
+	/*
+	* Compresses input into output, which holds outputcapacity bytes.
+	* The compressed length is written to outputlength.
+	* Levels follow Oodle's scale, where 4 is normal and 9 is the slowest
+	*/
+	virtual bool Compress(const char* input, size_t inputlength, char* output, size_t outputcapacity, size_t& outputlength, int level = DEFAULT_LEVEL) = 0;
+
+	// Decompresses input. Fails unless exactly outputlength bytes are produced
+	virtual bool Decompress(const char* input, size_t inputlength, char* output, size_t outputlength) = 0;
+
+	/*
+	* Size of the buffer DecompressPrefix needs to produce the first prefixlength bytes
+	* of a stream that decompresses to outputlength bytes. Codecs that decode in
+	* blocks may need room for the whole block holding the prefix
+	*/
+	virtual size_t PrefixBufferSize(size_t prefixlength, size_t outputlength) const = 0;
+
+	/*
+	* Decompresses the first prefixlength bytes of a stream that decompresses to
+	* outputlength bytes, stopping as early as the format allows. Output must hold
+	* PrefixBufferSize bytes. The bytes past the prefix are unspecified
+	*/
+	virtual bool DecompressPrefix(const char* input, size_t inputlength, char* output, size_t prefixlength, size_t outputlength) = 0;
+};
+
+namespace AtlanCodec
+{
+	enum codec_t {
+		CODEC_OODLE,
+		CODEC_MINIZ,
+		CODEC_COUNT
+	};
+
+	// Environment variable naming the codec to use in place of Oodle (i.e. ATLAN_CODEC=miniz)
+	#define ATLAN_CODEC_VARIABLE "ATLAN_CODEC"
+
+	Codec& Get(codec_t codec);
+
+	/*
+	* The codec every compression path uses. Defaults to Oodle, unless
+	* ATLAN_CODEC_VARIABLE names another codec when this is first called
+	*/
+	Codec& Active();
+	codec_t ActiveType();
+
+	void Select(codec_t codec);
+
+	// Selects a codec by it's name. Returns false if no codec has that name
+	bool Select(const char* name);
+}
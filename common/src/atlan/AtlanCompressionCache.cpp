@@ -0,0 +1,161 @@
+#include "AtlanCompressionCache.h"
+#include "AtlanCodec.h"
+#include "hash/HashLib.h"
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+/*
+* ENTRY FILE FORMAT:
+* - Magic: "ATCC" (Atlan Compression Cache)
+* - 4 Bytes: Version
+* - 8 Bytes: Compressed Length
+* - 8 Bytes: FarmHash64 of the compressed data
+* - Compressed Data
+*/
+#define CACHE_MAGIC 0x43435441 // "ATCC"
+#define CACHE_VERSION 1
+
+struct cacheheader_t {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t length;
+	uint64_t hash;
+};
+
+bool AtlanCompressionCache::Open(const std::filesystem::path& p_directory, uint64_t p_capacity)
+{
+	std::error_code error;
+	std::filesystem::create_directories(p_directory, error);
+	opened = std::filesystem::is_directory(p_directory, error);
+	directory = p_directory;
+	capacity = p_capacity;
+	return opened;
+}
+
+std::filesystem::path AtlanCompressionCache::EntryPath(uint64_t inputhash, size_t inputlength, const Codec& codec, int level) const
+{
+	char name[96];
+	snprintf(name, sizeof(name), "%016llx_%llx_%s_%d.bin", static_cast<unsigned long long>(inputhash),
+		static_cast<unsigned long long>(inputlength), codec.Name(), level < 0 ? -1 : level);
+	return directory / name;
+}
+
+bool AtlanCompressionCache::Load(const std::filesystem::path& entrypath, char* output, size_t outputcapacity, size_t& outputlength) const
+{
+	std::ifstream file(entrypath, std::ios_base::binary);
+	if(!file.good())
+		return false;
+
+	cacheheader_t header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(cacheheader_t));
+	if(!file.good() || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.length > outputcapacity)
+		return false;
+
+	// Guards against entries left incomplete or corrupted by an interrupted run
+	file.read(output, header.length);
+	if(!file.good() || HashLib::FarmHash64(output, header.length) != header.hash)
+		return false;
+	file.close();
+
+	// Mark the entry as recently used
+	std::error_code error;
+	std::filesystem::last_write_time(entrypath, std::filesystem::file_time_type::clock::now(), error);
+
+	outputlength = header.length;
+	return true;
+}
+
+void AtlanCompressionCache::Store(const std::filesystem::path& entrypath, const char* output, size_t outputlength) const
+{
+	// Entries are written under a temporary name, so other threads and runs never see a partial file
+	std::filesystem::path temppath = entrypath;
+	temppath += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	cacheheader_t header = {CACHE_MAGIC, CACHE_VERSION, outputlength, HashLib::FarmHash64(output, outputlength)};
+	{
+		std::ofstream file(temppath, std::ios_base::binary);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(cacheheader_t));
+		file.write(output, outputlength);
+		file.close();
+		if (!file.good()) {
+			std::error_code error;
+			std::filesystem::remove(temppath, error);
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temppath, entrypath, error);
+	if(error)
+		std::filesystem::remove(temppath, error);
+}
+
+bool AtlanCompressionCache::Compress(Codec& codec, const char* input, size_t inputlength, char* output, size_t outputcapacity, size_t& outputlength, int level)
+{
+	if(!opened)
+		return codec.Compress(input, inputlength, output, outputcapacity, outputlength, level);
+
+	const std::filesystem::path entrypath = EntryPath(HashLib::FarmHash64(input, inputlength), inputlength, codec, level);
+	if (Load(entrypath, output, outputcapacity, outputlength)) {
+		hits++;
+		return true;
+	}
+
+	misses++;
+	if(!codec.Compress(input, inputlength, output, outputcapacity, outputlength, level))
+		return false;
+	Store(entrypath, output, outputlength);
+	return true;
+}
+
+void AtlanCompressionCache::Trim()
+{
+	if(!opened)
+		return;
+
+	struct entry_t {
+		std::filesystem::file_time_type lastused;
+		uint64_t size;
+		std::filesystem::path path;
+	};
+
+	std::vector<entry_t> entries;
+	uint64_t totalsize = 0;
+	std::error_code error;
+	for (const std::filesystem::directory_entry& d : std::filesystem::directory_iterator(directory, error)) {
+		if(!d.is_regular_file(error))
+			continue;
+
+		// Temporary files are left behind by interrupted runs
+		if (d.path().extension() == ".tmp") {
+			std::filesystem::remove(d.path(), error);
+			continue;
+		}
+		if(d.path().extension() != ".bin")
+			continue;
+
+		entry_t& e = entries.emplace_back();
+		e.lastused = d.last_write_time(error);
+		e.size = d.file_size(error);
+		e.path = d.path();
+		totalsize += e.size;
+	}
+
+	if(totalsize <= capacity)
+		return;
+
+	std::sort(entries.begin(), entries.end(), [](const entry_t& a, const entry_t& b) {
+		return a.lastused < b.lastused;
+	});
+
+	for (const entry_t& e : entries) {
+		if(totalsize <= capacity)
+			break;
+		if(std::filesystem::remove(e.path, error))
+			totalsize -= e.size;
+	}
+}
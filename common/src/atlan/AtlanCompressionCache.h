@@ -0,0 +1,53 @@
+#pragma once
+#include <filesystem>
+#include <atomic>
+#include <cstdint>
+
+class Codec;
+
+/*
+* On-disk cache of compressed outputs
+*
+* Entries are keyed by the FarmHash64 and length of the input, the codec and
+* the compression level, so unchanged inputs are never compressed twice. Each
+* entry is a separate file: hits refresh it's modification time, and Trim
+* deletes the least recently used entries once the cache exceeds it's size cap.
+* Compress is thread-safe.
+*/
+class AtlanCompressionCache {
+	private:
+	std::filesystem::path directory;
+	uint64_t capacity = 0;
+	bool opened = false;
+	std::atomic<uint64_t> hits = 0;
+	std::atomic<uint64_t> misses = 0;
+
+	std::filesystem::path EntryPath(uint64_t inputhash, size_t inputlength, const Codec& codec, int level) const;
+	bool Load(const std::filesystem::path& entrypath, char* output, size_t outputcapacity, size_t& outputlength) const;
+	void Store(const std::filesystem::path& entrypath, const char* output, size_t outputlength) const;
+
+	public:
+	static const uint64_t DEFAULT_CAPACITY = 2ULL * 1024 * 1024 * 1024;
+
+	AtlanCompressionCache() = default;
+	AtlanCompressionCache(const AtlanCompressionCache& b) = delete;
+	void operator=(const AtlanCompressionCache& b) = delete;
+
+	// Creates the cache directory if it doesn't exist
+	bool Open(const std::filesystem::path& p_directory, uint64_t p_capacity = DEFAULT_CAPACITY);
+
+	bool IsOpen() const {return opened;}
+
+	/*
+	* Same contract as Codec::Compress. Copies a stored output if this input was
+	* compressed before with the same codec and level. Otherwise, compresses the
+	* input and stores the output for future runs
+	*/
+	bool Compress(Codec& codec, const char* input, size_t inputlength, char* output, size_t outputcapacity, size_t& outputlength, int level);
+
+	// Deletes the least recently used entries until the cache fits within it's capacity
+	void Trim();
+
+	uint64_t Hits() const {return hits;}
+	uint64_t Misses() const {return misses;}
+};
@@ -40,7 +40,7 @@ void AtlanModConfig::GetNormalizedName(const std::string& in_zipname, std::strin
 bool AtlanModConfig::TryRead(const std::string& filepath)
 {
     try {
-        EntityParser parser(filepath, ParsingMode::PERMISSIVE);
+        EntityParser parser(filepath, ParsingMode::PERMISSIVE, false, true);
         return TryRead_Internal(*parser.getRoot());
     }
     catch (...) {
@@ -53,7 +53,7 @@ bool AtlanModConfig::TryRead(const std::string& filepath)
 bool AtlanModConfig::TryRead(const char* data, const size_t length) {
     
     try {
-        EntityParser parser(ParsingMode::PERMISSIVE, std::string_view(data, length), false);
+        EntityParser parser(ParsingMode::PERMISSIVE, std::string_view(data, length), false, true);
         return TryRead_Internal(*parser.getRoot());
     }
     catch (...) {
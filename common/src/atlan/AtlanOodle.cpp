@@ -1,5 +1,7 @@
 #include "AtlanOodle.h"
 #include "AtlanLogger.h"
+#include "AtlanCodec.h"
+#include "AtlanCompressionCache.h"
 #include "entityslayer/Oodle.h"
 #include "io/BinaryReader.h"
 #include "hash/sha256.h"
@@ -10,6 +12,12 @@ bool Oodle::AtlanOodleInit(const std::filesystem::path& gamedirectory)
 {
 	using namespace std::filesystem;
 
+	// Another codec was chosen through the environment, so Oodle isn't needed
+	if (AtlanCodec::ActiveType() != AtlanCodec::CODEC_OODLE) {
+		atlog << "Using the " << AtlanCodec::Active().Name() << " codec in place of Oodle. Output will not be readable by the game\n";
+		return AtlanCodec::Active().Init();
+	}
+
 	fspath oo2core_chosenpath;
 	const fspath oo2corepath_debug = "oo2core_9_win64.dll";
 	const fspath oo2corepath_alt   = gamedirectory / "oo2core_8_win64.dll";
@@ -96,9 +104,10 @@ const char* Oodle::atcf_dataptr(const char* input)
 	return input + AtlanCompHeaderSize();
 }
 
-bool Oodle::AtlanCompress(const char* input, size_t inputlength, char*& output, size_t& outputlength, size_t& outputBufferLength)
+bool Oodle::AtlanCompress(const char* input, size_t inputlength, char*& output, size_t& outputlength, size_t& outputBufferLength, AtlanCompressionCache* cache)
 {
-	size_t targetSize = inputlength + 65000;
+	Codec& codec = AtlanCodec::Active();
+	size_t targetSize = AtlanCompHeaderSize() + codec.CompressBound(inputlength);
 
 	if (outputBufferLength < targetSize) {
 		delete[] output;
@@ -106,8 +115,11 @@ bool Oodle::AtlanCompress(const char* input, size_t inputlength, char*& output,
 		outputBufferLength = targetSize;
 	}
 
-	size_t compressedSize; // Const cast is probably fine here...todo: inspect Oodle function signatures
-	bool result = Oodle::CompressBuffer(const_cast<char*>(input), inputlength, output + AtlanCompHeaderSize(), compressedSize);
+	size_t compressedSize;
+	char* compressedData = output + AtlanCompHeaderSize();
+	size_t compressedCapacity = outputBufferLength - AtlanCompHeaderSize();
+	bool result = cache ? cache->Compress(codec, input, inputlength, compressedData, compressedCapacity, compressedSize, Codec::DEFAULT_LEVEL)
+		: codec.Compress(input, inputlength, compressedData, compressedCapacity, compressedSize);
 	if(!result)
 		return false;
 
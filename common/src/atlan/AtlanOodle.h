@@ -1,6 +1,8 @@
 #pragma once
 #include <filesystem>
 
+class AtlanCompressionCache;
+
 namespace Oodle
 {
 	// Performs all necessary operations for initializing Oodle for an Atlan application
@@ -10,7 +12,8 @@ namespace Oodle
 
 	// Create an Atlan Compression File from the given data
 	// Output is written to the provided buffer. If the output buffer is too small, the buffer will be reallocated
-	bool AtlanCompress(const char* input, size_t inputlength, char*& output, size_t& outputlength, size_t& outputBufferLength);
+	// If a cache is given, identical inputs reuse it's stored output instead of being compressed again
+	bool AtlanCompress(const char* input, size_t inputlength, char*& output, size_t& outputlength, size_t& outputBufferLength, AtlanCompressionCache* cache = nullptr);
 
 	// Returns true if this is a valid Atlan Compression File
 	bool IsAtlanCompFile(const char* input, size_t inputlength);
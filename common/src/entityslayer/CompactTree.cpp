@@ -0,0 +1,283 @@
+#include "CompactTree.h"
+#include "EntityParser.h"
+#include <cstring>
+#include <stdexcept>
+
+/*
+* COMPACT TREE
+*/
+
+/*
+* Receives the parser's events. A node waits in the pending list until it's parent is
+* complete, then it and it's siblings are stored together, so every child range is contiguous
+*/
+class CompactTree::Builder : public EntityEventHandler {
+	struct pending_t {
+		uint64_t packed;
+		uint32_t textOffset;
+		uint32_t firstChild;
+		uint32_t childCount;
+	};
+
+	CompactTree& tree;
+	std::vector<pending_t> pending; // Nodes of the open objects, in document order
+	std::vector<size_t> levels;     // Index in pending of the first child of each open object
+
+	void Push(uint16_t flags, std::string_view name, std::string_view value)
+	{
+		if(name.length() > UINT16_MAX || value.length() > UINT16_MAX)
+			throw std::runtime_error("Name or value is too long for a CompactTree");
+		if(tree.text.size() + name.length() + value.length() > UINT32_MAX)
+			throw std::runtime_error("Text is too long for a CompactTree");
+
+		pending_t node;
+		node.packed = flags | static_cast<uint64_t>(name.length()) << 16 | static_cast<uint64_t>(value.length()) << 32;
+		node.textOffset = static_cast<uint32_t>(tree.text.size());
+		node.firstChild = 0;
+		node.childCount = 0;
+		pending.push_back(node);
+
+		tree.text.insert(tree.text.end(), name.begin(), name.end());
+		tree.text.insert(tree.text.end(), value.begin(), value.end());
+	}
+
+	public:
+	Builder(CompactTree& p_tree) : tree(p_tree) {}
+
+	/*
+	* Stores the pending nodes from first onwards as one contiguous range, and points
+	* their children back at them. Returns the index of the range's first node
+	*/
+	uint32_t Store(size_t first)
+	{
+		const size_t count = pending.size() - first;
+		if(tree.packed.size() + count >= UINT32_MAX) // Leave room for the search 404 node
+			throw std::runtime_error("Too many nodes for a CompactTree");
+
+		const uint32_t start = tree.Size();
+		for (size_t i = first; i < pending.size(); i++) {
+			const pending_t& node = pending[i];
+			const uint32_t index = start + static_cast<uint32_t>(i - first);
+			tree.packed.push_back(node.packed);
+			tree.textOffsets.push_back(node.textOffset);
+			tree.parents.push_back(NO_NODE);
+			tree.firstChildren.push_back(node.firstChild);
+			tree.childCounts.push_back(node.childCount);
+
+			for(uint32_t c = node.firstChild, max = c + node.childCount; c < max; c++)
+				tree.parents[c] = index;
+		}
+		pending.resize(first);
+		return start;
+	}
+
+	// The number of pending nodes that are children of the root
+	size_t RootChildren() const { return pending.size(); }
+
+	void Enter(uint16_t flags, std::string_view name, std::string_view value) override
+	{
+		Push(flags, name, value);
+		levels.push_back(pending.size());
+	}
+
+	void Leave() override
+	{
+		const size_t first = levels.back();
+		levels.pop_back();
+
+		const uint32_t childCount = static_cast<uint32_t>(pending.size() - first);
+		const uint32_t firstChild = Store(first);
+		pending.back().firstChild = firstChild; // The object is pending right before it's children
+		pending.back().childCount = childCount;
+	}
+
+	void Value(uint16_t flags, std::string_view name, std::string_view value) override
+	{
+		Push(flags, name, value);
+	}
+};
+
+void CompactTree::Clear()
+{
+	packed.clear();
+	textOffsets.clear();
+	parents.clear();
+	firstChildren.clear();
+	childCounts.clear();
+	text.clear();
+	eofblob.clear();
+}
+
+ParseResult CompactTree::Parse(std::string_view data)
+{
+	Clear();
+
+	// The root is stored first. Node text can't outgrow the file, so it's buffer is only allocated once
+	packed.push_back(EntNode::NFC_RootNode);
+	textOffsets.push_back(0);
+	parents.push_back(NO_NODE);
+	firstChildren.push_back(0);
+	childCounts.push_back(0);
+	text.reserve(data.length());
+
+	EntityParser parser(ParsingMode::PERMISSIVE);
+	Builder builder(*this);
+	ParseResult result = parser.ParseEvents(data, builder);
+
+	if (result.success) {
+		try {
+			childCounts[0] = static_cast<uint32_t>(builder.RootChildren());
+			firstChildren[0] = builder.Store(0);
+			for(uint32_t i = firstChildren[0], max = i + childCounts[0]; i < max; i++)
+				parents[i] = 0;
+		}
+		catch (std::runtime_error err) {
+			result.success = false;
+			result.errorMessage = err.what();
+		}
+	}
+	if (!result.success) {
+		Clear();
+		return result;
+	}
+
+	packed.push_back(0);
+	textOffsets.push_back(0);
+	parents.push_back(NO_NODE);
+	firstChildren.push_back(0);
+	childCounts.push_back(0);
+
+	// Node counts aren't known until the parse ends, so the growth slack is trimmed afterwards
+	packed.shrink_to_fit();
+	textOffsets.shrink_to_fit();
+	parents.shrink_to_fit();
+	firstChildren.shrink_to_fit();
+	childCounts.shrink_to_fit();
+	text.shrink_to_fit();
+
+	if(parser.eofblob != nullptr)
+		eofblob.assign(parser.eofblob, parser.eofbloblength);
+	return result;
+}
+
+size_t CompactTree::MemoryUsage() const
+{
+	return packed.capacity() * sizeof(uint64_t) + text.capacity() + eofblob.capacity()
+		+ (textOffsets.capacity() + parents.capacity() + firstChildren.capacity() + childCounts.capacity()) * sizeof(uint32_t);
+}
+
+void CompactTree::GenerateText(uint32_t node, std::string& buffer, int wsIndex) const
+{
+	uint16_t nodeFlags = Flags(node);
+	uint32_t nameLength = NameLength(node), valLength = ValueLength(node);
+	const char* textPtr = text.data() + textOffsets[node];
+
+	buffer.append(wsIndex, '\t');
+	buffer.append(textPtr, nameLength);
+
+	if(nodeFlags & EntNode::NF_Equals)
+		buffer.append(" =");
+	if(nodeFlags & EntNode::NF_Colon)
+		buffer.push_back(':');
+
+	if (valLength > 0) {
+		buffer.push_back(' ');
+		buffer.append(textPtr + nameLength, valLength);
+	}
+
+	if(nodeFlags & EntNode::NF_Semicolon)
+		buffer.push_back(';');
+
+	if(nodeFlags & EntNode::NF_Braces)
+		buffer.append(" {\n");
+	else if(nodeFlags & EntNode::NF_Brackets)
+		buffer.append(" [\n");
+
+	if(nodeFlags & EntNode::NF_NoIndent)
+		wsIndex--;
+
+	for (uint32_t i = firstChildren[node], max = i + childCounts[node]; i < max; i++) {
+		GenerateText(i, buffer, wsIndex + 1);
+		buffer.push_back('\n');
+	}
+	if (nodeFlags & EntNode::NF_Braces) {
+		if(wsIndex > 0)
+			buffer.append(wsIndex, '\t');
+		buffer.push_back('}');
+	}
+	else if (nodeFlags & EntNode::NF_Brackets) {
+		buffer.append(wsIndex, '\t');
+		buffer.push_back(']');
+	}
+	if(nodeFlags & EntNode::NF_Comma)
+		buffer.push_back(',');
+}
+
+/*
+* COMPACT NODE
+*/
+
+CompactNode CompactNode::operator[](const std::string_view key) const
+{
+	const uint64_t* packed = tree->packed.data();
+	for (uint32_t i = tree->firstChildren[index], max = i + tree->childCounts[index]; i < max; i++)
+	{
+		if(static_cast<uint16_t>(packed[i] >> 16) != key.length())
+			continue;
+		if(memcmp(key.data(), tree->text.data() + tree->textOffsets[i], key.length()) == 0)
+			return CompactNode(tree, i);
+	}
+	return tree->Search404();
+}
+
+bool CompactNode::ValueInt(int& writeTo, int clampMin, int clampMax) const {
+	int valLength = ValueLength();
+	if (valLength == 0) return false;
+
+	const char* firstChar = ValuePtr();
+	int base = 1, value = 0;
+
+	for (const char* ptr = firstChar + valLength - 1; ptr >= firstChar; ptr--) {
+		char c = *ptr;
+		if (c >= '0' && c <= '9') {
+			value += (c - '0') * base;
+			base *= 10;
+		}
+		else if (c == '-' && ptr == firstChar) {
+			value = -value;
+		}
+		else return false;
+	}
+
+	if(value < clampMin) value = clampMin;
+	if(value > clampMax) value = clampMax;
+
+	writeTo = value;
+	return true;
+}
+
+bool CompactNode::ValueBool(bool& writeTo) const {
+	std::string_view value = getValue();
+	if (value == "0" || value == "false") {
+		writeTo = false;
+		return true;
+	}
+	if (value == "1" || value == "true") {
+		writeTo = true;
+		return true;
+	}
+	return false;
+}
+
+size_t CompactNode::countNodes() const
+{
+	size_t sum = 1;
+	for (uint32_t i = tree->firstChildren[index], max = i + tree->childCounts[index]; i < max; i++)
+		sum += CompactNode(tree, i).countNodes();
+	return sum;
+}
+
+void CompactNode::generateText(std::string& buffer, int wsIndex) const
+{
+	tree->GenerateText(index, buffer, wsIndex);
+}
@@ -0,0 +1,224 @@
+#pragma once
+#include <string_view>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct ParseResult;
+class CompactTree;
+
+/*
+* A node of a CompactTree. Mirrors the read-only accessors of EntNode,
+* so code templated on the node type can run on either layout.
+* Views are two words and should be passed by value
+*/
+class CompactNode
+{
+	friend class CompactTree;
+
+	private:
+	const CompactTree* tree = nullptr;
+	uint32_t index = 0;
+
+	CompactNode(const CompactTree* p_tree, uint32_t p_index) : tree(p_tree), index(p_index) {}
+
+	public:
+	CompactNode() = default;
+
+	uint32_t Index() const { return index; }
+
+	// True if this is the node returned by searches that fail
+	bool IsSearch404() const;
+
+	bool operator==(const CompactNode b) const { return tree == b.tree && index == b.index; }
+	bool operator!=(const CompactNode b) const { return !(*this == b); }
+
+	uint16_t getFlags() const;
+	std::string_view getName() const;
+	std::string_view getValue() const;
+	std::string_view getNameUQ() const;
+	std::string_view getValueUQ() const;
+	bool hasValue() const { return ValueLength() > 0; }
+	bool IsComment() const;
+	const char* NamePtr() const;
+	const char* ValuePtr() const;
+	int NameLength() const;
+	int ValueLength() const;
+
+	// Returns the search 404 node for the root
+	CompactNode getParent() const;
+	bool HasParent() const;
+	int getChildCount() const;
+	CompactNode ChildAt(int index) const;
+	CompactNode operator[](const int index) const { return ChildAt(index); }
+
+	/*
+	* Searches the node's children for a node whose name equals the given key
+	* @return The first child with the given name, or a node where IsSearch404() is true
+	*/
+	CompactNode operator[](const std::string_view key) const;
+
+	bool ValueInt(int& writeTo, int clampMin, int clampMax) const;
+	bool ValueBool(bool& writeTo) const;
+
+	size_t countNodes() const;
+
+	std::string toString() const
+	{
+		std::string buffer;
+		generateText(buffer);
+		return buffer;
+	}
+
+	void generateText(std::string& buffer, int wsIndex = 0) const;
+};
+
+/*
+* A read-only entity tree stored as structure-of-arrays, parsed straight from text
+* without building an EntNode tree.
+*
+* Nodes are addressed by 32-bit indices, with the root at index 0. A node's children
+* occupy a contiguous range of indices, placed once the node's closing brace is parsed,
+* and all text is stored in one buffer in document order. Flags and both text lengths
+* are packed into a single 64-bit field, so each node costs 24 bytes plus it's text,
+* versus a 48 byte EntNode, it's pointer in the parent's child buffer, and it's text block.
+*
+* Editing still requires the EntityParser's tree. Parse a CompactTree instead for files
+* that are only read, by passes that walk the whole tree like text generation
+*/
+class CompactTree
+{
+	friend class CompactNode;
+
+	private:
+	/*
+	* Bits 0-15: Node flags
+	* Bits 16-31: Name length
+	* Bits 32-47: Value length
+	*/
+	std::vector<uint64_t> packed;
+	std::vector<uint32_t> textOffsets;  // Start of the node's [name][value] text
+	std::vector<uint32_t> parents;      // Parent of the root is NO_NODE
+	std::vector<uint32_t> firstChildren;
+	std::vector<uint32_t> childCounts;
+	std::vector<char> text;
+
+	static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+	class Builder;
+
+	uint32_t Size() const { return static_cast<uint32_t>(packed.size()); } // Includes the search 404 node, stored last
+	uint16_t Flags(uint32_t node) const { return static_cast<uint16_t>(packed[node]); }
+	uint32_t NameLength(uint32_t node) const { return static_cast<uint16_t>(packed[node] >> 16); }
+	uint32_t ValueLength(uint32_t node) const { return static_cast<uint16_t>(packed[node] >> 32); }
+
+	void Clear();
+
+	void GenerateText(uint32_t node, std::string& buffer, int wsIndex) const;
+
+	public:
+	// Binary blob that may be present at end of file
+	std::string eofblob;
+
+	CompactTree() = default;
+	CompactTree(const CompactTree& b) = delete;
+	void operator=(const CompactTree& b) = delete;
+
+	/*
+	* Parses text with the EntityParser's PERMISSIVE grammar, storing each node as it's parsed.
+	* Fails, leaving this tree empty, if the text can't be parsed, or has more
+	* nodes or text than 32-bit indices can address
+	*/
+	ParseResult Parse(std::string_view data);
+
+	bool IsEmpty() const { return packed.empty(); }
+
+	CompactNode Root() const { return CompactNode(this, 0); }
+
+	CompactNode Search404() const { return CompactNode(this, Size() - 1); }
+
+	// Number of parsed nodes, including the root
+	uint32_t NodeCount() const { return IsEmpty() ? 0 : Size() - 1; }
+
+	// Bytes allocated by the tree
+	size_t MemoryUsage() const;
+};
+
+/*
+* Accessors are defined here so they inline into the passes walking the tree
+*/
+
+inline bool CompactNode::IsSearch404() const {
+	return index == tree->Size() - 1;
+}
+
+inline uint16_t CompactNode::getFlags() const {
+	return tree->Flags(index);
+}
+
+inline const char* CompactNode::NamePtr() const {
+	return tree->text.data() + tree->textOffsets[index];
+}
+
+inline const char* CompactNode::ValuePtr() const {
+	return NamePtr() + tree->NameLength(index);
+}
+
+inline int CompactNode::NameLength() const {
+	return static_cast<int>(tree->NameLength(index));
+}
+
+inline int CompactNode::ValueLength() const {
+	return static_cast<int>(tree->ValueLength(index));
+}
+
+inline std::string_view CompactNode::getName() const {
+	return std::string_view(NamePtr(), NameLength());
+}
+
+inline std::string_view CompactNode::getValue() const {
+	return std::string_view(ValuePtr(), ValueLength());
+}
+
+inline std::string_view CompactNode::getNameUQ() const {
+	std::string_view name = getName();
+	if(name.length() == 0)
+		return "";
+	if(name[0] == '"')
+		return name.substr(1, name.length() - 2);
+	if(name[0] == '<')
+		return name.substr(2, name.length() - 4);
+	return name;
+}
+
+inline std::string_view CompactNode::getValueUQ() const {
+	std::string_view value = getValue();
+	if(value.length() == 0)
+		return "";
+	if(value[0] == '"')
+		return value.substr(1, value.length() - 2);
+	if(value[0] == '<')
+		return value.substr(2, value.length() - 4);
+	return value;
+}
+
+inline bool CompactNode::IsComment() const {
+	return NameLength() > 0 && *NamePtr() == '/';
+}
+
+inline CompactNode CompactNode::getParent() const {
+	uint32_t parent = tree->parents[index];
+	return parent == CompactTree::NO_NODE ? tree->Search404() : CompactNode(tree, parent);
+}
+
+inline bool CompactNode::HasParent() const {
+	return tree->parents[index] != CompactTree::NO_NODE;
+}
+
+inline int CompactNode::getChildCount() const {
+	return static_cast<int>(tree->childCounts[index]);
+}
+
+inline CompactNode CompactNode::ChildAt(int i) const {
+	return CompactNode(tree, tree->firstChildren[index] + i);
+}
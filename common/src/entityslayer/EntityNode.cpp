@@ -1,5 +1,8 @@
 #include <fstream>
-#include "Oodle.h"
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "atlan/AtlanCodec.h"
 #include "EntityLogger.h"
 #include "EntityNode.h"
 
@@ -19,7 +22,7 @@ EntNode* EntNode::SEARCH_404 = &_404;
 #if entityparser_wxwidgets
 wxString EntNode::getNameWX() { return wxString(textPtr, nameLength); }
 
-wxString EntNode::getValueWX() { return wxString(textPtr + nameLength, valLength); }
+wxString EntNode::getValueWX() { return wxString(ValuePtr(), valLength); }
 
 wxString EntNode::getNameWXUQ() {
 	std::string_view nameuq = getNameUQ();
@@ -32,6 +35,63 @@ wxString EntNode::getValueWXUQ() {
 }
 #endif
 
+#if entityparser_childindex
+static uint32_t HashName(const std::string_view name) {
+	size_t hash = std::hash<std::string_view>()(name);
+	return static_cast<uint32_t>(hash ^ static_cast<uint64_t>(hash) >> 32);
+}
+
+// Keeps the table at most half full
+static size_t ChildIndexCapacity(int childCount) {
+	size_t capacity = 64;
+	while(capacity < static_cast<size_t>(childCount) * 2)
+		capacity <<= 1;
+	return capacity;
+}
+
+const EntNode::ChildIndex::slot_t* EntNode::ChildIndex::Publish(slot_t* table) const
+{
+	slot_t* expected = nullptr;
+	if(slots.compare_exchange_strong(expected, table, std::memory_order_acq_rel))
+		return table;
+	delete[] table;
+	return expected;
+}
+
+EntNode& EntNode::IndexedChild(const std::string_view key) const
+{
+	// The index is discarded whenever the child count changes, so it's capacity can be recomputed
+	const size_t mask = ChildIndexCapacity(childCount) - 1;
+	const ChildIndex::slot_t* slots = childIndex.Get();
+
+	if (slots == nullptr) {
+		ChildIndex::slot_t* table = new ChildIndex::slot_t[mask + 1]();
+		for (int i = 0; i < childCount; i++) {
+			std::string_view name = children[i]->getName();
+			uint32_t hash = HashName(name);
+
+			// Only the first child with a name is indexed, matching the linear search
+			size_t s = hash & mask;
+			while(table[s].child != 0 && (table[s].hash != hash || children[table[s].child - 1]->getName() != name))
+				s = (s + 1) & mask;
+			if(table[s].child == 0)
+				table[s] = {hash, i + 1};
+		}
+		slots = childIndex.Publish(table);
+	}
+
+	uint32_t hash = HashName(key);
+	for (size_t s = hash & mask; slots[s].child != 0; s = (s + 1) & mask) {
+		if(slots[s].hash != hash)
+			continue;
+		EntNode* child = children[slots[s].child - 1];
+		if(child->getName() == key)
+			return *child;
+	}
+	return *SEARCH_404;
+}
+#endif
+
 bool EntNode::IsRoot() {
 	return parent == nullptr && nodeFlags == NFC_RootNode;
 }
@@ -44,10 +104,10 @@ bool EntNode::IsContainer() {
 bool EntNode::ValueInt(int& writeTo, int clampMin, int clampMax) const {
 	if (valLength == 0) return false;
 	
-	const char* firstChar = textPtr + nameLength;
+	const char* firstChar = ValuePtr();
 	int base = 1, value = 0;
 
-	for (const char* ptr = textPtr + nameLength + valLength - 1; ptr >= firstChar; ptr--) {
+	for (const char* ptr = firstChar + valLength - 1; ptr >= firstChar; ptr--) {
 
 		char c = *ptr;
 		if (c >= '0' && c <= '9') {
@@ -73,9 +133,9 @@ bool EntNode::ValueInt(int& writeTo, int clampMin, int clampMax) const {
 	return true;
 }
 
-std::shared_ptr<int> EntNode::TracePosition(int& nodeDepth) const
+void EntNode::TracePosition(std::vector<int>& indices) const
 {
-	// Get the depth so we know how much space to allocat
+	// Get the depth so we know how much space to allocate
 	int depth = 0;
 	const EntNode* currentParent = parent;
 	while (currentParent) {
@@ -83,12 +143,7 @@ std::shared_ptr<int> EntNode::TracePosition(int& nodeDepth) const
 		currentParent = currentParent->parent;
 	}
 
-	if (depth == 0) {
-		nodeDepth = 0;
-		return nullptr;
-	}
-
-	int* indices = new int[depth];
+	indices.resize(depth);
 	currentParent = parent;
 	const EntNode* lastParent = this;
 	for (int i = depth - 1; i > -1; i--) {
@@ -96,10 +151,6 @@ std::shared_ptr<int> EntNode::TracePosition(int& nodeDepth) const
 		lastParent = currentParent;
 		currentParent = currentParent->parent;
 	}
-
-	nodeDepth = depth;
-	std::shared_ptr<int> sptr(indices, [](int* p) {delete p;});
-	return sptr;
 }
 
 EntNode* EntNode::FromPositionTrace(EntNode* root, const int* nodeIndices, const int nodeDepth) 
@@ -113,6 +164,15 @@ EntNode* EntNode::FromPositionTrace(EntNode* root, const int* nodeIndices, const
 bool EntNode::searchText(const std::string& key, const bool caseSensitive, const bool exactLength)
 {
 	if(exactLength && key.length() != nameLength + valLength) return false;
+
+	// Zero-copy nodes have their name and value apart in the source text
+	std::string joined;
+	const char* textPtr = this->textPtr;
+	if (valGap > 0) {
+		joined.append(getName()).append(getValue());
+		textPtr = joined.data();
+	}
+
 	if (caseSensitive)
 	{
 		std::string_view s(textPtr, nameLength + valLength);
@@ -227,7 +287,30 @@ EntNode* EntNode::searchUpwardsLocal(const std::string& key, const bool caseSens
 	return SEARCH_404;
 }
 
-void EntNode::generateText(std::string& buffer, int wsIndex) const
+/*
+* Text sinks. Each implements the subset of std::string used by emitText
+*/
+
+struct textcounter_t {
+	size_t length = 0;
+
+	void append(const char* str, size_t count) { length += count; }
+	void append(size_t count, char c) { length += count; }
+	void append(const char* str) { length += strlen(str); }
+	void push_back(char c) { length++; }
+};
+
+struct textwriter_t {
+	char* ptr;
+
+	void append(const char* str, size_t count) { memcpy(ptr, str, count); ptr += count; }
+	void append(size_t count, char c) { memset(ptr, c, count); ptr += count; }
+	void append(const char* str) { append(str, strlen(str)); }
+	void push_back(char c) { *ptr++ = c; }
+};
+
+template<typename T>
+void EntNode::emitOpen(T& buffer, int& wsIndex) const
 {
 	buffer.append(wsIndex, '\t');
 	buffer.append(textPtr, nameLength);
@@ -239,7 +322,7 @@ void EntNode::generateText(std::string& buffer, int wsIndex) const
 	
 	if (valLength > 0) {
 		buffer.push_back(' ');
-		buffer.append(textPtr + nameLength, valLength);
+		buffer.append(ValuePtr(), valLength);
 	}
 
 	if(nodeFlags & NF_Semicolon)
@@ -252,11 +335,11 @@ void EntNode::generateText(std::string& buffer, int wsIndex) const
 
 	if(nodeFlags & NF_NoIndent)
 		wsIndex--;
-	
-	for (int i = 0; i < childCount; i++) {
-		children[i]->generateText(buffer, wsIndex + 1);
-		buffer.push_back('\n');
-	}
+}
+
+template<typename T>
+void EntNode::emitClose(T& buffer, int wsIndex) const
+{
 	if (nodeFlags & NF_Braces) {
 		if(wsIndex > 0)
 			buffer.append(wsIndex, '\t');
@@ -270,20 +353,137 @@ void EntNode::generateText(std::string& buffer, int wsIndex) const
 		buffer.push_back(',');
 }
 
+template<typename T>
+void EntNode::emitText(T& buffer, int wsIndex) const
+{
+	emitOpen(buffer, wsIndex);
+	for (int i = 0; i < childCount; i++) {
+		children[i]->emitText(buffer, wsIndex + 1);
+		buffer.push_back('\n');
+	}
+	emitClose(buffer, wsIndex);
+}
+
+void EntNode::generateText(std::string& buffer, int wsIndex) const
+{
+	emitText(buffer, wsIndex);
+}
+
+void EntNode::generateText(std::string& buffer, int wsIndex, const std::string* const* childTexts) const
+{
+	emitOpen(buffer, wsIndex);
+	for (int i = 0; i < childCount; i++) {
+		buffer.append(*childTexts[i]);
+		buffer.push_back('\n');
+	}
+	emitClose(buffer, wsIndex);
+}
+
+void EntNode::generateTextParallel(std::string& buffer, int wsIndex) const
+{
+	size_t threadCount = std::thread::hardware_concurrency();
+	if(threadCount == 0)
+		threadCount = 4;
+
+	if (childCount < PARALLEL_MIN_CHILDREN || threadCount == 1) {
+		emitText(buffer, wsIndex);
+		return;
+	}
+
+	// Several chunks per thread keeps every thread busy when some children are larger than others
+	struct chunk_t {
+		int first;
+		int max;
+		size_t length;
+		char* output;
+	};
+
+	int chunkLength = static_cast<int>(childCount / (threadCount * 4));
+	if(chunkLength < PARALLEL_MIN_CHILDREN / 4)
+		chunkLength = PARALLEL_MIN_CHILDREN / 4;
+
+	std::vector<chunk_t> chunks;
+	for(int i = 0; i < childCount; i += chunkLength)
+		chunks.push_back({i, std::min(i + chunkLength, childCount), 0, nullptr});
+
+	if(threadCount > chunks.size())
+		threadCount = chunks.size();
+
+	// Runs a pass over every chunk, with each thread taking the next unclaimed chunk
+	auto RunChunks = [&](auto&& pass) {
+		std::atomic<size_t> nextChunk = 0;
+		auto ChunkThread = [&]() {
+			for (size_t c = nextChunk++; c < chunks.size(); c = nextChunk++)
+				pass(chunks[c]);
+		};
+
+		std::vector<std::thread> threads;
+		for(size_t i = 1; i < threadCount; i++)
+			threads.emplace_back(ChunkThread);
+		ChunkThread();
+		for(std::thread& t : threads)
+			t.join();
+	};
+
+	int indent = wsIndex;
+	textcounter_t openCounter, closeCounter;
+	emitOpen(openCounter, indent);
+	emitClose(closeCounter, indent);
+
+	RunChunks([&](chunk_t& chunk) {
+		textcounter_t counter;
+		for (int i = chunk.first; i < chunk.max; i++) {
+			children[i]->emitText(counter, indent + 1);
+			counter.push_back('\n');
+		}
+		chunk.length = counter.length;
+	});
+
+	// Size the buffer exactly, then give each chunk it's own range of it
+	size_t start = buffer.length(), length = openCounter.length + closeCounter.length;
+	for(const chunk_t& chunk : chunks)
+		length += chunk.length;
+	buffer.resize(start + length);
+
+	textwriter_t writer = {&buffer[start]};
+	emitOpen(writer, wsIndex);
+	for (chunk_t& chunk : chunks) {
+		chunk.output = writer.ptr;
+		writer.ptr += chunk.length;
+	}
+	emitClose(writer, wsIndex);
+
+	RunChunks([&](chunk_t& chunk) {
+		textwriter_t chunkWriter = {chunk.output};
+		for (int i = chunk.first; i < chunk.max; i++) {
+			children[i]->emitText(chunkWriter, indent + 1);
+			chunkWriter.push_back('\n');
+		}
+	});
+}
+
 size_t EntNode::writeToFile(const std::string filepath, const size_t sizeHint, const bool oodleCompress, const char* eofblob, size_t eofbloblength, const bool debug_logTime)
 {
 	auto timeStart = std::chrono::high_resolution_clock::now();
-	// 25% of time spent writing to output buffer, 75% on generateText
+	// Text is generated straight into the buffer handed to the compressor
 
 	std::string raw;
 	raw.reserve(sizeHint);
-	generateText(raw);
+	generateTextParallel(raw);
 
 	if(debug_logTime)
 		EntityLogger::logTimeStamps("Generate Text Duration: ", timeStart);
 
 	timeStart = std::chrono::high_resolution_clock::now();
+	size_t length = writeTextToFile(raw, filepath, oodleCompress, eofblob, eofbloblength);
+
+	if (debug_logTime)
+		EntityLogger::logTimeStamps("Writing Duration: ", timeStart);
+	return length;
+}
 
+size_t EntNode::writeTextToFile(std::string& raw, const std::string& filepath, const bool oodleCompress, const char* eofblob, size_t eofbloblength)
+{
 	if (eofbloblength > 0) {
 		raw.push_back('\0');
 		raw.append(eofblob, eofbloblength);
@@ -294,9 +494,11 @@ size_t EntNode::writeToFile(const std::string filepath, const size_t sizeHint, c
 
 	if (oodleCompress)
 	{
-		char* compressedData = new char[raw.length() + 65536];
+		Codec& codec = AtlanCodec::Active();
+		size_t compressedCapacity = codec.CompressBound(raw.length());
+		char* compressedData = new char[compressedCapacity + 16];
 		size_t compressedSize;
-		if (Oodle::CompressBuffer(raw.data(), raw.length(), compressedData + 16, compressedSize)) {
+		if (codec.Compress(raw.data(), raw.length(), compressedData + 16, compressedCapacity, compressedSize)) {
 			((size_t*)compressedData)[0] = raw.length();
 			((size_t*)compressedData)[1] = compressedSize;
 			output.write(compressedData, compressedSize + 16);
@@ -310,7 +512,5 @@ size_t EntNode::writeToFile(const std::string filepath, const size_t sizeHint, c
 	else output << raw;
 
 	output.close();
-	if (debug_logTime)
-		EntityLogger::logTimeStamps("Writing Duration: ", timeStart);
 	return raw.length();
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <string_view>
 #include <memory>
+#include <atomic>
+#include <vector>
 #include "ParserConfig.h"
 
 #if entityparser_wxwidgets
@@ -43,12 +45,13 @@ class EntNode
 	private:
 	EntNode* parent = nullptr;
 	EntNode** children = nullptr; // Unused by value nodes
-	char* textPtr = nullptr; // Pointer to text buffer with data [name][value]
+	char* textPtr = nullptr; // Pointer to text buffer with data [name][gap][value]
 	int childCount = 0;
 	int maxChildren = 0;
 	short nameLength = 0;
 	short valLength = 0;
 	uint16_t nodeFlags = 0;
+	uint8_t valGap = 0; // Non-zero only when textPtr points into a zero-copy parser's source text
 
 	//NodeType TYPE = NodeType::UNDESIGNATED;
 
@@ -57,6 +60,49 @@ class EntNode
 	// regardless of what filters are being applied (Possible todo: test if they pass filters first?)
 	bool filtered = true; 
 
+	#if entityparser_childindex
+	/*
+	* Hash table of child indices, used by key lookups on nodes with at least
+	* CHILDINDEX_MIN children. The first lookup builds it, and the EntityParser
+	* discards it whenever it edits the children or their names. Lookups
+	* may build it from multiple threads at once. Copies never share an index
+	*/
+	class ChildIndex {
+		public:
+		struct slot_t {
+			uint32_t hash;
+			int child; // Child index + 1, or 0 if the slot is empty
+		};
+
+		private:
+		mutable std::atomic<slot_t*> slots = nullptr;
+
+		public:
+		ChildIndex() = default;
+		ChildIndex(const ChildIndex& b) {}
+		ChildIndex& operator=(const ChildIndex& b) { Reset(); return *this; }
+		~ChildIndex() { Reset(); }
+
+		const slot_t* Get() const { return slots.load(std::memory_order_acquire); }
+
+		// Installs a table built by a lookup, unless another thread installed one first
+		const slot_t* Publish(slot_t* table) const;
+
+		void Reset() { delete[] slots.exchange(nullptr); }
+	};
+
+	static const int CHILDINDEX_MIN = 32;
+	ChildIndex childIndex;
+
+	EntNode& IndexedChild(const std::string_view key) const;
+	#endif
+
+	void ResetChildIndex() {
+		#if entityparser_childindex
+		childIndex.Reset();
+		#endif
+	}
+
 	public:
 	EntNode() {}
 
@@ -70,7 +116,7 @@ class EntNode
 
 	std::string_view getName() const  {return std::string_view(textPtr, nameLength); }
 
-	std::string_view getValue() const {return std::string_view(textPtr + nameLength, valLength); }
+	std::string_view getValue() const {return std::string_view(textPtr + nameLength + valGap, valLength); }
 
 	bool hasValue() const {return valLength > 0;};
 
@@ -89,11 +135,12 @@ class EntNode
 	std::string_view getValueUQ() const {
 		if(valLength == 0)
 			return "";
-		if(textPtr[nameLength] == '"')
-			return std::string_view(textPtr + nameLength + 1, valLength - 2);
-		if(textPtr[nameLength] == '<')
-			return std::string_view(textPtr + nameLength + 2, valLength - 4);
-		return std::string_view(textPtr + nameLength, valLength);
+		const char* valPtr = ValuePtr();
+		if(*valPtr == '"')
+			return std::string_view(valPtr + 1, valLength - 2);
+		if(*valPtr == '<')
+			return std::string_view(valPtr + 2, valLength - 4);
+		return std::string_view(valPtr, valLength);
 	}
 
 	#if entityparser_wxwidgets
@@ -113,7 +160,7 @@ class EntNode
 
 	const char* NamePtr() const {return textPtr;}
 
-	const char* ValuePtr() const {return textPtr + nameLength;}
+	const char* ValuePtr() const {return textPtr + nameLength + valGap;}
 
 	int NameLength() const { return nameLength; }
 
@@ -202,23 +249,29 @@ class EntNode
 	}
 
 	/*
-	* Returns a dynamically allocated list of indices. Provides a list
-	* of node child indices you can trace through to find the node this was called on
+	* Fills a list of node child indices you can trace through
+	* to find the node this was called on
 	*/
-	std::shared_ptr<int> TracePosition(int& nodeDepth) const;
+	void TracePosition(std::vector<int>& indices) const;
 
 	static EntNode* FromPositionTrace(EntNode* root, const int* indices, const int nodeDepth);
 
 
 	/*
 	* Searches the node's children for a node whose name equals the given key
-	* The name must be an exact match.
+	* The name must be an exact match. Nodes with many children are searched
+	* through a hashed index instead of a linear scan
 	* 
 	* @param key - the name to search for
 	* @return The first child with the given name, or 404 Node if not found
 	*/
 	EntNode& operator[](const std::string_view key) const
 	{
+		#if entityparser_childindex
+		if(childCount >= CHILDINDEX_MIN)
+			return IndexedChild(key);
+		#endif
+
 		for (int i = 0; i < childCount; i++)
 		{
 			if(children[i]->nameLength != key.length())
@@ -245,7 +298,7 @@ class EntNode
 	bool ValueBool(bool& writeTo) const {
 		if(valLength == 0) return false;
 
-		const char* ptr = textPtr + nameLength;
+		const char* ptr = ValuePtr();
 
 		if (valLength == 1) {
 			if (*ptr == '0') {
@@ -328,15 +381,52 @@ class EntNode
 
 	void generateText(std::string& buffer, int wsIndex = 0) const;
 
+	/*
+	* Appends the same text as generateText, with the children divided between threads.
+	* Each thread measures the exact length of it's children, then writes them
+	* straight into their final position in the buffer, so the buffer is only
+	* resized once and no text is copied afterward. Nodes with fewer than
+	* PARALLEL_MIN_CHILDREN children are generated on the calling thread
+	*/
+	void generateTextParallel(std::string& buffer, int wsIndex = 0) const;
+
+	/*
+	* Appends this node's text, copying the text of each child from childTexts instead
+	* of generating it. childTexts holds one string per child, generated at ChildIndent(wsIndex)
+	*/
+	void generateText(std::string& buffer, int wsIndex, const std::string* const* childTexts) const;
+
+	// Indentation of this node's children when it's generated at the given indentation
+	int ChildIndent(int wsIndex) const { return (nodeFlags & NF_NoIndent ? wsIndex - 1 : wsIndex) + 1; }
+
+	private:
+	static const int PARALLEL_MIN_CHILDREN = 256;
+
+	/*
+	* Text generation is written once against a sink, and instantiated for std::string,
+	* a length counter, and a raw pointer writer. The node's text is split around it's children
+	*/
+	template<typename T> void emitText(T& out, int wsIndex) const;
+	template<typename T> void emitOpen(T& out, int& wsIndex) const;  // Name, value and opening brace
+	template<typename T> void emitClose(T& out, int wsIndex) const;  // Closing brace and comma
+
+	public:
 
 	/*
 	* Converts the entirety of this node into text and saves
 	* the result to a file
 	* @param filepath File to write to
 	* @param sizeHint Estimation of the uncompressed file size
-	* @param oodleCompress If true, compress the file
+	* @param oodleCompress If true, compress the file with the active codec
 	* @param debug_logTime If true, output execution time data.
 	* @return The uncompressed file size
 	*/
 	size_t writeToFile(const std::string filepath, const size_t sizeHint, const bool oodleCompress, const char* eofblob, size_t eofbloblength, const bool debug_logTime = false);
+
+	/*
+	* Saves generated text to a file, appending the binary blob and compressing it if requested.
+	* The blob is appended to raw
+	* @return The uncompressed file size
+	*/
+	static size_t writeTextToFile(std::string& raw, const std::string& filepath, const bool oodleCompress, const char* eofblob, size_t eofbloblength);
 };
\ No newline at end of file
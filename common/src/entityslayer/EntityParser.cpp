@@ -1,8 +1,13 @@
 #pragma warning(disable : 4996) // Deprecation errors
 #include <fstream>
-#include "Oodle.h"
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "atlan/AtlanCodec.h"
 #include "EntityLogger.h"
 #include "EntityParser.h"
+#include "ParserSimd.h"
 
 #if entityparser_wxwidgets
 #include "EntityEditor.h"
@@ -50,53 +55,19 @@ EntityParser::EntityParser() : fileWasCompressed(false), PARSEMODE(ParsingMode::
 
 EntityParser::EntityParser(ParsingMode mode) : fileWasCompressed(false), PARSEMODE(mode) {}
 
-EntityParser::EntityParser(const std::string& filepath, const ParsingMode mode, const bool debug_logParseTime)
+EntityParser::EntityParser(const std::string& filepath, const ParsingMode mode, const bool debug_logParseTime, const bool zeroCopy)
 	: PARSEMODE(mode)
 {
 	auto timeStart = std::chrono::high_resolution_clock::now();
 
-	struct filebuffer_t {
-		char* data = nullptr;
-		size_t len = 0;
+	size_t textLength = 0;
+	std::unique_ptr<char[]> text = ReadText(filepath, textLength, fileWasCompressed);
+	std::string_view textView(text.get(), textLength);
 
-		~filebuffer_t() {
-			delete[] data;
-		}
-	};
-
-	filebuffer_t raw;
-	filebuffer_t decomp;
-	std::string_view textView;
-
-	{
-		std::ifstream file(filepath, std::ios_base::binary); // Binary mode 50% faster than 'in' mode, keeps CR chars
-		if (!file.is_open())
-			throw std::runtime_error("Could not open file");
-
-		// Tellg() does not guarantee the length of the file but this works in practice for binary mode
-		file.seekg(0, std::ios_base::end);
-		raw.len = static_cast<size_t>(file.tellg());
-		raw.data = new char[raw.len];
-		file.seekg(0, std::ios_base::beg);
-		file.read(raw.data, raw.len);
-		file.close();
-	}
-
-	if (raw.len > 16 && (unsigned char)raw.data[16] == 0x8C) // Oodle compression signature
-	{
-		fileWasCompressed = true;
-		decomp.len = ((size_t*)raw.data)[0];
-		decomp.data = new char[decomp.len];
-		size_t compressedSize = ((size_t*)raw.data)[1];
-
-		if (!Oodle::DecompressBuffer(raw.data + 16, compressedSize, decomp.data, decomp.len))
-			throw std::runtime_error("Could not decompress .entities file");
-		textView = std::string_view(decomp.data, decomp.len);
-	}
-	else
-	{
-		fileWasCompressed = false;
-		textView = std::string_view(raw.data, raw.len);
+	if (zeroCopy) {
+		sourceText = std::move(text);
+		sourceStart = textView.data();
+		sourceEnd = textView.data() + textView.length();
 	}
 
 	lastUncompressedSize = textView.length();
@@ -126,16 +97,113 @@ EntityParser::EntityParser(const std::string& filepath, const ParsingMode mode,
 	}
 }
 
-EntityParser::EntityParser(const ParsingMode mode, const std::string_view data, const bool debug_logParseTime) : PARSEMODE(mode), fileWasCompressed(false)
+std::unique_ptr<char[]> EntityParser::ReadText(const std::string& filepath, size_t& length, bool& compressed)
 {
+	std::unique_ptr<char[]> raw;
+	size_t rawLength = 0;
+	{
+		std::ifstream file(filepath, std::ios_base::binary); // Binary mode 50% faster than 'in' mode, keeps CR chars
+		if (!file.is_open())
+			throw std::runtime_error("Could not open file");
+
+		// Tellg() does not guarantee the length of the file but this works in practice for binary mode
+		file.seekg(0, std::ios_base::end);
+		rawLength = static_cast<size_t>(file.tellg());
+		raw.reset(new char[rawLength]);
+		file.seekg(0, std::ios_base::beg);
+		file.read(raw.get(), rawLength);
+		file.close();
+	}
+
+	if (rawLength > 16 && AtlanCodec::Active().Recognizes(raw.get() + 16, rawLength - 16)) // Compression signature
+	{
+		compressed = true;
+		length = ((size_t*)raw.get())[0];
+		std::unique_ptr<char[]> decomp(new char[length]);
+		size_t compressedSize = ((size_t*)raw.get())[1];
+
+		if (!AtlanCodec::Active().Decompress(raw.get() + 16, compressedSize, decomp.get(), length))
+			throw std::runtime_error("Could not decompress .entities file");
+		return decomp;
+	}
+
+	compressed = false;
+	length = rawLength;
+	return raw;
+}
+
+EntityParser::EntityParser(const ParsingMode mode, const std::string_view data, const bool debug_logParseTime, const bool zeroCopy) : PARSEMODE(mode), fileWasCompressed(false)
+{
+	if (zeroCopy) {
+		sourceStart = data.data();
+		sourceEnd = data.data() + data.length();
+	}
 	lastUncompressedSize = data.length();
 	firstparse(data, debug_logParseTime);
 }
 
+/*
+New strategy to prevent nodes with irregularly large numbers of children
+from creating runaway allocations. This implementation is more generalized
+and maintainable compared to the original solution meant to exclusively
+handle the large root child counts of .entities files
+*/
+int OptimalMaxChildCount(int childCount) {
+	if (childCount > 100) {
+		// More non-root nodes can have more than 100 children than you might initially believe
+		// Hence we should do multiplication instead of flat adding 1000 to every oversized childCount
+		int addition = childCount * 0.1;
+		if (addition > 1000)
+			addition = 1000;
+		return childCount + addition;
+	}
+	else return childCount;
+}
+
 void EntityParser::firstparse(std::string_view textView, const bool debuglog)
 {
 	auto timeStart = std::chrono::high_resolution_clock::now();
 
+	textView = splitBlob(textView);
+
+	if (PARSEMODE == ParsingMode::ENTITIES && textView.length() >= PARALLEL_MIN_LENGTH) {
+		parseParallel(textView, debuglog);
+		return;
+	}
+
+	initAllocators(textView, 1000);
+
+	if (debuglog)
+	{
+		EntityLogger::logTimeStamps("Node Buffer Init Duration: ", timeStart);
+		timeStart = std::chrono::high_resolution_clock::now();
+	}
+
+	ParseResult presult;
+	initiateParse(textView, &root, &root, presult);
+
+	if (debuglog)
+		EntityLogger::logTimeStamps("Parsing Duration: ", timeStart);
+}
+
+std::string_view EntityParser::splitBlob(std::string_view textView)
+{
+	// If the text contains a null byte, then the file has a binary blob at the end of it
+	const char* nullbyte = static_cast<const char*>(memchr(textView.data(), '\0', textView.length()));
+	if(nullbyte == nullptr)
+		return textView;
+
+	const char* blobstart = nullbyte + 1; // Increment past the null byte
+	delete[] eofblob;
+	eofbloblength = textView.data() + textView.length() - blobstart;
+	eofblob = new char[eofbloblength];
+	memcpy(eofblob, blobstart, eofbloblength);
+
+	return std::string_view(textView.data(), nullbyte - textView.data());
+}
+
+void EntityParser::initAllocators(std::string_view textView, const size_t slack)
+{
 	// Simpler char analysis algorithm that runs ~10 MS faster compared to old doubled runtime
 	// Ensure it's unsigned if you don't want cursed stack corruption
 	size_t counts[256] = { 0 };
@@ -144,37 +212,24 @@ void EntityParser::firstparse(std::string_view textView, const bool debuglog)
 		const uint8_t* itermax = iter + textView.length();
 
 		while (iter < itermax) {
-			if (*iter == '\0')
-				break;
-
 			counts[*iter]++;
 			iter++;
 		}
-
-		// If we broke early, then the file has a binary blob at the end of it
-		if (iter < itermax) {
-
-			textView = std::string_view(textView.data(), (char*)iter - textView.data());
-			iter++; // Increment past the null byte
-
-			eofbloblength = itermax - iter; // Minus one since textView contains a final null terminator
-			eofblob = new char[eofbloblength];
-			memcpy(eofblob, iter, eofbloblength);
-
-			//EntityLogger::log("Found blob");
-		}
 	}
 
+	// Zero-copy nodes only need text buffers for the nodes that can't borrow their text
+	const bool copyText = sourceStart == nullptr;
+
 	// Distinguishes between the number of chars comprising actual identifiers/values versus syntax chars
 	if (PARSEMODE == ParsingMode::JSON) {
 		size_t charBufferSize = textView.length()
 			- counts['\t'] - counts['\n'] - counts['\r'] - counts['}'] - counts['{']
 			- counts[':'] - counts[','] - counts['['] - counts[']'] - counts[' ']
-			+ 100000;
-		allocs.text.setActiveBuffer(charBufferSize);
+			+ slack * 100;
+		allocs.text.setActiveBuffer(copyText ? charBufferSize : slack * 100);
 
 		// This should give us an exact count of how many nodes exist in the file
-		size_t nodeCount = counts[','] + counts['{'] + counts['['] + 1000;
+		size_t nodeCount = counts[','] + counts['{'] + counts['['] + slack;
 		allocs.nodes.setActiveBuffer(nodeCount);
 		allocs.children.setActiveBuffer(nodeCount);
 	}
@@ -183,46 +238,253 @@ void EntityParser::firstparse(std::string_view textView, const bool debuglog)
 			- counts['\t'] - counts['\n'] - counts['\r'] - counts['}'] - counts['{'] - counts[';']
 			- counts['=']
 			- counts[' '] // This is an overestimate - string values will uncommonly contain spaces
-			+ 100000;
-		allocs.text.setActiveBuffer(charBufferSize);
+			+ slack * 100;
+		allocs.text.setActiveBuffer(copyText ? charBufferSize : slack * 100);
 
 		// For a well-formatted .entities file, we can get an exact count of how many nodes we must
 		// allocate by subtracting the number of closing braces from the number of lines
 		size_t numCloseBraces = counts['}'] > counts['\n'] ? counts['\n'] : counts['}']; // Prevents disastrous overflow
-		size_t initialBufferSize = counts['\n'] - numCloseBraces + 1000;
+		size_t initialBufferSize = counts['\n'] - numCloseBraces + slack;
 		allocs.nodes.setActiveBuffer(initialBufferSize);
 		allocs.children.setActiveBuffer(initialBufferSize);
 	}
+}
+
+// Stops at characters that change the brace depth, or begin a string or comment
+struct blockcode_t {
+	bool Stops(char c) const {
+		return c == '{' || c == '}' || c == '"' || c == '/';
+	}
+
+	template<typename V> V Stops(V v) const {
+		using namespace ParserSimd;
+		return Or(Or(Equal(v, '{'), Equal(v, '}')), Or(Equal(v, '"'), Equal(v, '/')));
+	}
+};
+
+/*
+* Splits the text at the ends of top-level brace blocks, into chunks of at least
+* chunkLength characters. A top-level closing brace always ends a statement of the
+* file grammar, so each chunk parses identically to how it would in one parse.
+* 
+* Strings and comments are skipped the same way the tokenizer skips them. The text
+* is classified 64 characters at a time, and only the characters that can end the
+* current state are walked, as bits. If the braces become unbalanced, or a string
+* never ends, the rest of the text is left as one chunk so the parser can report the error.
+*/
+static std::vector<std::string_view> SplitTopLevelBlocks(std::string_view text, const size_t chunkLength)
+{
+	using namespace ParserSimd;
+
+	enum splitstate_t {
+		SS_CODE,
+		SS_STRING,
+		SS_LINECOMMENT,
+		SS_BLOCKCOMMENT
+	};
+
+	std::vector<std::string_view> chunks;
+	const char* data = text.data();
+	const size_t length = text.length();
+	size_t chunkStart = 0;
+	size_t commentStart = 0;  // Index of the slash beginning the active block comment
+	size_t depth = 0;
+	splitstate_t state = SS_CODE;
+
+	for (size_t blockStart = 0; blockStart < length; blockStart += 64) {
+		const char* block = data + blockStart;
+
+		// Pad the final partial block with characters that never stop a scan
+		char padded[64];
+		if (length - blockStart < 64) {
+			memset(padded, ' ', 64);
+			memcpy(padded, block, length - blockStart);
+			block = padded;
+		}
+
+		uint64_t masks[4];
+		masks[SS_CODE] = Mask64(block, blockcode_t());
+		masks[SS_LINECOMMENT] = Mask64(block, lineend_t());
+		masks[SS_STRING] = masks[SS_LINECOMMENT] | Mask64(block, char_t{'"'});
+		masks[SS_BLOCKCOMMENT] = Mask64(block, char_t{'/'});
+
+		// Bits below this position were consumed by an earlier stop
+		uint64_t remaining = ~0ULL;
+		uint64_t stops;
+		while ((stops = masks[state] & remaining) != 0) {
+			uint32_t bit = FirstBit64(stops);
+			remaining = bit == 63 ? 0 : ~0ULL << (bit + 1);
+
+			size_t i = blockStart + bit;
+			const char c = data[i];
+			switch (state)
+			{
+				case SS_CODE:
+				if (c == '{') {
+					depth++;
+				}
+				else if (c == '}') {
+					if(depth == 0)
+						goto LABEL_DONE;
+					if (--depth == 0 && i + 1 - chunkStart >= chunkLength) {
+						chunks.emplace_back(data + chunkStart, i + 1 - chunkStart);
+						chunkStart = i + 1;
+					}
+				}
+				else if (c == '"') {
+					state = SS_STRING;
+				}
+				else if (i + 1 < length) { // The tokenizer rejects any other character after a slash
+					if (data[i + 1] == '/')
+						state = SS_LINECOMMENT;
+					else if (data[i + 1] == '*') {
+						state = SS_BLOCKCOMMENT;
+						commentStart = i;
+					}
+				}
+				break;
+
+				case SS_STRING:
+				if(c != '"')
+					goto LABEL_DONE;
+				state = SS_CODE;
+				break;
+
+				case SS_LINECOMMENT:
+				state = SS_CODE;
+				break;
+
+				// The closing asterisk can't be the opening one, so "/*/" doesn't end the comment
+				case SS_BLOCKCOMMENT:
+				if(i >= commentStart + 3 && data[i - 1] == '*')
+					state = SS_CODE;
+				break;
+			}
+		}
+	}
+
+	LABEL_DONE:
+	if(chunkStart < length || chunks.empty())
+		chunks.emplace_back(data + chunkStart, length - chunkStart);
+	return chunks;
+}
+
+void EntityParser::parseParallel(std::string_view textView, const bool debuglog)
+{
+	auto timeStart = std::chrono::high_resolution_clock::now();
+
+	size_t threadCount = std::thread::hardware_concurrency();
+	if(threadCount == 0)
+		threadCount = 4;
+
+	// Several chunks per thread keeps every thread busy when some blocks parse slower than others
+	size_t chunkLength = textView.length() / (threadCount * 4);
+	if(chunkLength < PARALLEL_MIN_CHUNK)
+		chunkLength = PARALLEL_MIN_CHUNK;
+
+	struct chunk_t {
+		std::string_view text;
+		std::unique_ptr<EntityParser> parser;
+		bool parsed = false;
+	};
+
+	std::vector<chunk_t> chunks;
+	for (std::string_view text : SplitTopLevelBlocks(textView, chunkLength))
+		chunks.emplace_back().text = text;
+
+	if(threadCount > chunks.size())
+		threadCount = chunks.size();
 
 	if (debuglog)
 	{
-		EntityLogger::logTimeStamps("Node Buffer Init Duration: ", timeStart);
+		EntityLogger::log("Parallel Parse: " + std::to_string(chunks.size()) + " chunks, " + std::to_string(threadCount) + " threads");
+		EntityLogger::logTimeStamps("Chunk Split Duration: ", timeStart);
 		timeStart = std::chrono::high_resolution_clock::now();
 	}
 
-	ParseResult presult;
-	initiateParse(textView, &root, &root, presult);
+	// Each chunk is parsed into it's own allocators, so threads never share state
+	std::atomic<size_t> nextChunk = 0;
+	std::atomic<bool> chunksOkay = true;
+	auto ChunkThread = [&]() {
+		while (chunksOkay) {
+			size_t c = nextChunk++;
+			if(c >= chunks.size())
+				break;
 
-	if (debuglog)
-		EntityLogger::logTimeStamps("Parsing Duration: ", timeStart);
-}
+			chunk_t& chunk = chunks[c];
+			chunk.parser.reset(new EntityParser(PARSEMODE));
 
-/*
-New strategy to prevent nodes with irregularly large numbers of children
-from creating runaway allocations. This implementation is more generalized
-and maintainable compared to the original solution meant to exclusively
-handle the large root child counts of .entities files
-*/
-int OptimalMaxChildCount(int childCount) {
-	if (childCount > 100) {
-		// More non-root nodes can have more than 100 children than you might initially believe
-		// Hence we should do multiplication instead of flat adding 1000 to every oversized childCount
-		int addition = childCount * 0.1;
-		if (addition > 1000)
-			addition = 1000;
-		return childCount + addition;
+			EntityParser& p = *chunk.parser;
+			p.sourceStart = sourceStart;
+			p.sourceEnd = sourceEnd;
+			p.initAllocators(chunk.text, 10);
+			try {
+				ParseResult presult;
+				p.initiateParse(chunk.text, &p.root, &p.root, presult);
+				chunk.parsed = true;
+			}
+			catch (std::runtime_error&) {
+				chunksOkay = false;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(size_t i = 1; i < threadCount; i++)
+		threads.emplace_back(ChunkThread);
+	ChunkThread();
+	for(std::thread& t : threads)
+		t.join();
+
+	/*
+	* Threads stop taking chunks after any failure, so chunks before the failed one may
+	* be unparsed. Starting from the first chunk that wasn't parsed, chunks are reparsed
+	* one at a time from their true line numbers. The first to fail throws the error a
+	* single-threaded parse would've thrown, with the correct line
+	*/
+	if (!chunksOkay) {
+		size_t c = 0;
+		while(chunks[c].parsed)
+			c++;
+
+		for (; c < chunks.size(); c++) {
+			EntityParser p(PARSEMODE);
+			p.firstLine = 1 + std::count(textView.data(), chunks[c].text.data(), '\n');
+			p.initAllocators(chunks[c].text, 10);
+			ParseResult presult;
+			p.initiateParse(chunks[c].text, &p.root, &p.root, presult);
+		}
+		throw std::runtime_error("Parallel parse failed without a parsing error");
 	}
-	else return childCount;
+
+	// Stitch every chunk's top-level nodes under the root, in their original order
+	int childCount = 0;
+	for (chunk_t& chunk : chunks) {
+		allocs.text.absorb(chunk.parser->allocs.text);
+		allocs.nodes.absorb(chunk.parser->allocs.nodes);
+		allocs.children.absorb(chunk.parser->allocs.children);
+		childCount += chunk.parser->root.childCount;
+	}
+
+	root.childCount = childCount;
+	root.maxChildren = OptimalMaxChildCount(childCount);
+	root.children = allocs.children.reserveBlock(root.maxChildren);
+
+	EntNode** rootChild = root.children;
+	for (chunk_t& chunk : chunks) {
+		EntNode& chunkRoot = chunk.parser->root;
+		for (int i = 0; i < chunkRoot.childCount; i++) {
+			chunkRoot.children[i]->parent = &root;
+			*rootChild++ = chunkRoot.children[i];
+		}
+		allocs.children.freeBlock(chunkRoot.children, chunkRoot.maxChildren);
+		chunkRoot.children = nullptr;
+		chunkRoot.childCount = 0;
+		chunkRoot.maxChildren = 0;
+	}
+
+	if (debuglog)
+		EntityLogger::logTimeStamps("Parsing Duration: ", timeStart);
 }
 
 ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent, int insertionIndex, int removeCount, bool renumberLists, bool highlightNew)
@@ -234,14 +496,34 @@ ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent,
 	initiateParse(text, &tempRoot, parent, outcome);
 	if(!outcome.success) return outcome;
 
+	SpliceNodes(parent, insertionIndex, removeCount, tempRoot.children, tempRoot.childCount, highlightNew);
+	allocs.children.freeBlock(tempRoot.children, tempRoot.maxChildren);
+
+	if (renumberLists)
+	{
+		for (int i = insertionIndex, max = insertionIndex + tempRoot.childCount; i < max; i++)
+			fixListNumberings(parent->children[i], true, false);
+			
+		if(parent != &root) // Don't waste time reordering the root children, there shouldn't be a list there
+			fixListNumberings(parent, false, false);
+	}
+	return outcome;
+}
+
+void EntityParser::SpliceNodes(EntNode* parent, int insertionIndex, int removeCount, EntNode* const* nodes, int nodeCount, bool highlightNew)
+{
+	DirtyEntity(parent);
+
 	// Give every node a comma - we'll ensure the (possibly new) last child has no
 	// comma after merging the children
 	if (PARSEMODE == ParsingMode::JSON) {
-		if(parent->childCount > 0)
+		if (parent->childCount > 0) {
 			parent->children[parent->childCount - 1]->nodeFlags |= EntNode::NF_Comma;
+			DirtyEntity(parent->children[parent->childCount - 1]);
+		}
 
-		if(tempRoot.childCount > 0)
-			tempRoot.children[tempRoot.childCount - 1]->nodeFlags |= EntNode::NF_Comma;
+		if(nodeCount > 0)
+			nodes[nodeCount - 1]->nodeFlags |= EntNode::NF_Comma;
 	}
 
 	// Populate these with nodes we might need to remove/add to the dataview
@@ -253,36 +535,40 @@ ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent,
 	wxDataViewItemArray removedNodes;
 	wxDataViewItemArray addedNodes;
 
-	// Build the reverse command
+	// Build the reverse command, which takes ownership of the removed nodes
 	#if entityparser_history
 	reverseGroup.emplace_back();
 	ParseCommand& reverse = reverseGroup.back();
 	reverse.type = CommandType::EDIT_TREE;
-	reverse.parentPositionTrace = parent->TracePosition(reverse.parentDepth);
+	parent->TracePosition(reverse.parentPositionTrace);
 	reverse.insertionIndex = insertionIndex;
-	reverse.removalCount = tempRoot.childCount;
+	reverse.removalCount = nodeCount;
+	reverse.nodes.reserve(removeCount);
+	reverse.memory = sizeof(ParseCommand) + reverse.parentPositionTrace.capacity() * sizeof(int) + removeCount * sizeof(EntNode*);
 	#endif
 	for (int i = 0; i < removeCount; i++) {
 		EntNode* n = parent->children[insertionIndex + i];
+		if(n->filtered) // Not all nodes we're removing may be filtered in
+			removedNodes.push_back(wxDataViewItem(n));
 
 		#if entityparser_history
-		n->generateText(reverse.text);
-		reverse.text.push_back('\n');
+		ForgetEntity(n);
+		reverse.nodes.push_back(n);
+		reverse.memory += DetachedMemory(n);
+		#else
+		freeNode(n); // Deallocate deleted nodes
 		#endif
-
-		// Deallocate deleted nodes
-		if(n->filtered) // Not all nodes we're removing may be filtered in
-			removedNodes.push_back(wxDataViewItem(n));
-		freeNode(n);
 	}
 
 	// Prep. the new nodes to be fully integrated into the tree
-	for (int i = 0; i < tempRoot.childCount; i++)
+	for (int i = 0; i < nodeCount; i++)
 	{
-		EntNode* n = tempRoot.children[i];
+		EntNode* n = nodes[i];
 		n->parent = parent;
-		if(n->filtered) // Future-proofing
-			addedNodes.push_back(wxDataViewItem(n));
+		// Nodes restored by the history may have been filtered out before their removal.
+		// Filters only ever exclude top-level entities, so their descendants never need resetting
+		n->filtered = true;
+		addedNodes.push_back(wxDataViewItem(n));
 	}
 
 	/* 
@@ -291,7 +577,7 @@ ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent,
 	* 2. Deallocate the old child buffers
 	* 3. Assign the new child buffer/child count to the parent
 	*/
-	int newNumChildren = parent->childCount + tempRoot.childCount - removeCount;
+	int newNumChildren = parent->childCount + nodeCount - removeCount;
 
 	if (newNumChildren > parent->maxChildren) {
 		int newMaxChildren = OptimalMaxChildCount(newNumChildren);
@@ -301,8 +587,8 @@ ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent,
 		int inc = 0;
 		for (inc = 0; inc < insertionIndex; inc++)
 			newChildBuffer[inc] = parent->children[inc];
-		for (int i = 0; i < tempRoot.childCount; i++)
-			newChildBuffer[inc++] = tempRoot.children[i];
+		for (int i = 0; i < nodeCount; i++)
+			newChildBuffer[inc++] = nodes[i];
 		for (int i = insertionIndex + removeCount; i < parent->childCount; i++)
 			newChildBuffer[inc++] = parent->children[i];
 
@@ -325,17 +611,19 @@ ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent,
 			for (int i = min, max = parent->childCount; i < max; i++)
 				parent->children[i + difference] = parent->children[i];
 
-		for (int inc = insertionIndex, i = 0, max = tempRoot.childCount; i < max; inc++, i++)
-			parent->children[inc] = tempRoot.children[i];
+		for (int inc = insertionIndex, i = 0; i < nodeCount; inc++, i++)
+			parent->children[inc] = nodes[i];
 	}
 
 	// Common to both branches
-	allocs.children.freeBlock(tempRoot.children, tempRoot.maxChildren);
 	parent->childCount = newNumChildren;
+	parent->ResetChildIndex();
 
 	if (PARSEMODE == ParsingMode::JSON) {
-		if(parent->childCount > 0)
+		if (parent->childCount > 0) {
 			parent->children[parent->childCount - 1]->nodeFlags &= ~EntNode::NF_Comma;
+			DirtyEntity(parent->children[parent->childCount - 1]);
+		}
 	}
 
 	// Must update model AFTER node is given it's new child data
@@ -350,22 +638,7 @@ ParseResult EntityParser::EditTree(const std::string_view text, EntNode* parent,
 				view->Select(i);                // because the latter deselects everything else
 		#endif
 	}
-
-	if (renumberLists)
-	{
-		for (wxDataViewItem& n : addedNodes) {
-			#if entityparser_wxwidgets
-			fixListNumberings((EntNode*)n.GetID(), true, false);
-			#else
-			fixListNumberings(n, true, false);
-			#endif
-		}
-			
-		if(parent != &root) // Don't waste time reordering the root children, there shouldn't be a list there
-			fixListNumberings(parent, false, false);
-	}
 	fileUpToDate = false;
-	return outcome;
 }
 
 void EntityParser::EditText(const std::string& text, EntNode* node, int nameLength, bool highlight)
@@ -375,9 +648,10 @@ void EntityParser::EditText(const std::string& text, EntNode* node, int nameLeng
 	reverseGroup.emplace_back();
 	ParseCommand& reverse = reverseGroup.back();
 	reverse.type = CommandType::EDIT_TEXT;
-	reverse.text = std::string(node->textPtr, node->nameLength + node->valLength);
+	reverse.text = std::string(node->getName()).append(node->getValue());
 	reverse.insertionIndex = node->nameLength;
-	reverse.parentPositionTrace = node->TracePosition(reverse.parentDepth);
+	node->TracePosition(reverse.parentPositionTrace);
+	reverse.memory = sizeof(ParseCommand) + reverse.text.capacity() + reverse.parentPositionTrace.capacity() * sizeof(int);
 	#endif
 
 	// Create new buffer
@@ -387,12 +661,16 @@ void EntityParser::EditText(const std::string& text, EntNode* node, int nameLeng
 		newBuffer[i++] = c;
 
 	// Free old data
-	allocs.text.freeBlock(node->textPtr, node->nameLength + node->valLength);
+	freeText(node);
+	DirtyEntity(node);
 
 	// Assign new data to node
 	node->textPtr = newBuffer;
 	node->nameLength = nameLength;
 	node->valLength = (int)text.length() - nameLength;
+	node->valGap = 0;
+	if(node->parent != nullptr)
+		node->parent->ResetChildIndex();
 
 	// Alert model
 	if (node->isFiltered()) // Todo: add safeguards so node can't be the root
@@ -421,7 +699,8 @@ void EntityParser::EditPosition(EntNode* parent, int childIndex, int insertionIn
 	reverse.type = CommandType::EDIT_POSITION;
 	reverse.insertionIndex = childIndex; // Removal count is interpreted as the child index, and 
 	reverse.removalCount = insertionIndex;
-	reverse.parentPositionTrace = parent->TracePosition(reverse.parentDepth);
+	parent->TracePosition(reverse.parentPositionTrace);
+	reverse.memory = sizeof(ParseCommand) + reverse.parentPositionTrace.capacity() * sizeof(int);
 	#endif
 
 	// Assemble data
@@ -437,6 +716,8 @@ void EntityParser::EditPosition(EntNode* parent, int childIndex, int insertionIn
 		for (int i = childIndex; i > insertionIndex; i--)
 			buffer[i] = buffer[i - 1];
 	buffer[insertionIndex] = child;
+	parent->ResetChildIndex();
+	DirtyEntity(parent);
 	
 	// Only alert model if node is filtered in 
 	// We assume Root will never be the node we're moving (todo: add safeguards to ensure this)
@@ -510,56 +791,139 @@ void EntityParser::PushGroupCommand() {
 	if (redoIndex < history.size())
 	{
 		size_t index = redoIndex, max = history.size();
-		while (index < max)
-			if (history[index++].lastInGroup)
+		while (index < max) {
+			ParseCommand& discarded = history[index++];
+			if (discarded.lastInGroup)
 				commandCount--;
+			historyMemory -= discarded.memory;
+			DiscardCommand(discarded);
+		}
 		history.resize(redoIndex);
 	}
 
-	if (commandCount == MAX_COMMAND_MEMORY)
-	{
-		// Assumes a max command history > 1
-		// Find start of the second-to-last undo command,
-		// and erase everything before it.
-		size_t index = 1;
-		while (!history[index].lastInGroup)
-			index++;
-		auto first = history.begin();
-		history.erase(first, first + index);
-		commandCount--;
-	}
-
 	reverseGroup[0].lastInGroup = true;
 	for (ParseCommand& p : reverseGroup) {
-		history.emplace_back(p);
+		historyMemory += p.memory;
+		history.emplace_back(std::move(p));
 	}
 		
 	redoIndex = (int)history.size();
 	reverseGroup.clear();
 	commandCount++;
+	TrimHistory();
+}
+
+void EntityParser::TrimHistory()
+{
+	// Compressing large tree edits keeps every group, at the cost of reparsing them
+	for (size_t i = 0; i < history.size() && historyMemory > maxHistoryMemory; i++) {
+		ParseCommand& cmd = history[i];
+		if(cmd.nodes.empty() || cmd.memory < minCompressedMemory)
+			continue;
+		historyMemory -= cmd.memory;
+		CompressCommand(cmd);
+		historyMemory += cmd.memory;
+	}
+
+	// Only undo groups are deleted, and the group we just pushed or undid must remain
+	while (historyMemory > maxHistoryMemory && commandCount > 1)
+	{
+		// Find the start of the second-oldest group
+		size_t index = 1;
+		while (index < history.size() && !history[index].lastInGroup)
+			index++;
+		if(index >= (size_t)redoIndex)
+			break;
+
+		for (size_t i = 0; i < index; i++) {
+			historyMemory -= history[i].memory;
+			DiscardCommand(history[i]);
+		}
+		auto first = history.begin();
+		history.erase(first, first + index);
+		redoIndex -= (int)index;
+		commandCount--;
+	}
 }
 
 void EntityParser::CancelGroupCommand()
 {
-	for (int i = (int)reverseGroup.size() - 1; i > -1; i--) // Should(?) underflow to -1
-		ExecuteCommand(reverseGroup[i]);
+	// Executing the reverse commands builds a new reverse group, which we discard
+	std::vector<ParseCommand> cancelled;
+	cancelled.swap(reverseGroup);
+	for (int i = (int)cancelled.size() - 1; i > -1; i--)
+		ExecuteCommand(cancelled[i]);
+
+	for (ParseCommand& p : reverseGroup)
+		DiscardCommand(p);
 	reverseGroup.clear();
 }
 
 void EntityParser::ClearHistory()
 {
+	for (ParseCommand& p : history)
+		DiscardCommand(p);
 	history.clear();
+	historyMemory = 0;
 	redoIndex = 0;
 	commandCount = 0;
 }
 
+void EntityParser::DiscardCommand(ParseCommand& cmd)
+{
+	for (EntNode* n : cmd.nodes)
+		freeNode(n);
+	cmd.nodes.clear();
+}
+
+void EntityParser::CompressCommand(ParseCommand& cmd)
+{
+	std::string raw;
+	for (EntNode* n : cmd.nodes) {
+		n->generateText(raw);
+		raw.push_back('\n');
+	}
+
+	Codec& codec = AtlanCodec::Active();
+	std::string compressed(codec.CompressBound(raw.length()), '\0');
+	size_t compressedSize;
+	if(!codec.Compress(raw.data(), raw.length(), compressed.data(), compressed.length(), compressedSize, 1)) // The text never leaves memory, so favor speed
+		return; // The command keeps it's detached nodes
+	compressed.resize(compressedSize);
+	compressed.shrink_to_fit();
+
+	DiscardCommand(cmd);
+	cmd.text = std::move(compressed);
+	cmd.textLength = raw.length();
+	cmd.memory = sizeof(ParseCommand) + cmd.text.capacity() + cmd.parentPositionTrace.capacity() * sizeof(int);
+}
+
+size_t EntityParser::DetachedMemory(const EntNode* node) const
+{
+	size_t sum = sizeof(EntNode) + node->maxChildren * sizeof(EntNode*);
+	if(node->textPtr < sourceStart || node->textPtr >= sourceEnd) // Borrowed source text is never freed
+		sum += node->nameLength + node->valLength;
+
+	for (int i = 0; i < node->childCount; i++)
+		sum += DetachedMemory(node->children[i]);
+	return sum;
+}
+
 void EntityParser::ExecuteCommand(ParseCommand& cmd)
 {
-	EntNode* node = EntNode::FromPositionTrace(&root, cmd.parentPositionTrace.get(), cmd.parentDepth);
+	EntNode* node = EntNode::FromPositionTrace(&root, cmd.parentPositionTrace.data(), (int)cmd.parentPositionTrace.size());
 	switch (cmd.type)
 	{
 		case CommandType::EDIT_TREE:
-		EditTree(cmd.text, node, cmd.insertionIndex, cmd.removalCount, false, true);
+		if (cmd.textLength > 0) {
+			std::string raw(cmd.textLength, '\0');
+			if (!AtlanCodec::Active().Decompress(cmd.text.data(), cmd.text.length(), raw.data(), raw.length()))
+				throw std::runtime_error("Could not decompress a history command");
+			EditTree(raw, node, cmd.insertionIndex, cmd.removalCount, false, true);
+			break;
+		}
+		SpliceNodes(node, cmd.insertionIndex, cmd.removalCount, cmd.nodes.data(), (int)cmd.nodes.size(), true);
+		cmd.nodes.clear(); // The tree owns these nodes now
 		break;
 
 		case CommandType::EDIT_TEXT:
@@ -584,15 +948,21 @@ bool EntityParser::Undo()
 	}
 
 	int index = redoIndex - 1;
-	do ExecuteCommand(history[index]);
+	do {
+		historyMemory -= history[index].memory;
+		ExecuteCommand(history[index]);
+	}
 	while (!history[index--].lastInGroup);
 
 	redoIndex = ++index;
 	reverseGroup[0].lastInGroup = true;
-	for (int i = (int)reverseGroup.size() - 1; i > -1; i--)
-		history[index++] = reverseGroup[i];
+	for (int i = (int)reverseGroup.size() - 1; i > -1; i--) {
+		historyMemory += reverseGroup[i].memory;
+		history[index++] = std::move(reverseGroup[i]);
+	}
 
 	reverseGroup.clear();
+	TrimHistory();
 	return true;
 }
 
@@ -607,14 +977,20 @@ bool EntityParser::Redo()
 	}
 
 	int index = redoIndex;
-	do ExecuteCommand(history[index]);
+	do {
+		historyMemory -= history[index].memory;
+		ExecuteCommand(history[index]);
+	}
 	while (!history[index++].lastInGroup);
 
 	reverseGroup[0].lastInGroup = true;
-	for (ParseCommand& p : reverseGroup)
-		history[redoIndex++] = p;
+	for (ParseCommand& p : reverseGroup) {
+		historyMemory += p.memory;
+		history[redoIndex++] = std::move(p);
+	}
 
 	reverseGroup.clear();
+	TrimHistory();
 	return true;
 }
 
@@ -624,6 +1000,196 @@ EntNode* EntityParser::getRoot() { return &root; }
 
 bool EntityParser::wasFileCompressed() { return fileWasCompressed; }
 
+void EntityParser::DirtyEntity(const EntNode* node)
+{
+	if(entityCache.empty() && !searchIndexBuilt)
+		return;
+
+	while (node->parent != &root) {
+		if(node->parent == nullptr)
+			return; // The root itself, or a node outside of the tree
+		node = node->parent;
+	}
+	entityCache.erase(node);
+	searchIndex.Remove(node);
+}
+
+void EntityParser::WriteToFile(const std::string& filepath, bool compress)
+{
+	const int childIndent = root.ChildIndent(0);
+	std::vector<const std::string*> childTexts(root.childCount);
+	std::vector<std::pair<const EntNode*, EntityCache*>> missing;
+
+	for (int i = 0; i < root.childCount; i++) {
+		EntityCache& cache = entityCache[root.children[i]];
+		if(!cache.hasText)
+			missing.emplace_back(root.children[i], &cache);
+		childTexts[i] = &cache.text;
+	}
+
+	// The entries already exist, so threads generating the missing text never modify the map
+	auto Generate = [childIndent](const EntNode* node, EntityCache* cache) {
+		cache->text.clear();
+		node->generateText(cache->text, childIndent);
+		cache->hasText = true;
+	};
+
+	size_t threadCount = std::thread::hardware_concurrency();
+	if (missing.size() < PARALLEL_MIN_ENTITIES || threadCount <= 1) {
+		for(auto& pair : missing)
+			Generate(pair.first, pair.second);
+	}
+	else {
+		std::atomic<size_t> nextNode = 0;
+		auto GenerateThread = [&]() {
+			for (size_t n = nextNode++; n < missing.size(); n = nextNode++)
+				Generate(missing[n].first, missing[n].second);
+		};
+
+		std::vector<std::thread> threads;
+		for(size_t i = 1; i < threadCount; i++)
+			threads.emplace_back(GenerateThread);
+		GenerateThread();
+		for(std::thread& t : threads)
+			t.join();
+	}
+
+	std::string raw;
+	raw.reserve(lastUncompressedSize + 10000);
+	root.generateText(raw, 0, childTexts.data());
+
+	lastUncompressedSize = EntNode::writeTextToFile(raw, filepath, compress, eofblob, eofbloblength);
+	fileUpToDate = true;
+}
+
+void EntityParser::BuildSearchIndex()
+{
+	searchIndex.Clear();
+	for(int i = 0; i < root.childCount; i++)
+		searchIndex.Add(root.children[i]);
+	searchIndexBuilt = true;
+}
+
+void EntityParser::ClearSearchIndex()
+{
+	searchIndex.Clear();
+	searchIndexBuilt = false;
+}
+
+EntNode* EntityParser::Search(const std::string& key, EntNode* startAfter, bool backwards, bool caseSensitive, bool exactLength)
+{
+	// Find the top-level node containing the start
+	EntNode* entity = startAfter;
+	while(entity->parent != nullptr && entity->parent != &root)
+		entity = entity->parent;
+
+	// Edits drop the nodes they change from the index, and freed nodes
+	// are always removed, so the root has unindexed children if the counts differ
+	std::vector<uint32_t> candidates;
+	bool useIndex = searchIndexBuilt && (entity == &root || entity->parent == &root);
+	if (useIndex) {
+		if (searchIndex.Size() != static_cast<size_t>(root.childCount)) {
+			for (int i = 0; i < root.childCount; i++) {
+				if(!searchIndex.Contains(root.children[i]))
+					searchIndex.Add(root.children[i]);
+			}
+		}
+		useIndex = searchIndex.Candidates(key, candidates);
+	}
+	auto IsCandidate = [this, &candidates](const EntNode* node) {
+		return searchIndex.IsCandidate(node, candidates);
+	};
+
+	if (!useIndex) {
+		if(backwards)
+			return startAfter->searchUpwards(key, caseSensitive, exactLength);
+		return startAfter->searchDownwards(key, caseSensitive, exactLength, nullptr);
+	}
+
+	int entityIndex = -1;
+	for (int i = 0; i < root.childCount && entityIndex < 0; i++) {
+		if(root.children[i] == entity)
+			entityIndex = i;
+	}
+
+	/*
+	* Mirrors the EntNode searches, except top-level nodes are skipped if
+	* they aren't candidates. The start's own top-level node is searched
+	* from the start outward, then the rest of the file is searched in
+	* order, before wrapping around to the start's top-level node
+	*/
+	EntNode* result;
+	if (!backwards) {
+		if (entity != &root && IsCandidate(entity)) {
+			const EntNode* after = nullptr;
+			for (EntNode* current = startAfter; current != &root; current = current->parent) {
+				int i = 0;
+				if (after != nullptr) {
+					while(i < current->childCount)
+						if(current->children[i++] == after) break;
+				}
+				for (; i < current->childCount; i++) {
+					result = current->children[i]->searchDownwardsLocal(key, caseSensitive, exactLength);
+					if(result != EntNode::SEARCH_404) return result;
+				}
+				after = current;
+			}
+		}
+
+		for (int i = entityIndex + 1; i < root.childCount; i++) {
+			if (IsCandidate(root.children[i])) {
+				result = root.children[i]->searchDownwardsLocal(key, caseSensitive, exactLength);
+				if(result != EntNode::SEARCH_404) return result;
+			}
+		}
+
+		// Wrap around
+		if(root.searchText(key, caseSensitive, exactLength)) return &root;
+		for (int i = 0; i <= entityIndex; i++) {
+			if (IsCandidate(root.children[i])) {
+				result = root.children[i]->searchDownwardsLocal(key, caseSensitive, exactLength);
+				if(result != EntNode::SEARCH_404) return result;
+			}
+		}
+		return EntNode::SEARCH_404;
+	}
+
+	if (entity != &root) {
+		if (IsCandidate(entity)) {
+			for (EntNode* current = startAfter; current != entity; current = current->parent) {
+				EntNode* parent = current->parent;
+				int i = parent->childCount - 1;
+				while (i > -1)
+					if(parent->children[i--] == current) break;
+
+				for (; i > -1; i--) {
+					result = parent->children[i]->searchUpwardsLocal(key, caseSensitive, exactLength);
+					if(result != EntNode::SEARCH_404) return result;
+				}
+				if(parent->searchText(key, caseSensitive, exactLength)) return parent;
+			}
+		}
+
+		for (int i = entityIndex - 1; i > -1; i--) {
+			if (IsCandidate(root.children[i])) {
+				result = root.children[i]->searchUpwardsLocal(key, caseSensitive, exactLength);
+				if(result != EntNode::SEARCH_404) return result;
+			}
+		}
+		if(root.searchText(key, caseSensitive, exactLength)) return &root;
+	}
+
+	// Wrap around
+	for (int i = root.childCount - 1; i > -1 && i >= entityIndex; i--) {
+		if (IsCandidate(root.children[i])) {
+			result = root.children[i]->searchUpwardsLocal(key, caseSensitive, exactLength);
+			if(result != EntNode::SEARCH_404) return result;
+		}
+	}
+	if(root.searchText(key, caseSensitive, exactLength)) return &root;
+	return EntNode::SEARCH_404;
+}
+
 void EntityParser::logAllocatorInfo(bool includeBlockList, bool logToLogger, bool logToFile, const std::string filepath)
 {
 	std::string msg = "EntNode Allocator\n=====\n";
@@ -658,6 +1224,62 @@ std::runtime_error EntityParser::Error(std::string msg)
 }
 
 
+/*
+* Builds nodes from the permissive grammar's events. Objects collect the nodes pushed
+* after them into their child buffers once they're left
+*/
+struct EntityParser::TreeEvents {
+	EntityParser& parser;
+	std::vector<size_t> levels; // Index in tempChildren of the first child of each open object
+
+	TreeEvents(EntityParser& p_parser) : parser(p_parser) {}
+
+	void Enter(uint16_t flags, std::string_view name, std::string_view value) {
+		parser.pushNode(flags, name, value);
+		levels.push_back(parser.tempChildren.size());
+	}
+
+	void Leave() {
+		parser.setNodeChildren(levels.back());
+		levels.pop_back();
+	}
+
+	void Value(uint16_t flags, std::string_view name, std::string_view value) {
+		parser.pushNode(flags, name, value);
+	}
+};
+
+/*
+* Builds nodes like TreeEvents, but hands each top-level node to a callback
+* once it's complete, then frees it
+*/
+struct EntityParser::BlockEvents : public TreeEvents {
+	const EntityBlockCallback& callback;
+
+	BlockEvents(EntityParser& p_parser, const EntityBlockCallback& p_callback) : TreeEvents(p_parser), callback(p_callback) {}
+
+	void Complete() {
+		EntNode* node = parser.tempChildren.back();
+		parser.tempChildren.pop_back();
+
+		node->parent = &parser.root;
+		callback(*node);
+		parser.freeNode(node);
+	}
+
+	void Leave() {
+		TreeEvents::Leave();
+		if(levels.empty())
+			Complete();
+	}
+
+	void Value(uint16_t flags, std::string_view name, std::string_view value) {
+		TreeEvents::Value(flags, name, value);
+		if(levels.empty())
+			Complete();
+	}
+};
+
 void EntityParser::initiateParse(std::string_view dataview, EntNode* tempRoot, EntNode* parent,
 	ParseResult& results)
 {
@@ -665,13 +1287,17 @@ void EntityParser::initiateParse(std::string_view dataview, EntNode* tempRoot, E
 	firstChar = dataview.data();
 	endchar = firstChar + dataview.length();
 	ch = firstChar;
-	errorLine = 1;
+	errorLine = firstLine;
 	tempChildren.push_back(tempRoot);
 
 	try 
 	{
-		if(PARSEMODE == ParsingMode::PERMISSIVE)
-			parseContentsPermissive();
+		if (PARSEMODE == ParsingMode::PERMISSIVE) {
+			TreeEvents events(*this);
+			size_t childrenStart = tempChildren.size();
+			parseContentsPermissive(events);
+			setNodeChildren(childrenStart);
+		}
 		else if (PARSEMODE == ParsingMode::JSON) {
 			if (parent->nodeFlags & EntNode::NF_Braces)
 				parseJsonObject();
@@ -726,6 +1352,127 @@ void EntityParser::initiateParse(std::string_view dataview, EntNode* tempRoot, E
 	tempChildren.shrink_to_fit();
 }
 
+ParseResult EntityParser::ParseEvents(std::string_view text, EntityEventHandler& handler)
+{
+	text = splitBlob(text);
+	firstChar = text.data();
+	endchar = firstChar + text.length();
+	ch = firstChar;
+	errorLine = firstLine;
+
+	ParseResult results;
+	try {
+		parseContentsPermissive(handler);
+		assertLastType(TT_End);
+	}
+	catch (std::runtime_error err) {
+		results.errorLineNum = errorLine;
+		results.errorMessage = err.what();
+		results.success = false;
+	}
+	return results;
+}
+
+ParseResult EntityParser::ParseBlocks(std::string_view text, const EntityBlockCallback& callback)
+{
+	text = splitBlob(text);
+	firstChar = text.data();
+	endchar = firstChar + text.length();
+	ch = firstChar;
+	errorLine = firstLine;
+	tempChildren.push_back(&root);
+
+	// Every node is freed before this returns, so they can always borrow their text
+	const char* savedStart = sourceStart, *savedEnd = sourceEnd;
+	sourceStart = firstChar;
+	sourceEnd = endchar;
+
+	ParseResult results;
+	try {
+		BlockEvents events(*this, callback);
+		parseContentsPermissive(events);
+		assertLastType(TT_End);
+	}
+	catch (std::runtime_error err) {
+		// Free the unfinished top-level node. Nodes of it's completed objects
+		// are childed to nodes in here, and freed with them
+		for(size_t i = 1; i < tempChildren.size(); i++)
+			freeNode(tempChildren[i]);
+
+		results.errorLineNum = errorLine;
+		results.errorMessage = err.what();
+		results.success = false;
+	}
+	tempChildren.clear();
+	sourceStart = savedStart;
+	sourceEnd = savedEnd;
+	return results;
+}
+
+// True if both nodes and all of their descendants have the same syntax and text
+static bool SameNode(const EntNode& a, const EntNode& b)
+{
+	if(a.getFlags() != b.getFlags() || a.getChildCount() != b.getChildCount()
+		|| a.getName() != b.getName() || a.getValue() != b.getValue())
+		return false;
+
+	for (int i = 0, max = a.getChildCount(); i < max; i++) {
+		if(!SameNode(a[i], b[i]))
+			return false;
+	}
+	return true;
+}
+
+ParseResult EntityParser::Reload(std::string_view text)
+{
+	ParseResult results;
+	EntityParser latest(PARSEMODE);
+	try {
+		latest.firstparse(text, false);
+	}
+	catch (std::runtime_error err) {
+		results.errorLineNum = latest.errorLine;
+		results.errorMessage = err.what();
+		results.success = false;
+		return results;
+	}
+	const EntNode& fresh = latest.root;
+
+	// Edits usually leave most of the file untouched, so match the unchanged ends first
+	const int oldCount = root.childCount, newCount = fresh.childCount;
+	int prefix = 0, suffix = 0;
+	while(prefix < oldCount && prefix < newCount && SameNode(*root.children[prefix], *fresh.children[prefix]))
+		prefix++;
+	while (suffix < oldCount - prefix && suffix < newCount - prefix
+		&& SameNode(*root.children[oldCount - 1 - suffix], *fresh.children[newCount - 1 - suffix]))
+		suffix++;
+
+	// The new nodes are reparsed from their text, since they belong to the other parser's allocators
+	auto Replace = [&](int index, int removeCount, int insertCount) {
+		std::string replacement;
+		for (int i = index; i < index + insertCount; i++) {
+			fresh.children[i]->generateText(replacement);
+			replacement.push_back('\n');
+		}
+		EditTree(replacement, &root, index, removeCount, false, false); // Generated text always reparses
+	};
+
+	// If the entity count didn't change, entities were edited in place, and the unchanged ones between them are kept
+	const int oldMiddle = oldCount - prefix - suffix, newMiddle = newCount - prefix - suffix;
+	if (oldMiddle == newMiddle) {
+		for (int i = prefix; i < prefix + oldMiddle; i++) {
+			if(!SameNode(*root.children[i], *fresh.children[i]))
+				Replace(i, 1, 1);
+		}
+	}
+	else Replace(prefix, oldMiddle, newMiddle);
+
+	std::swap(eofblob, latest.eofblob);
+	std::swap(eofbloblength, latest.eofbloblength);
+	lastUncompressedSize = text.length();
+	return results;
+}
+
 /* 
 Permissive parse function with significantly less error checking for proper token types and arrangements.
 It is intended to be as generous as possible, allowing grammars that wouldn't normally work with id's Parsers
@@ -734,9 +1481,10 @@ to be given a free pass if they're not completely wrong.
 This will eventually be used to parse the append menu file, and may see further use if/when EntitySlayer's is
 expanded to work with .decl files
 */
-void EntityParser::parseContentsPermissive()
+template<typename Events>
+void EntityParser::parseContentsPermissive(Events& events)
 {
-	size_t childrenStart = tempChildren.size();
+	std::string_view value; // Holds a value while the following token is checked
 	
 	LABEL_LOOP:
 	Tokenize();
@@ -745,11 +1493,10 @@ void EntityParser::parseContentsPermissive()
 	switch (lastTokenType)
 	{
 		default: // End, BraceClose, Assignment, Value_Number
-		setNodeChildren(childrenStart);
 		return;
 
 		case TT_Comment:
-		pushNode(EntNode::NFC_Comment, lastUniqueToken);
+		events.Value(EntNode::NFC_Comment, lastUniqueToken, "");
 		goto LABEL_LOOP;
 
 		case TT_Newline:
@@ -757,9 +1504,10 @@ void EntityParser::parseContentsPermissive()
 		goto LABEL_LOOP;
 
 		case TT_BraceOpen: // Most decl files begin with a nameless brace pair
-		pushNode(EntNode::NFC_ObjSimple, "");
-		parseContentsPermissive();
+		events.Enter(EntNode::NFC_ObjSimple, "", "");
+		parseContentsPermissive(events);
 		assertLastType(TT_BraceClose);
+		events.Leave();
 		goto LABEL_LOOP;
 
 		/*
@@ -777,9 +1525,10 @@ void EntityParser::parseContentsPermissive()
 		Tokenize();
 
 		if (lastTokenType == TT_BraceOpen) {  // Simple objects
-			pushNode(EntNode::NFC_ObjSimple, activeID);
-			parseContentsPermissive();
+			events.Enter(EntNode::NFC_ObjSimple, activeID, "");
+			parseContentsPermissive(events);
 			assertLastType(TT_BraceClose);
+			events.Leave();
 			goto LABEL_LOOP;
 		}
 
@@ -791,14 +1540,15 @@ void EntityParser::parseContentsPermissive()
 			while(lastTokenType == TT_Newline);
 
 			if (lastTokenType == TT_BraceOpen) {
-				pushNode(EntNode::NFC_ObjSimple, activeID);
-				parseContentsPermissive();
+				events.Enter(EntNode::NFC_ObjSimple, activeID, "");
+				parseContentsPermissive(events);
 				assertLastType(TT_BraceClose);
+				events.Leave();
 				goto LABEL_LOOP;
 			}
 
 			else {
-				pushNode(EntNode::NFC_ValueLayer, activeID);
+				events.Value(EntNode::NFC_ValueLayer, activeID, "");
 				goto LABEL_LOOP_SKIP_TOKENIZE;
 			}
 		}
@@ -807,9 +1557,10 @@ void EntityParser::parseContentsPermissive()
 			Tokenize();
 
 			if (lastTokenType == TT_BraceOpen) { // Common Objects
-				pushNode(EntNode::NFC_ObjCommon, activeID);
-				parseContentsPermissive();
+				events.Enter(EntNode::NFC_ObjCommon, activeID, "");
+				parseContentsPermissive(events);
 				assertLastType(TT_BraceClose);
+				events.Leave();
 				goto LABEL_LOOP;
 			}
 			
@@ -822,27 +1573,29 @@ void EntityParser::parseContentsPermissive()
 				if(lastTokenType != TT_BraceOpen)
 					throw Error("Expected brace after = and newline");
 
-				pushNode(EntNode::NFC_ObjCommon, activeID);
-				parseContentsPermissive();
+				events.Enter(EntNode::NFC_ObjCommon, activeID, "");
+				parseContentsPermissive(events);
 				assertLastType(TT_BraceClose);
+				events.Leave();
 				goto LABEL_LOOP;
 			}
 
 			else if (lastTokenType & TTC_PermissiveKey) { // Value assignments
-				pushNodeBoth(EntNode::NFC_ValueDarkmetal);
+				value = lastUniqueToken;
 				Tokenize();
 				if (lastTokenType == TT_Semicolon) {
-					tempChildren.back()->nodeFlags = EntNode::NFC_ValueCommon;
+					events.Value(EntNode::NFC_ValueCommon, activeID, value);
 					goto LABEL_LOOP;
 				}
-				else goto LABEL_LOOP_SKIP_TOKENIZE;
+				events.Value(EntNode::NFC_ValueDarkmetal, activeID, value);
+				goto LABEL_LOOP_SKIP_TOKENIZE;
 			}
 
 			else throw Error("Unexpected token after = sign");
 		}
 
 		else if (lastTokenType & TTC_PermissiveKey) { // Consecutive Identifiers or higher
-			pushNodeBoth(EntNode::NFC_ValueFile);
+			value = lastUniqueToken;
 			Tokenize();
 
 			while (lastTokenType == TT_Newline) {
@@ -850,15 +1603,17 @@ void EntityParser::parseContentsPermissive()
 			}
 
 			if (lastTokenType == TT_BraceOpen) {
-				tempChildren.back()->nodeFlags = EntNode::NFC_ObjSimple; // Changed from ObjEntityDef to fix indentation
-				parseContentsPermissive();
+				events.Enter(EntNode::NFC_ObjSimple, activeID, value); // ObjSimple instead of ObjEntityDef to fix indentation
+				parseContentsPermissive(events);
 				assertLastType(TT_BraceClose);
+				events.Leave();
 				goto LABEL_LOOP;
 			}
-			else goto LABEL_LOOP_SKIP_TOKENIZE;
+			events.Value(EntNode::NFC_ValueFile, activeID, value);
+			goto LABEL_LOOP_SKIP_TOKENIZE;
 		}
 		else if (lastTokenType != TT_Semicolon) { // EOF, Braceclose, comment
-			pushNode(EntNode::NFC_ValueLayer, activeID);
+			events.Value(EntNode::NFC_ValueLayer, activeID, "");
 			goto LABEL_LOOP_SKIP_TOKENIZE;
 		}
 		else throw Error("Unexpected token after identifier or string literal");
@@ -1123,10 +1878,21 @@ void EntityParser::parseJsonArray()
 	setNodeChildren(childrenStart);
 }
 
+void EntityParser::ForgetEntity(const EntNode* node)
+{
+	// The node's address may be reused by a new node
+	if (node->parent == &root) {
+		entityCache.erase(node);
+		searchIndex.Remove(node);
+	}
+}
+
 void EntityParser::freeNode(EntNode* node)
 {
+	ForgetEntity(node);
+
 	// Free the allocated text block
-	allocs.text.freeBlock(node->textPtr, node->nameLength + node->valLength);
+	freeText(node);
 
 	// Free the node's children and the pointer block listing them
 	if (node->childCount > 0)
@@ -1141,34 +1907,66 @@ void EntityParser::freeNode(EntNode* node)
 	* Otherwise we must operate under the assumption that some data is inaccurate
 	* when working with EntityNode instance methods.
 	*/
+	node->~EntNode();
 	new (node) EntNode;
 	allocs.nodes.freeBlock(node, 1);
 }
 
+void EntityParser::freeText(EntNode* node)
+{
+	if(node->textPtr >= sourceStart && node->textPtr < sourceEnd)
+		return;
+	allocs.text.freeBlock(node->textPtr, node->nameLength + node->valLength);
+}
+
 void EntityParser::pushNode(const uint16_t p_flags, const std::string_view p_name)
+{
+	pushNode(p_flags, p_name, std::string_view());
+}
+
+void EntityParser::pushNode(const uint16_t p_flags, const std::string_view p_name, const std::string_view p_value)
 {
 	EntNode* n = allocs.nodes.reserveBlock(1);
-	n->textPtr = allocs.text.reserveBlock(p_name.length());
 	n->nameLength = p_name.length();
+	n->valLength = p_value.length();
 	n->nodeFlags = p_flags;
 
+	// Zero-copy nodes borrow their text if it's all in the source,
+	// with few enough characters between the name and value
+	if (sourceStart != nullptr && p_name.length() + p_value.length() > 0) {
+		auto InSource = [this](std::string_view s) {
+			return s.empty() || (s.data() >= sourceStart && s.data() + s.length() <= sourceEnd);
+		};
+
+		bool borrow = InSource(p_name) && InSource(p_value);
+		size_t gap = 0;
+		if (borrow && !p_name.empty() && !p_value.empty()) {
+			const char* nameEnd = p_name.data() + p_name.length();
+			borrow = p_value.data() >= nameEnd && static_cast<size_t>(p_value.data() - nameEnd) <= UINT8_MAX;
+			if(borrow)
+				gap = p_value.data() - nameEnd;
+		}
+
+		if (borrow) {
+			// Borrowed text is never written to. Edits give the node a new buffer
+			n->textPtr = const_cast<char*>(p_name.empty() ? p_value.data() : p_name.data());
+			n->valGap = static_cast<uint8_t>(gap);
+			tempChildren.push_back(n);
+			return;
+		}
+	}
+
+	n->textPtr = allocs.text.reserveBlock(p_name.length() + p_value.length());
+
 	memcpy(n->textPtr, p_name.data(), p_name.length());
+	memcpy(n->textPtr + p_name.length(), p_value.data(), p_value.length());
 
 	tempChildren.push_back(n);
 }
 
 void EntityParser::pushNodeBoth(const uint16_t p_flags)
 {
-	EntNode* n = allocs.nodes.reserveBlock(1);
-	n->textPtr = allocs.text.reserveBlock(activeID.length() + lastUniqueToken.length());
-	n->nameLength = activeID.length();
-	n->valLength = lastUniqueToken.length();
-	n->nodeFlags = p_flags;
-
-	memcpy(n->textPtr, activeID.data(), activeID.length());
-	memcpy(n->textPtr + activeID.length(), lastUniqueToken.data(), lastUniqueToken.length());
-
-	tempChildren.push_back(n);
+	pushNode(p_flags, activeID, lastUniqueToken);
 }
 
 void EntityParser::setNodeChildren(const size_t startIndex)
@@ -1270,7 +2068,7 @@ void EntityParser::Tokenize()
 			return;
 		}
 		case ' ': case '\t':
-		ch++;
+		ch = ParserSimd::SkipBlanks(ch + 1, endchar, PARSEMODE != ParsingMode::PERMISSIVE);
 		goto LABEL_TOKENIZE_START;
 
 		case ';':
@@ -1350,17 +2148,17 @@ void EntityParser::Tokenize()
 			throw Error("Bad start to comment");
 
 		if (*ch == '/') {
-			while (++ch < endchar) {
-				if(*ch == '\n' || *ch == '\r')
-					break;
-			}
+			ch = ParserSimd::FindLineEnd(ch + 1, endchar);
 			lastTokenType = TT_Comment;
 			lastUniqueToken = std::string_view(first, static_cast<size_t>(ch - first));
 			return;
 		}
 		else if (*ch == '*') { 
-			while (++ch < endchar) { // This way ensures multiple asteriks preceding the slash don't throw an error
-				if (*ch == '*' && ch < endchar - 1 && *(ch + 1) == '/') {
+			while (true) { // This way ensures multiple asteriks preceding the slash don't throw an error
+				ch = ParserSimd::FindChar(ch + 1, endchar, '*');
+				if(ch >= endchar - 1)
+					break;
+				if (*(ch + 1) == '/') {
 					ch += 2; // Increment past the comment
 					lastTokenType = TT_Comment;
 					lastUniqueToken = std::string_view(first, static_cast<size_t>(ch - first));
@@ -1374,18 +2172,22 @@ void EntityParser::Tokenize()
 
 		case '"':
 		first = ch;
-		while (++ch < endchar) {
+		while (true) {
+			// Backslashes only stop the scan in JSON mode
+			ch = ParserSimd::FindStringStop(ch + 1, endchar, PARSEMODE == ParsingMode::JSON);
+			if(ch == endchar)
+				break;
+
 			if (*ch == '"') {
 				lastTokenType = TT_String;
 				lastUniqueToken = std::string_view(first, (size_t)(++ch - first)); // Increment past quote to set to next char
 				return;
 			}
-			else if (*ch == '\\' && PARSEMODE == ParsingMode::JSON) {
+			else if (*ch == '\\') {
 				if(ch < endchar && *(ch+1) == '"')
 					ch++;
 			}
-			else if(*ch == '\n' || *ch == '\r')
-				break;
+			else break; // Line break
 		}
 		throw Error("No end-quote to complete string literal");
 
@@ -1475,17 +2277,8 @@ void EntityParser::Tokenize()
 			}
 				
 			first = ch;
+			ch = ParserSimd::SkipIdentifier(ch + 1, endchar, PARSEMODE == ParsingMode::PERMISSIVE);
 
-			while (++ch < endchar)
-			{
-				if(isLetter | isNum || *ch == '_')
-					continue;
-
-				if(*ch == '%' && PARSEMODE == ParsingMode::PERMISSIVE)
-					continue;
-
-				break;
-			}
 			if (*ch == '(') { // declType(keyword)
 				Tokenize();
 			}
@@ -1530,9 +2323,7 @@ void EntityParser::FilteredSearch(const std::string& key, bool backwards, bool c
 		* TODO: Ideally, we shouldn't be searching through filtered out nodes in the first place. If a massive
 		* amount of nodes are filtered out on large files, search can take significant time to complete
 		*/
-		if (backwards)
-			result = startAfter->searchUpwards(key, caseSensitive, exactLength);
-		else result = startAfter->searchDownwards(key, caseSensitive, exactLength, nullptr);
+		result = Search(key, startAfter, backwards, caseSensitive, exactLength);
 
 		if (result == EntNode::SEARCH_404 || result == firstResult) {
 			EntityLogger::log("Could not find key");
@@ -14,9 +14,12 @@
 #include <string_view>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <functional>
 #include "ParserConfig.h"
 #include "EntityNode.h"
 #include "GenericBlockAllocator.h"
+#include "SearchIndex.h"
 
 #if entityparser_wxwidgets
 #include "wx/wx.h"
@@ -44,6 +47,25 @@ enum class ParsingMode {
 	JSON
 };
 
+/*
+* Receives the contents of a text as it's parsed, in document order, without a node tree
+* being built. Flags are EntNode flag combos, describing the syntax of each node.
+* Names and values are views into the parsed text
+*/
+class EntityEventHandler {
+	public:
+	virtual ~EntityEventHandler() = default;
+
+	// A node that opens a brace block. The block's contents are reported next, followed by Leave
+	virtual void Enter(uint16_t flags, std::string_view name, std::string_view value) = 0;
+	virtual void Leave() = 0;
+
+	// A node without a block: a key-value pair, a lone key or value, or a comment
+	virtual void Value(uint16_t flags, std::string_view name, std::string_view value) = 0;
+};
+
+typedef std::function<void(const EntNode& node)> EntityBlockCallback;
+
 class EntityParser
 #if entityparser_wxwidgets
 : public wxDataViewModel 
@@ -77,6 +99,65 @@ class EntityParser
 	bool fileUpToDate = true;
 	size_t lastUncompressedSize = 0;
 
+	/*
+	* Output last generated for each top-level node, so saving or reserializing
+	* after an edit only regenerates the entities that were edited
+	*/
+	public:
+	struct EntityCache {
+		std::string text;         // Text generated at the root's child indentation, without the trailing newline
+		std::string binary;       // Set by the reserializer
+		uint32_t binaryInfo = 0;  // Additional reserializer output, such as a mapentity's layer index
+		int binaryWarnings = 0;   // Warnings the reserializer raised while producing binary
+		bool hasText = false;
+		bool hasBinary = false;
+	};
+
+	/*
+	* Returns the cache entry of one of the root's children, creating an empty entry if it has none.
+	* Any edit inside the child discards it's entry, so an entry is always current
+	*/
+	EntityCache& GetEntityCache(const EntNode& entity) { return entityCache[&entity]; }
+
+	void ClearEntityCache() { entityCache.clear(); }
+
+	private:
+	std::unordered_map<const EntNode*, EntityCache> entityCache;
+
+	// Discards the cache entry of the top-level node containing this node
+	void DirtyEntity(const EntNode* node);
+
+	// Saves generate the text of uncached nodes concurrently once there are this many
+	static const size_t PARALLEL_MIN_ENTITIES = 256;
+
+	/*
+	* ==================
+	* SEARCHING
+	* ==================
+	*/
+	public:
+	/*
+	* Indexes the text of every top-level node, so Search can skip the ones that can't
+	* contain a key. The index costs several bytes per character of text. Edited
+	* nodes are dropped from it, and re-indexed by the next search
+	*/
+	void BuildSearchIndex();
+
+	void ClearSearchIndex();
+
+	/*
+	* Finds the next node containing the key, in the same order and with the same results as
+	* EntNode::searchDownwards and searchUpwards, wrapping around the file. Only verifies the
+	* top-level nodes that the search index can't rule out, if it's been built
+	* @param startAfter Node the search begins after. Must be in this parser's tree
+	* @return The node found, or EntNode::SEARCH_404
+	*/
+	EntNode* Search(const std::string& key, EntNode* startAfter, bool backwards, bool caseSensitive, bool exactLength);
+
+	private:
+	SearchIndex searchIndex;
+	bool searchIndexBuilt = false;
+
 	// Binary blob that may be present at end of file
 	public:
 	char* eofblob = nullptr;
@@ -96,10 +177,11 @@ class EntityParser
 		fileUpToDate = false;
 	}
 
-	void WriteToFile(const std::string& filepath, bool compress) {
-		lastUncompressedSize = root.writeToFile(filepath, lastUncompressedSize + 10000, compress, eofblob, eofbloblength, false);
-		fileUpToDate = true;
-	}
+	/*
+	* Saves the tree, reusing the cached text of every top-level node that
+	* hasn't been edited since the last save
+	*/
+	void WriteToFile(const std::string& filepath, bool compress);
 
 	/*
 	* ==================
@@ -119,6 +201,16 @@ class EntityParser
 	std::string_view lastUniqueToken;			// Stores most recent identifier or value token
 	std::string_view activeID;					// Second-most-recent token (typically an identifier)
 	size_t errorLine = 1;                       // If a grammar error is detected, this is the line it was found on
+	size_t firstLine = 1;                       // Line number of firstChar. Set when parsing a chunk of a larger file
+
+	/*
+	* Zero-copy text. Nodes parsed from [sourceStart, sourceEnd) point into it instead of
+	* copying their text into allocs.text. Nodes made or edited later are always copied.
+	* Empty unless the parser is zero-copy, or during ParseBlocks
+	*/
+	std::unique_ptr<char[]> sourceText; // Set if the parser read the source text itself
+	const char* sourceStart = nullptr;
+	const char* sourceEnd = nullptr;
 
 	// Every node generated during the current parse (except the root node)
 	// is inside here, or childed to a node inside here, until the moment it's
@@ -137,17 +229,54 @@ class EntityParser
 
 	/*
 	* Constructs an EntityParser containing fully parsed data from the given data view
+	* @param zeroCopy If true, nodes point into data instead of copying it, so data must outlive the parser
 	*/
-	EntityParser(const ParsingMode mode, const std::string_view data, const bool debug_logParseTime);
+	EntityParser(const ParsingMode mode, const std::string_view data, const bool debug_logParseTime, const bool zeroCopy = false);
 
 	/*
 	* Constructs an EntityParser containing fully parsed data from the given file
 	* @param filepath .entites file to parse
 	* @param mode Parsing mode that will be followed
 	* @param debug_logParseTime If true, outputs execution time data
+	* @param zeroCopy If true, the parser keeps the file's text and nodes point into it,
+	* instead of every name and value being copied into the text allocator
 	* @throw runtime_error thrown when the file cannot be parsed
 	*/
-	EntityParser(const std::string& filepath, const ParsingMode mode, const bool debug_logParseTime = false);
+	EntityParser(const std::string& filepath, const ParsingMode mode, const bool debug_logParseTime = false, const bool zeroCopy = false);
+
+	/*
+	* Reads an .entities file, decompressing it if it's compressed
+	* @param length Receives the length of the text
+	* @param compressed Receives whether the file was compressed
+	* @throw runtime_error thrown when the file cannot be read or decompressed
+	*/
+	static std::unique_ptr<char[]> ReadText(const std::string& filepath, size_t& length, bool& compressed);
+
+	/*
+	* STREAMING
+	* These parse text without keeping a tree of the whole file, and should be called
+	* on a parser constructed with only a mode. Only PERMISSIVE mode is supported.
+	* Like firstparse, text after a null byte is treated as the end of file blob
+	*/
+
+	/* Reports every node of the text to the handler. No nodes are allocated */
+	ParseResult ParseEvents(std::string_view text, EntityEventHandler& handler);
+
+	/*
+	* Parses the text one top-level node at a time. Each node is passed to the callback
+	* with it's descendants once it's complete, then freed before the next is parsed,
+	* so memory use is bounded by the largest top-level node instead of the file
+	*/
+	ParseResult ParseBlocks(std::string_view text, const EntityBlockCallback& callback);
+
+	/*
+	* Replaces the tree with a parse of new text, such as the file after it was edited elsewhere.
+	* Top-level nodes identical to the new text's keep their nodes and cache entries, so only
+	* the entities that changed are regenerated or reserialized afterwards. The changed entities
+	* are replaced with EditTree, and form the current command group in history builds.
+	* The tree is unchanged if the text can't be parsed
+	*/
+	ParseResult Reload(std::string_view text);
 
 	private:
 	/*
@@ -162,6 +291,22 @@ class EntityParser
 
 	void firstparse(std::string_view dataview, const bool debug_log);
 
+	/* Moves anything after a null byte into eofblob, returning the text before it */
+	std::string_view splitBlob(std::string_view dataview);
+
+	/* Sizes the allocator buffers for the text, plus slack nodes for future edits */
+	void initAllocators(std::string_view dataview, const size_t slack);
+
+	/*
+	* Files at least this long are split into chunks of top-level blocks,
+	* which are parsed concurrently and then stitched under the root.
+	* Only used in ENTITIES mode
+	*/
+	static const size_t PARALLEL_MIN_LENGTH = 4 * 1024 * 1024;
+	static const size_t PARALLEL_MIN_CHUNK = 256 * 1024;
+
+	void parseParallel(std::string_view dataview, const bool debug_log);
+
 	// TODO: Get rid of intiateParse somehow - it's sloppy (or not - we may need it when we have multiple parsing modes)
 	// Consider renaming these other functions?
 
@@ -174,7 +319,15 @@ class EntityParser
 	void parseContentsEntity();
 	void parseContentsLayer();
 	void parseContentsDefinition();
-	void parseContentsPermissive();
+
+	/*
+	* The permissive grammar reports nodes to a set of events instead of allocating them,
+	* so the tree builders and EntityEventHandlers share one implementation
+	*/
+	template<typename Events> void parseContentsPermissive(Events& events);
+	struct TreeEvents;
+	struct BlockEvents;
+
 	void parseJsonRoot();
 	void parseJsonObject();
 	void parseJsonArray();
@@ -184,7 +337,14 @@ class EntityParser
 	*/
 	void freeNode(EntNode* node);
 
+	// Removes a top-level node from the entity cache and search index, before it leaves the tree
+	void ForgetEntity(const EntNode* node);
+
+	// Frees a node's text, unless it points into the zero-copy source text
+	void freeText(EntNode* node);
+
 	void pushNode(const uint16_t p_flags, const std::string_view p_name);
+	void pushNode(const uint16_t p_flags, const std::string_view p_name, const std::string_view p_value);
 	void pushNodeBoth(const uint16_t p_flags);
 	 
 	void setNodeChildren(const size_t startIndex);
@@ -230,11 +390,25 @@ class EntityParser
 		EDIT_POSITION
 	};
 
+	/*
+	* Tree edits don't store text: the nodes they remove are detached from the tree
+	* and kept by the command that reinserts them, so undoing or redoing an edit
+	* only relinks the nodes it changed instead of regenerating and reparsing them.
+	* Commands own their detached nodes, and free them when they're discarded.
+	* Once the history outgrows it's budget, large commands trade their nodes for compressed text
+	*/
 	struct ParseCommand
 	{
-		std::string text = "";                      // Text we must parse for this command
-		std::shared_ptr<int> parentPositionTrace = nullptr; // Positional trace of parent node. Requires a shared ptr since vectors don't zero-out old buffers
-		int parentDepth = 0;                        // Depth of the parent node
+		ParseCommand() = default;
+		ParseCommand(ParseCommand&&) = default;
+		ParseCommand& operator=(ParseCommand&&) = default;
+		ParseCommand(const ParseCommand&) = delete; // Detached nodes must have exactly one owner
+
+		std::string text = "";                      // New text of an EDIT_TEXT command's node, or a compressed EDIT_TREE command's nodes
+		std::vector<int> parentPositionTrace;       // Positional trace of parent node
+		std::vector<EntNode*> nodes;                // Detached nodes an EDIT_TREE command inserts
+		size_t textLength = 0;                      // If non-zero, an EDIT_TREE command's nodes were replaced by compressed text of this length
+		size_t memory = 0;                          // Bytes retained by this command, including it's detached nodes
 		int insertionIndex = 0;                     // Purpose varies depending on command type
 		int removalCount = 0;                       // Purpose varies depending on command type
 		bool lastInGroup = false;                   // If true, this is the last command of this group command
@@ -251,7 +425,9 @@ class EntityParser
 	*/
 	private:
 	std::vector<ParseCommand> history;      // Command history, serves as the undo/redo stack
-	const size_t MAX_COMMAND_MEMORY = 100;  // Maximum number of command groups that will be stored in the history before old ones are deleted
+	size_t maxHistoryMemory = 100 * 1024 * 1024; // Bytes the history may retain before the oldest command groups are deleted
+	size_t minCompressedMemory = 1024 * 1024;    // Commands retaining fewer bytes are never compressed
+	size_t historyMemory = 0;               // Bytes currently retained by the commands in the history
 	int commandCount = 0;                   // Current number of command groups being stored in the undo/redo stack                   
 	int redoIndex = 0;                      // Current position on the undo/redo stack.
 	std::vector<ParseCommand> reverseGroup; // Reverse of the current command group incase we must cancel
@@ -261,9 +437,24 @@ class EntityParser
 	*/
 
 	private:
-	/* Executes the given command object */
+	/* Executes the given command object, moving it's detached nodes into the tree */
 	void ExecuteCommand(ParseCommand& cmd);
 
+	/* Frees the detached nodes of a command that will never be executed */
+	void DiscardCommand(ParseCommand& cmd);
+
+	/* Replaces a tree command's detached nodes with their compressed text, which undo/redo must reparse */
+	void CompressCommand(ParseCommand& cmd);
+
+	/* Bytes retained by a detached node and all of it's descendants */
+	size_t DetachedMemory(const EntNode* node) const;
+
+	/*
+	* Compresses the oldest large commands, then deletes the oldest undo groups
+	* until the history fits in it's memory budget. The newest undo group is always kept
+	*/
+	void TrimHistory();
+
 	public:
 	/* Pushes the current command group into the history and starts a new command group */
 	void PushGroupCommand();
@@ -274,6 +465,16 @@ class EntityParser
 	/* Clears the command history */
 	void ClearHistory();
 
+	/* Bytes currently retained by the command history */
+	size_t HistoryMemory() const { return historyMemory; }
+
+	/* Changes the history's memory budget, and the smallest command that may be compressed to meet it */
+	void SetHistoryBudget(size_t maxMemory, size_t minCompressed) {
+		maxHistoryMemory = maxMemory;
+		minCompressedMemory = minCompressed;
+		TrimHistory();
+	}
+
 	bool Undo();
 	bool Redo();
 	#endif
@@ -294,6 +495,14 @@ class EntityParser
 	*/
 	void EditText(const std::string& text, EntNode* node, int nameLength, bool highlight);
 
+	private:
+	/*
+	* Replaces a block of a parent's children with a list of unparented nodes,
+	* detaching the removed nodes for the history or freeing them
+	* @param nodes Nodes to insert, which become owned by the tree
+	*/
+	void SpliceNodes(EntNode* parent, int insertionIndex, int removeCount, EntNode* const* nodes, int nodeCount, bool highlightNew);
+
 	public:
 	/*
 	* Parses a given string of text and replaces a pre-existing block of EntNodes
@@ -6,63 +6,79 @@ void BlockAllocatorUnitTest()
 {
 	{
 		BlockAllocator<int> alloc(100);
-		const std::vector<BlockAllocator<int>::FreeBlock>& blocks = alloc.GetBlocks();
+		std::vector<BlockAllocator<int>::FreeBlock> blocks;
 
 		int* nums = alloc.reserveBlock(20);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 0);
 
 		// Test Simple Free Block System
 		alloc.freeBlock(nums + 10, 5);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 1);
 		assert(blocks[0].length() == 5);
 		assert(blocks[0].start == nums + 10);
 
 		alloc.freeBlock(nums + 5, 2);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 2);
 		assert(blocks[0].length() == 2);
 
 		alloc.freeBlock(nums + 8, 1);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 3);
 		assert(blocks[1].length() == 1);
 
 		alloc.freeBlock(nums + 9, 1);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 2);
 		assert(blocks[1].length() == 7);
 
 		alloc.freeBlock(nums + 15, 2);
+		blocks = alloc.GetBlocks();
 		assert(blocks[1].length() == 9);
 
 		alloc.freeBlock(nums, 5);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 2);
 		assert(blocks[0].length() == 7);
 
 		// Reserve more than what remains in the buffer
 		int* moreNums = alloc.reserveBlock(81);
+		blocks = alloc.GetBlocks();
 		assert(blocks.size() == 3);
 		assert(blocks[2].length() == 80);
 
 		// Reserve rest of buffer to start reserving from free blocks
 		int* consumeBuffer = alloc.reserveBlock(19);
+		assert(consumeBuffer == moreNums + 81);
+
+		// Blocks are reserved from the end of the smallest size class that fits
 		int* a = alloc.reserveBlock(1);
+		blocks = alloc.GetBlocks();
+		assert(a == nums + 6);
 		assert(blocks[0].length() == 6);
 
-		// Reserve more than the first free block can give, forcing allocation from block 2
+		// Too large for the first free block, so the second one is used
 		int* b = alloc.reserveBlock(8);
+		blocks = alloc.GetBlocks();
+		assert(b == nums + 9);
 		assert(blocks[1].length() == 1);
 
 		// Reserve the entirety of block 1
 		int* c = alloc.reserveBlock(6);
+		blocks = alloc.GetBlocks();
+		assert(c == nums);
 		assert(blocks.size() == 2);
 		assert(blocks[0].length() == 1);
 	}
 	{
 		BlockAllocator<int> alloc(100);
-		const std::vector<BlockAllocator<int>::FreeBlock>& blocks = alloc.GetBlocks();
 
 		int* nums = alloc.reserveBlock(100);
-		assert(blocks.size() == 0);
+		assert(alloc.GetBlocks().size() == 0);
 
-		// Ensure binary insertion is working properly
+		// Ensure address ordering and coalescing are working properly
 		alloc.freeBlock(nums + 50, 1);
 		alloc.freeBlock(nums + 25, 1);
 		alloc.freeBlock(nums + 75, 1);
@@ -74,6 +90,7 @@ void BlockAllocatorUnitTest()
 		alloc.freeBlock(nums + 67, 1);
 		alloc.freeBlock(nums + 23, 1);
 
+		std::vector<BlockAllocator<int>::FreeBlock> blocks = alloc.GetBlocks();
 		assert(blocks.size() == 10);
 
 		int* last = nullptr;
@@ -82,6 +99,29 @@ void BlockAllocatorUnitTest()
 			assert(f.start < f.end);
 			last = f.end;
 		}
+
+		alloc.freeBlock(nums + 66, 1);
+		alloc.freeBlock(nums + 24, 1);
+		blocks = alloc.GetBlocks();
+		assert(blocks.size() == 8);
+		assert(blocks[1].start == nums + 23 && blocks[1].length() == 3);
+	}
+	{
+		BlockAllocator<int> alloc(1000);
+
+		// Many small free blocks must not stop a large one from being found
+		int* nums = alloc.reserveBlock(1000);
+		for (int i = 0; i < 400; i += 2)
+			alloc.freeBlock(nums + i, 1);
+		alloc.freeBlock(nums + 500, 300);
+
+		int* large = alloc.reserveBlock(200);
+		assert(large == nums + 600);
+		assert(alloc.GetBlocks().size() == 201);
+
+		// No free block is large enough, so a new buffer is made
+		int* larger = alloc.reserveBlock(500);
+		assert(larger < nums || larger >= nums + 1000);
 	}
 }
 
@@ -1,7 +1,14 @@
 #pragma once
 #include <vector>
+#include <map>
 #include <string>
 #include <sstream>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #ifdef _DEBUG
 
@@ -15,8 +22,11 @@ void BlockAllocatorUnitTest();
 * 1. Does not check if the memory you free was actually provided by the allocator
 * 2. Expects users to independently maintain the start and lengths of allocated blocks
 * 
-* Todo: Consider implementing a system that completely discards freeblocks of a small-enough size,
-* to eliminate inefficiency from building up a large number of tiny free blocks?
+* Freed blocks are coalesced with their neighbors, then filed into segregated size classes:
+* a power of two range split into SL_COUNT linear steps. Two levels of bitmaps track
+* which classes are non-empty, so finding a large enough free block takes constant time
+* no matter how many small free blocks have built up. Blocks are reserved from the end
+* of a free block, so the remainder keeps it's address and place in the address map
 */
 template <typename T>
 class BlockAllocator
@@ -32,7 +42,24 @@ class BlockAllocator
 	};
 
 	private:
-	std::vector<FreeBlock> FreeBlocks; // Contains all free blocks
+	static const uint32_t SL_BITS = 3;
+	static const uint32_t SL_COUNT = 1 << SL_BITS;
+	static const uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+	struct freenode_t;
+	typedef std::pair<T* const, freenode_t> freeentry_t;
+
+	struct freenode_t {
+		T* end;
+		freeentry_t* prev = nullptr; // Neighbors in the size class list
+		freeentry_t* next = nullptr;
+	};
+
+	std::map<T*, freenode_t> FreeBlocks; // Every free block, keyed by it's start address
+	freeentry_t* classes[FL_COUNT][SL_COUNT] = {};
+	uint64_t flBitmap = 0;               // Bit n is set if any class in range n is non-empty
+	uint32_t slBitmaps[FL_COUNT] = {};   // Non-empty classes within each range
+	size_t freeElements = 0;
 
 	std::vector<T*> allBuffers;    // Contains every buffer made by this allocator
 
@@ -41,6 +68,99 @@ class BlockAllocator
 	size_t used = 0;        // Number of used elements in the active buffer.
 	size_t newBufferLength; // Default length of new buffers
 
+	static uint32_t HighBit(uint64_t value) {
+		#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+		#else
+		return 63 - __builtin_clzll(value);
+		#endif
+	}
+
+	static uint32_t LowBit(uint64_t value) {
+		#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+		#else
+		return __builtin_ctzll(value);
+		#endif
+	}
+
+	// Lengths below SL_COUNT each get their own class
+	static void SizeClass(size_t length, uint32_t& fl, uint32_t& sl) {
+		if (length < SL_COUNT) {
+			fl = 0;
+			sl = static_cast<uint32_t>(length);
+			return;
+		}
+		uint32_t log = HighBit(length);
+		fl = log - SL_BITS + 1;
+		sl = static_cast<uint32_t>(length >> (log - SL_BITS)) & (SL_COUNT - 1);
+	}
+
+	void Link(freeentry_t* e)
+	{
+		uint32_t fl, sl;
+		SizeClass(e->second.end - e->first, fl, sl);
+		e->second.prev = nullptr;
+		e->second.next = classes[fl][sl];
+		if(e->second.next)
+			e->second.next->second.prev = e;
+		classes[fl][sl] = e;
+		slBitmaps[fl] |= 1U << sl;
+		flBitmap |= 1ULL << fl;
+	}
+
+	// Must be called before a block's length changes
+	void Unlink(freeentry_t* e)
+	{
+		uint32_t fl, sl;
+		SizeClass(e->second.end - e->first, fl, sl);
+		if(e->second.prev)
+			e->second.prev->second.next = e->second.next;
+		else classes[fl][sl] = e->second.next;
+		if(e->second.next)
+			e->second.next->second.prev = e->second.prev;
+
+		if (classes[fl][sl] == nullptr) {
+			slBitmaps[fl] &= ~(1U << sl);
+			if(slBitmaps[fl] == 0)
+				flBitmap &= ~(1ULL << fl);
+		}
+	}
+
+	// Returns a free block with at least capacity elements, or nullptr
+	freeentry_t* FindFree(size_t capacity)
+	{
+		uint32_t fl, sl;
+		SizeClass(capacity, fl, sl);
+
+		// The capacity's own class may hold smaller blocks, so only it's first block is considered
+		freeentry_t* e = classes[fl][sl];
+		if(e && static_cast<size_t>(e->second.end - e->first) >= capacity)
+			return e;
+
+		// Every block in the next class up is large enough
+		if (++sl == SL_COUNT) {
+			sl = 0;
+			fl++;
+		}
+		if(fl >= FL_COUNT)
+			return nullptr;
+
+		uint32_t slMap = slBitmaps[fl] & (~0U << sl);
+		if (slMap == 0) {
+			uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ULL << (fl + 1)) : 0;
+			if(flMap == 0)
+				return nullptr;
+			fl = LowBit(flMap);
+			slMap = slBitmaps[fl];
+		}
+		return classes[fl][LowBit(slMap)];
+	}
+
 	public:
 	BlockAllocator() = delete;
 	BlockAllocator(const BlockAllocator<T>& copyFrom) = delete;
@@ -57,23 +177,56 @@ class BlockAllocator
 	/*
 	* For Debugging and Unit Testing
 	*/
-	const std::vector<FreeBlock>& GetBlocks() { return FreeBlocks; }
+
+	// Every free block, in address order
+	std::vector<FreeBlock> GetBlocks() const
+	{
+		std::vector<FreeBlock> blocks;
+		blocks.reserve(FreeBlocks.size());
+		for (const freeentry_t& e : FreeBlocks)
+			blocks.push_back({e.first, e.second.end});
+		return blocks;
+	}
 
 	std::string toString(bool includeBlockList)
 	{
+		size_t largest = 0;
+		size_t rangeCounts[FL_COUNT] = {};
+		for (const freeentry_t& e : FreeBlocks) {
+			size_t length = e.second.end - e.first;
+			uint32_t fl, sl;
+			SizeClass(length, fl, sl);
+			rangeCounts[fl]++;
+			if(length > largest)
+				largest = length;
+		}
+
 		std::ostringstream buffer;
 		buffer << "Number of Buffers: " << allBuffers.size();
 		buffer << "\nActive Buffer Status: " << used << " / " << max << " (used / max)";
 		buffer << "\nNew Buffer Sizes: " << newBufferLength;
 		buffer << "\nAvailable Free Blocks: " << FreeBlocks.size();
+		buffer << "\nFree Elements: " << freeElements;
+		buffer << "\nLargest Free Block: " << largest;
+
+		// Share of free memory that can't be used by a request as large as all of it
+		buffer << "\nFragmentation: " << (freeElements > 0 ? 100.0 - 100.0 * largest / freeElements : 0.0) << "%";
+
+		buffer << "\nFree Blocks by Size (Min Length / Count):";
+		for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+			if(rangeCounts[fl] == 0)
+				continue;
+			size_t minLength = fl == 0 ? 1 : 1ULL << (fl + SL_BITS - 1);
+			buffer << "\n" << minLength << " / " << rangeCounts[fl];
+		}
 
 		if (includeBlockList)
 		{
 			buffer << "\n\nFree Block Log (Addr / Capacity):\n-----";
-			for (FreeBlock f : FreeBlocks)
+			for (const freeentry_t& e : FreeBlocks)
 			{
-				size_t length = f.end - f.start;
-				buffer << '\n' << (void*)f.start << " / " << length;
+				size_t length = e.second.end - e.first;
+				buffer << '\n' << (void*)e.first << " / " << length;
 			}
 		}
 		buffer << '\n';
@@ -92,6 +245,29 @@ class BlockAllocator
 		used = 0;
 	}
 
+	/*
+	 Takes ownership of every buffer belonging to another allocator, leaving it empty.
+	 Blocks reserved from the other allocator remain valid, and can be freed to this one
+	*/
+	void absorb(BlockAllocator<T>& other)
+	{
+		if (other.used < other.max)
+			freeBlock(&other.buffer[other.used], other.max - other.used);
+		for (const freeentry_t& e : other.FreeBlocks)
+			freeBlock(e.first, e.second.end - e.first);
+		allBuffers.insert(allBuffers.end(), other.allBuffers.begin(), other.allBuffers.end());
+
+		other.FreeBlocks.clear();
+		memset(other.classes, 0, sizeof(other.classes));
+		memset(other.slBitmaps, 0, sizeof(other.slBitmaps));
+		other.flBitmap = 0;
+		other.freeElements = 0;
+		other.allBuffers.clear();
+		other.buffer = nullptr;
+		other.max = 0;
+		other.used = 0;
+	}
+
 	/* 
 	 Reserves a block of memory for a specified number elements. 
 	 This will return nullptr if the desired capacity is 0  
@@ -105,23 +281,19 @@ class BlockAllocator
 		{
 			// Do we have a FreeBlock of sufficient size available? 
 				// If yes, use that and return
-
-			for (size_t i = 0, s = FreeBlocks.size(); i < s; i++) 
+			freeentry_t* e = FindFree(capacity);
+			if (e != nullptr)
 			{
-				FreeBlock fb = FreeBlocks[i];
-				size_t length = fb.end - fb.start;
-				if (length > capacity)
-				{
-					block = fb.start;
-					FreeBlocks[i].start += capacity;
-					return block;
-				}
-				else if (length == capacity)
-				{
-					block = fb.start;
-					FreeBlocks.erase(FreeBlocks.begin() + i);
+				Unlink(e);
+				freeElements -= capacity;
+				if (static_cast<size_t>(e->second.end - e->first) == capacity) {
+					block = e->first;
+					FreeBlocks.erase(block);
 					return block;
 				}
+				e->second.end -= capacity;
+				Link(e);
+				return e->second.end;
 			}
 
 			// Edge Case: We need a buffer larger than the size
@@ -148,49 +320,37 @@ class BlockAllocator
 	void freeBlock(T* addr, size_t amount)
 	{
 		if(amount == 0) return;
-		FreeBlock newBlock = {addr, addr + amount};
-
-		/* Binary Search through the FreeBlock array to find a matching block */
-		size_t s = FreeBlocks.size(); 
-		size_t minimum = 0, maximum = s;
-		
-		while (minimum < maximum) {
-			//size_t midPoint = minimum + (maximum - minimum) / 2; // TODO: (max + min) / 2 (This seems to truncate differently - defer for now)
-			size_t midPoint = (minimum + maximum) / 2;
-			FreeBlock fb = FreeBlocks[midPoint];
-			
-			if (fb.start == newBlock.end) {
-				// Two Possibilities:
-				// 1. The new block perfectly fills the gap between two currently existing blocks
-				// 2. Grow the midpoint block leftwards.
-				if (midPoint > 0 && FreeBlocks[midPoint - 1].end == newBlock.start) {
-					FreeBlocks[midPoint-1].end = fb.end;
-					FreeBlocks.erase(FreeBlocks.begin() + midPoint);
-				}
-				else {
-					FreeBlocks[midPoint].start = newBlock.start;
-				}
-				return;
-			}
+		T* end = addr + amount;
+		freeElements += amount;
 
-			if (fb.end == newBlock.start) {
-				// Same as above: the new block fills a gap, or extends the midpoint block rightwards
-				if (midPoint < maximum - 1 && FreeBlocks[midPoint + 1].start == newBlock.end) {
-					FreeBlocks[midPoint + 1].start = fb.start;
-					FreeBlocks.erase(FreeBlocks.begin() + midPoint);
-				}
-				else {
-					FreeBlocks[midPoint].end = newBlock.end;
-				}
-				return;
+		// Merge with the free blocks on either side, if they touch this one
+		freeentry_t* merged = nullptr;
+		typename std::map<T*, freenode_t>::iterator next = FreeBlocks.lower_bound(addr);
+		if (next != FreeBlocks.begin()) {
+			freeentry_t& prev = *std::prev(next);
+			if (prev.second.end == addr) {
+				Unlink(&prev);
+				prev.second.end = end;
+				merged = &prev;
 			}
+		}
 
-			if(fb.start > newBlock.end)
-				maximum = midPoint;
-			else minimum = midPoint + 1; // + 1 should favor an index with a larger value if it exists
+		if (next != FreeBlocks.end() && next->first == end) {
+			Unlink(&*next);
+			if (merged) {
+				merged->second.end = next->second.end;
+				FreeBlocks.erase(next);
+			}
+			else {
+				// Grow the next block leftwards. Reusing the map node avoids an allocation
+				auto node = FreeBlocks.extract(next);
+				node.key() = addr;
+				merged = &*FreeBlocks.insert(std::move(node)).position;
+			}
 		}
 
-		// Minimum will accurately be the first insertable index, maximum will not
-		FreeBlocks.insert(FreeBlocks.begin() + minimum, newBlock);
+		if(merged == nullptr)
+			merged = &*FreeBlocks.emplace(addr, freenode_t{end}).first;
+		Link(merged);
 	}
 };
\ No newline at end of file
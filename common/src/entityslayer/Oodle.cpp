@@ -2,18 +2,32 @@
 // -- edited by Scorp0rX0r 09/09/2020 - Remove file operations and work with streams only.
 // -- Further edited by FlavorfulGecko5 to integrate into .entities parser
 
+#include "Oodle.h"
+#include <cstdint>
+
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <Urlmon.h>
-#include "Oodle.h"
 #pragma comment(lib, "urlmon.lib")
+#define OODLE_DEFAULT_PATH "./oo2core_9_win64.dll"
+#else
+// Oodle ships a shared object for Linux with the same entry points
+#include <dlfcn.h>
+#define WINAPI
+typedef void* HMODULE;
+#define LoadLibraryA(path) dlopen(path, RTLD_NOW | RTLD_LOCAL)
+#define GetProcAddress dlsym
+#define FreeLibrary dlclose
+#define OODLE_DEFAULT_PATH "./liboo2corelinux64.so.9"
+#endif
 
 /* Typedefs from original program */
 typedef unsigned char byte;
 typedef unsigned char uint8;
 typedef unsigned int uint32;
-typedef unsigned __int64 uint64;
-typedef signed __int64 int64;
+typedef uint64_t uint64;
+typedef int64_t int64;
 typedef signed int int32;
 typedef unsigned short uint16;
 typedef signed short int16;
@@ -28,15 +42,25 @@ typedef int WINAPI OodLZ_DecompressFunc(uint8* src_buf, int src_len, uint8* dst,
     int fuzz, int crc, int verbose,
     uint8* dst_base, size_t e, void* cb, void* cb_ctx, void* scratch, size_t scratch_size, int threadPhase);
 
+// Optional - only used to report memory requirements
+typedef int64 WINAPI OodLZ_CompressScratchFunc(int codec, int level, int64 src_len, void* opts);
+typedef int64 WINAPI OodLZ_DecoderMemoryFunc(int codec, int64 dst_len);
+
 /* Variables used in Oodle Functions */
 HMODULE oodle;
 OodLZ_CompressFunc* OodLZ_Compress;
 OodLZ_DecompressFunc* OodLZ_Decompress;
+OodLZ_CompressScratchFunc* OodLZ_CompressScratch;
+OodLZ_DecoderMemoryFunc* OodLZ_DecoderMemory;
 bool initializedSuccessfully = false;
 
 bool Oodle::Download(const wchar_t* url, const wchar_t* writeto) {
+    #ifdef _WIN32
     HRESULT result = URLDownloadToFile(NULL, url, writeto, 0, NULL);
     return result == S_OK;
+    #else
+    return false;
+    #endif
 }
 
 bool Oodle::IsInitialized() {
@@ -44,7 +68,7 @@ bool Oodle::IsInitialized() {
 }
 
 bool Oodle::init() {
-    return Oodle::init("./oo2core_9_win64.dll");
+    return Oodle::init(OODLE_DEFAULT_PATH);
 }
 
 bool Oodle::init(const char* dllpath)
@@ -57,6 +81,8 @@ bool Oodle::init(const char* dllpath)
 
     OodLZ_Decompress = (OodLZ_DecompressFunc*)GetProcAddress(oodle, "OodleLZ_Decompress");
     OodLZ_Compress = (OodLZ_CompressFunc*)GetProcAddress(oodle, "OodleLZ_Compress");
+    OodLZ_CompressScratch = (OodLZ_CompressScratchFunc*)GetProcAddress(oodle, "OodleLZ_GetCompressScratchMemBound");
+    OodLZ_DecoderMemory = (OodLZ_DecoderMemoryFunc*)GetProcAddress(oodle, "OodleLZDecoder_MemorySizeNeeded");
 
     if (OodLZ_Decompress == nullptr || OodLZ_Compress == nullptr)
     { // Couldn't find the function(s)
@@ -64,6 +90,8 @@ bool Oodle::init(const char* dllpath)
         oodle = nullptr;
         OodLZ_Decompress = nullptr;
         OodLZ_Compress = nullptr;
+        OodLZ_CompressScratch = nullptr;
+        OodLZ_DecoderMemory = nullptr;
         return false;
     }
 
@@ -105,3 +133,21 @@ int Oodle::CompressBuffer(char* inputBuffer, size_t inputSize, char* outputBuffe
 
     return OodLZ_Compress(13, (byte*)inputBuffer, inputSize, (byte*)outputBuffer, compLevel, 0, 0, 0, 0, 0);
 }
+
+size_t Oodle::CompressScratchSize(size_t inputSize, int compLevel)
+{
+    if (!initializedSuccessfully || OodLZ_CompressScratch == nullptr)
+        return 0;
+
+    int64 bound = OodLZ_CompressScratch(13, compLevel, (int64)inputSize, nullptr);
+    return bound < 0 ? 0 : (size_t)bound; // Negative if Oodle has no bound
+}
+
+size_t Oodle::DecompressScratchSize(size_t outputSize)
+{
+    if (!initializedSuccessfully || OodLZ_DecoderMemory == nullptr)
+        return 0;
+
+    int64 size = OodLZ_DecoderMemory(-1, (int64)outputSize); // -1: Any compressor
+    return size < 0 ? 0 : (size_t)size;
+}
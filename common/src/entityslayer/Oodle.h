@@ -2,6 +2,8 @@
 // -- edited by Scorp0rX0r 09/09/2020 - Remove file operations and work with streams only.
 // -- Further edited by FlavorfulGecko5 to integrate into .entities parser
 
+#include <cstddef>
+
 namespace Oodle 
 {
     bool Download(const wchar_t* url, const wchar_t* saveto);
@@ -12,4 +14,8 @@ namespace Oodle
     bool CompressBuffer(char* inputBuffer, size_t inputSize, char* outputBuffer, size_t& outputSize);
 
     int CompressBuffer(char* inputBuffer, size_t inputSize, char* outputBuffer, int compLevel);
+
+    // Working memory Oodle allocates for a single call. Returns 0 if the loaded library can't report it
+    size_t CompressScratchSize(size_t inputSize, int compLevel);
+    size_t DecompressScratchSize(size_t outputSize);
 }
\ No newline at end of file
@@ -7,10 +7,24 @@
 
 /*
 * If set to 0, disable the history system
+* Projects may define this themselves, as EntityParserTesting does to test the history
 */
+#ifndef entityparser_history
 #define entityparser_history 0
+#endif
 
 /*
 * If set to 0, disable usage of the Oodle compression system
 */
-#define entityparser_oodle 1
\ No newline at end of file
+#define entityparser_oodle 1
+
+/*
+* If set to 0, the tokenizer scans whitespace, identifiers, strings and comments
+* one character at a time instead of with SSE2/AVX2 comparisons
+*/
+#define entityparser_simd 1
+/*
+* If set to 0, key lookups always scan a node's children instead of
+* building a hashed index for nodes with many children
+*/
+#define entityparser_childindex 1
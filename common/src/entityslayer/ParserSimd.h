@@ -0,0 +1,229 @@
+#pragma once
+#include "ParserConfig.h"
+#include <cstdint>
+
+/*
+* Character class scanners for the EntityParser tokenizer
+*
+* Each scanner returns the first character in [ch, end) that stops a run of the
+* class, or end if the run reaches the end of the buffer. Blocks of 32 (AVX2)
+* or 16 (SSE2) characters are classified at once. Loads never extend past end;
+* the remainder of the buffer is scanned one character at a time.
+*
+* SSE2 is part of every x64 target. The AVX2 path is used when compiling with
+* /arch:AVX2 (or -mavx2). Other targets, or entityparser_simd 0, use the scalar loops
+*/
+#if entityparser_simd && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__))
+#define PARSERSIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define PARSERSIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ParserSimd
+{
+	inline uint32_t FirstBit(uint32_t mask) {
+		#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+		#else
+		return __builtin_ctz(mask);
+		#endif
+	}
+
+	inline uint32_t FirstBit64(uint64_t mask) {
+		#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return index;
+		#else
+		return __builtin_ctzll(mask);
+		#endif
+	}
+
+	/*
+	* Vector helpers, overloaded for both vector widths.
+	* Comparisons return 0xFF in every matching byte
+	*/
+	#if PARSERSIMD_SSE2
+	inline __m128i Equal(__m128i v, char c) {return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));}
+	inline __m128i Or(__m128i a, __m128i b) {return _mm_or_si128(a, b);}
+	inline __m128i Not(__m128i v) {return _mm_xor_si128(v, _mm_set1_epi8(-1));}
+	inline __m128i Lowercase(__m128i v) {return _mm_or_si128(v, _mm_set1_epi8(32));}
+	inline uint32_t Mask(__m128i v) {return static_cast<uint32_t>(_mm_movemask_epi8(v));}
+
+	// Unsigned (v - low) <= span
+	inline __m128i InRange(__m128i v, char low, char span) {
+		__m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(low));
+		return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(span)), offset);
+	}
+	#endif
+
+	#if PARSERSIMD_AVX2
+	inline __m256i Equal(__m256i v, char c) {return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));}
+	inline __m256i Or(__m256i a, __m256i b) {return _mm256_or_si256(a, b);}
+	inline __m256i Not(__m256i v) {return _mm256_xor_si256(v, _mm256_set1_epi8(-1));}
+	inline __m256i Lowercase(__m256i v) {return _mm256_or_si256(v, _mm256_set1_epi8(32));}
+	inline uint32_t Mask(__m256i v) {return static_cast<uint32_t>(_mm256_movemask_epi8(v));}
+
+	inline __m256i InRange(__m256i v, char low, char span) {
+		__m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+		return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(span)), offset);
+	}
+	#endif
+
+	/*
+	* Scans until Class::Stops is true. A class supplies a scalar test
+	* and a templated vector test written with the helpers above
+	*/
+	template<typename Class>
+	inline const char* Scan(const char* ch, const char* end, const Class& c)
+	{
+		#if PARSERSIMD_AVX2
+		while (end - ch >= 32) {
+			uint32_t stops = Mask(c.Stops(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ch))));
+			if(stops)
+				return ch + FirstBit(stops);
+			ch += 32;
+		}
+		#endif
+
+		#if PARSERSIMD_SSE2
+		while (end - ch >= 16) {
+			uint32_t stops = Mask(c.Stops(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ch))));
+			if(stops)
+				return ch + FirstBit(stops);
+			ch += 16;
+		}
+		#endif
+
+		while(ch < end && !c.Stops(*ch))
+			ch++;
+		return ch;
+	}
+
+	/*
+	* One bit per character of a 64 character block, set where Class::Stops is true.
+	* Lets callers that track state across many stops walk the bits of a block
+	* instead of restarting a scan after every stop
+	*/
+	template<typename Class>
+	inline uint64_t Mask64(const char* block, const Class& c)
+	{
+		#if PARSERSIMD_AVX2
+		uint64_t low = Mask(c.Stops(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block))));
+		uint64_t high = Mask(c.Stops(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32))));
+		return low | high << 32;
+		#elif PARSERSIMD_SSE2
+		uint64_t mask = 0;
+		for(int i = 0; i < 4; i++)
+			mask |= static_cast<uint64_t>(Mask(c.Stops(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16))))) << (i * 16);
+		return mask;
+		#else
+		uint64_t mask = 0;
+		for (int i = 0; i < 64; i++) {
+			if(c.Stops(block[i]))
+				mask |= 1ULL << i;
+		}
+		return mask;
+		#endif
+	}
+
+	/*
+	* Character classes
+	*/
+
+	// Runs of spaces and tabs, plus line feeds when newlines aren't tokens.
+	// Carriage returns stop the run so the tokenizer can verify a line feed follows them
+	struct blank_t {
+		bool newlines;
+
+		bool Stops(char c) const {
+			return !(c == ' ' || c == '\t' || (newlines && c == '\n'));
+		}
+
+		template<typename V> V Stops(V v) const {
+			V blank = Or(Equal(v, ' '), Equal(v, '\t'));
+			return Not(newlines ? Or(blank, Equal(v, '\n')) : blank);
+		}
+	};
+
+	// Runs of letters, digits and underscores, plus percent signs in permissive mode
+	struct identifier_t {
+		bool percent;
+
+		bool Stops(char c) const {
+			return !(((unsigned)(c | 32) - 'a') < 26U || ((unsigned)c - '0') < 10U || c == '_' || (percent && c == '%'));
+		}
+
+		template<typename V> V Stops(V v) const {
+			V word = Or(Or(InRange(Lowercase(v), 'a', 25), InRange(v, '0', 9)), Equal(v, '_'));
+			return Not(percent ? Or(word, Equal(v, '%')) : word);
+		}
+	};
+
+	// Stops at line breaks
+	struct lineend_t {
+		bool Stops(char c) const {
+			return c == '\n' || c == '\r';
+		}
+
+		template<typename V> V Stops(V v) const {
+			return Or(Equal(v, '\n'), Equal(v, '\r'));
+		}
+	};
+
+	// Stops at a single character
+	struct char_t {
+		char c;
+
+		bool Stops(char x) const {
+			return x == c;
+		}
+
+		template<typename V> V Stops(V v) const {
+			return Equal(v, c);
+		}
+	};
+
+	// Stops at characters that end or interrupt a string literal: quotes, line breaks, and backslashes in JSON
+	struct stringbody_t {
+		bool escapes;
+
+		bool Stops(char c) const {
+			return c == '"' || c == '\n' || c == '\r' || (escapes && c == '\\');
+		}
+
+		template<typename V> V Stops(V v) const {
+			V stops = Or(Equal(v, '"'), Or(Equal(v, '\n'), Equal(v, '\r')));
+			return escapes ? Or(stops, Equal(v, '\\')) : stops;
+		}
+	};
+
+	inline const char* SkipBlanks(const char* ch, const char* end, bool newlines) {
+		return Scan(ch, end, blank_t{newlines});
+	}
+
+	inline const char* SkipIdentifier(const char* ch, const char* end, bool percent) {
+		return Scan(ch, end, identifier_t{percent});
+	}
+
+	inline const char* FindLineEnd(const char* ch, const char* end) {
+		return Scan(ch, end, lineend_t{});
+	}
+
+	inline const char* FindChar(const char* ch, const char* end, char c) {
+		return Scan(ch, end, char_t{c});
+	}
+
+	inline const char* FindStringStop(const char* ch, const char* end, bool escapes) {
+		return Scan(ch, end, stringbody_t{escapes});
+	}
+}
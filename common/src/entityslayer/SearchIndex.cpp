@@ -0,0 +1,158 @@
+#include "SearchIndex.h"
+#include "EntityNode.h"
+#include <algorithm>
+#include <iterator>
+
+// Matches the case folding of EntNode::searchText
+static inline uint8_t FoldCase(char c)
+{
+	if(c > '`' && c < '{') c -= 32;
+	return static_cast<uint8_t>(c);
+}
+
+// Passes every trigram of the text to the callback, continuing the window from previous reads
+template<typename T>
+struct trigramreader_t {
+	T& callback;
+	uint32_t window = 0;
+	size_t length = 0;
+
+	void Read(std::string_view text)
+	{
+		for (char c : text) {
+			window = (window << 8 | FoldCase(c)) & 0xFFFFFF;
+			if(++length >= 3)
+				callback(window);
+		}
+	}
+};
+
+template<typename T>
+static void ReadTrigrams(const EntNode& node, T& callback)
+{
+	// Trigrams may span the name and value, since searches match the joined text
+	trigramreader_t<T> reader = {callback};
+	reader.Read(node.getName());
+	reader.Read(node.getValue());
+
+	EntNode** children = node.getChildBuffer();
+	for (int i = 0, max = node.getChildCount(); i < max; i++)
+		ReadTrigrams(*children[i], callback);
+}
+
+void SearchIndex::Clear()
+{
+	slots.clear();
+	slotEntities.clear();
+	postings.clear();
+	deadSlots = 0;
+}
+
+void SearchIndex::Add(const EntNode* entity)
+{
+	Remove(entity);
+
+	uint32_t slot = static_cast<uint32_t>(slotEntities.size());
+	slotEntities.push_back(entity);
+	slots[entity] = slot;
+
+	// This entity's slot is the largest, so it's a duplicate if it's already at the back
+	auto AddTrigram = [this, slot](uint32_t trigram) {
+		std::vector<uint32_t>& list = postings[trigram];
+		if(list.empty() || list.back() != slot)
+			list.push_back(slot);
+	};
+	ReadTrigrams(*entity, AddTrigram);
+}
+
+void SearchIndex::Remove(const EntNode* entity)
+{
+	auto iter = slots.find(entity);
+	if(iter == slots.end())
+		return;
+
+	slotEntities[iter->second] = nullptr;
+	slots.erase(iter);
+	deadSlots++;
+
+	if(deadSlots > slots.size())
+		Purge();
+}
+
+void SearchIndex::Purge()
+{
+	for (auto iter = postings.begin(); iter != postings.end(); ) {
+		std::vector<uint32_t>& list = iter->second;
+		list.erase(std::remove_if(list.begin(), list.end(), [this](uint32_t slot) {
+			return slotEntities[slot] == nullptr;
+		}), list.end());
+
+		if(list.empty())
+			iter = postings.erase(iter);
+		else iter++;
+	}
+	deadSlots = 0;
+}
+
+bool SearchIndex::Candidates(std::string_view key, std::vector<uint32_t>& candidates) const
+{
+	if(key.length() < MIN_KEY_LENGTH)
+		return false;
+
+	std::vector<uint32_t> trigrams;
+	auto AddTrigram = [&trigrams](uint32_t trigram) { trigrams.push_back(trigram); };
+	trigramreader_t<decltype(AddTrigram)> reader = {AddTrigram};
+	reader.Read(key);
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	std::vector<const std::vector<uint32_t>*> lists;
+	for (uint32_t trigram : trigrams) {
+		auto iter = postings.find(trigram);
+		if(iter == postings.end())
+			return true; // No entity contains the key
+		lists.push_back(&iter->second);
+	}
+
+	// Intersect the shortest lists first, so the intermediate results stay small
+	std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+		return a->size() < b->size();
+	});
+
+	std::vector<uint32_t> intersection;
+	candidates = *lists[0];
+	for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+		const std::vector<uint32_t>& list = *lists[i];
+
+		// Binary searches are faster once the candidates are much fewer than the list's slots
+		if (candidates.size() * 16 < list.size()) {
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&list](uint32_t slot) {
+				return !std::binary_search(list.begin(), list.end(), slot);
+			}), candidates.end());
+			continue;
+		}
+
+		intersection.clear();
+		std::set_intersection(candidates.begin(), candidates.end(), list.begin(), list.end(), std::back_inserter(intersection));
+		candidates.swap(intersection);
+	}
+	return true;
+}
+
+bool SearchIndex::IsCandidate(const EntNode* entity, const std::vector<uint32_t>& candidates) const
+{
+	auto iter = slots.find(entity);
+	return iter != slots.end() && std::binary_search(candidates.begin(), candidates.end(), iter->second);
+}
+
+size_t SearchIndex::MemoryUsage() const
+{
+	size_t sum = slotEntities.capacity() * sizeof(const EntNode*)
+		+ slots.size() * (sizeof(const EntNode*) + sizeof(uint32_t) + sizeof(void*) * 2)
+		+ slots.bucket_count() * sizeof(void*)
+		+ postings.bucket_count() * sizeof(void*);
+
+	for(const auto& pair : postings)
+		sum += sizeof(pair) + sizeof(void*) + pair.second.capacity() * sizeof(uint32_t);
+	return sum;
+}
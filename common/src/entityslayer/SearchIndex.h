@@ -0,0 +1,60 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+class EntNode;
+
+/*
+* Inverted trigram index over the text of top-level nodes, used to skip
+* entities that can't contain a search key without traversing them.
+*
+* Every node's name and value are joined, as EntNode::searchText does, and
+* case folded. Each trigram maps to a list of the entities containing it,
+* so any entity containing a key contains all of the key's trigrams.
+* Results are only candidates: searches must still verify them with searchText.
+*
+* Entities are identified by slots, assigned in increasing order as they're
+* added, which keeps every posting list sorted for intersection. Removing an
+* entity only kills it's slot. Dead slots are purged from the posting
+* lists once they outnumber the live ones
+*/
+class SearchIndex
+{
+	private:
+	std::unordered_map<const EntNode*, uint32_t> slots;          // Slot of each live entity
+	std::vector<const EntNode*> slotEntities;                     // Entity of each slot, or nullptr if it's dead
+	std::unordered_map<uint32_t, std::vector<uint32_t>> postings; // Slots of the entities containing each trigram
+	size_t deadSlots = 0;
+
+	void Purge();
+
+	public:
+	static const size_t MIN_KEY_LENGTH = 3;
+
+	void Clear();
+
+	// Number of indexed entities
+	size_t Size() const { return slots.size(); }
+
+	bool Contains(const EntNode* entity) const { return slots.count(entity) > 0; }
+
+	// Indexes the text of an entity and all of it's descendants
+	void Add(const EntNode* entity);
+
+	// Removes an entity, if it's indexed
+	void Remove(const EntNode* entity);
+
+	/*
+	* Finds the slots of the entities that may contain the key, in ascending order
+	* @return False if the key is too short to narrow the search, leaving candidates empty
+	*/
+	bool Candidates(std::string_view key, std::vector<uint32_t>& candidates) const;
+
+	// True if the entity is indexed and it's slot is one of the candidates
+	bool IsCandidate(const EntNode* entity, const std::vector<uint32_t>& candidates) const;
+
+	// Bytes allocated by the posting lists and slot tables
+	size_t MemoryUsage() const;
+};
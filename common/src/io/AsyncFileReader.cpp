@@ -0,0 +1,318 @@
+#include "AsyncFileReader.h"
+#include <fstream>
+
+#ifdef ATLAN_IO_URING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct AsyncFileReader::uring_t {
+	struct slot_t {
+		request_t request;
+		char* buffer = nullptr;
+		size_t capacity = 0;
+		size_t done = 0; // Bytes read so far. Short reads are resubmitted for the remainder
+	};
+
+	io_uring ring;
+	int fd = -1;
+	std::vector<slot_t> slots;
+	std::vector<uint32_t> freeslots;
+	std::deque<request_t> pending; // Waiting for a free slot
+};
+#endif
+
+/*
+* Buffer Pool
+*/
+
+IOBufferPool::~IOBufferPool()
+{
+	for(buffer_t& b : available)
+		delete[] b.data;
+}
+
+char* IOBufferPool::Acquire(size_t length, size_t& capacity)
+{
+	const size_t GRANULARITY = 64 * 1024;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		// Smallest buffer that fits
+		size_t best = available.size();
+		for (size_t i = 0; i < available.size(); i++) {
+			if(available[i].capacity < length)
+				continue;
+			if(best == available.size() || available[i].capacity < available[best].capacity)
+				best = i;
+		}
+
+		if (best != available.size()) {
+			buffer_t b = available[best];
+			available[best] = available.back();
+			available.pop_back();
+			capacity = b.capacity;
+			return b.data;
+		}
+	}
+
+	// Rounding up lets buffers be reused for reads of similar sizes
+	capacity = (length / GRANULARITY + 1) * GRANULARITY;
+	return new char[capacity];
+}
+
+void IOBufferPool::Release(char* buffer, size_t capacity)
+{
+	if(buffer == nullptr)
+		return;
+	std::lock_guard<std::mutex> guard(lock);
+	available.push_back({buffer, capacity});
+}
+
+/*
+* Reader
+*/
+
+AsyncFileReader::AsyncFileReader(int p_queuedepth)
+{
+	queuedepth = p_queuedepth > 0 ? p_queuedepth : DEFAULT_QUEUE_DEPTH;
+}
+
+bool AsyncFileReader::Open(const std::filesystem::path& path)
+{
+	Close();
+	filepath = path;
+
+	{
+		std::ifstream test(path, std::ios_base::binary);
+		if(!test.good())
+			return false;
+	}
+
+	#ifdef ATLAN_IO_URING
+	if(UringOpen())
+		return true;
+	#endif
+
+	int threadcount = queuedepth < MAX_READ_THREADS ? queuedepth : MAX_READ_THREADS;
+	stopping = false;
+	threads.reserve(threadcount);
+	for(int i = 0; i < threadcount; i++)
+		threads.emplace_back(&AsyncFileReader::ReadThread, this);
+	return true;
+}
+
+const char* AsyncFileReader::Backend() const
+{
+	#ifdef ATLAN_IO_URING
+	if(uring)
+		return "io_uring";
+	#endif
+	return threads.empty() ? "none" : "thread pool";
+}
+
+void AsyncFileReader::Submit(const request_t& request)
+{
+	inflight++;
+
+	#ifdef ATLAN_IO_URING
+	if (uring) {
+		uring->pending.push_back(request);
+		UringFill();
+		return;
+	}
+	#endif
+
+	{
+		std::lock_guard<std::mutex> guard(queuelock);
+		queue.push_back(request);
+	}
+	queuesignal.notify_one();
+}
+
+bool AsyncFileReader::Wait(completion_t& c)
+{
+	if(inflight == 0)
+		return false;
+
+	#ifdef ATLAN_IO_URING
+	if (uring) {
+		while(completed.empty())
+			UringReap();
+		c = completed.front();
+		completed.pop_front();
+		inflight--;
+		return true;
+	}
+	#endif
+
+	std::unique_lock<std::mutex> lock(queuelock);
+	completesignal.wait(lock, [this]{return !completed.empty();});
+	c = completed.front();
+	completed.pop_front();
+	inflight--;
+	return true;
+}
+
+void AsyncFileReader::Close()
+{
+	#ifdef ATLAN_IO_URING
+	if (uring) {
+		// Reads that never reached the ring are dropped. The rest must land before their buffers are freed
+		uring->pending.clear();
+		while(uring->freeslots.size() < uring->slots.size())
+			UringReap();
+
+		io_uring_queue_exit(&uring->ring);
+		close(uring->fd);
+		delete uring;
+		uring = nullptr;
+	}
+	#endif
+
+	if (!threads.empty()) {
+		{
+			std::lock_guard<std::mutex> guard(queuelock);
+			stopping = true;
+		}
+		queuesignal.notify_all();
+		for(std::thread& t : threads)
+			t.join();
+		threads.clear();
+	}
+
+	for(const completion_t& c : completed)
+		Release(c);
+	completed.clear();
+	inflight = 0;
+}
+
+void AsyncFileReader::ReadThread()
+{
+	std::ifstream file(filepath, std::ios_base::binary);
+
+	while (true) {
+		request_t request;
+		{
+			std::unique_lock<std::mutex> lock(queuelock);
+			queuesignal.wait(lock, [this]{return stopping || !queue.empty();});
+
+			// Finish the queue before stopping
+			if(queue.empty())
+				return;
+			request = queue.front();
+			queue.pop_front();
+		}
+
+		completion_t c;
+		c.userdata = request.userdata;
+		c.length = request.length;
+		c.buffer = pool.Acquire(request.length, c.capacity);
+
+		file.seekg(request.offset, std::ios_base::beg);
+		file.read(c.buffer, request.length);
+		c.okay = file.good();
+		if(!c.okay)
+			file.clear();
+
+		{
+			std::lock_guard<std::mutex> guard(queuelock);
+			completed.push_back(c);
+		}
+		completesignal.notify_one();
+	}
+}
+
+#ifdef ATLAN_IO_URING
+
+bool AsyncFileReader::UringOpen()
+{
+	int fd = open(filepath.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	uring = new uring_t;
+	uring->fd = fd;
+	if (io_uring_queue_init(queuedepth, &uring->ring, 0) != 0) {
+		// Kernel without io_uring support, or it's disabled: use the thread pool
+		close(fd);
+		delete uring;
+		uring = nullptr;
+		return false;
+	}
+
+	uring->slots.resize(queuedepth);
+	uring->freeslots.reserve(queuedepth);
+	for(int i = queuedepth - 1; i >= 0; i--)
+		uring->freeslots.push_back(static_cast<uint32_t>(i));
+	return true;
+}
+
+static void UringPrepRead(io_uring& ring, int fd, uint32_t slotindex, char* buffer, size_t length, uint64_t offset)
+{
+	// The ring has a submission entry for every slot, so this never fails
+	io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+	io_uring_prep_read(sqe, fd, buffer, static_cast<unsigned>(length), offset);
+	io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(slotindex)));
+}
+
+void AsyncFileReader::UringFill()
+{
+	bool added = false;
+	while (!uring->pending.empty() && !uring->freeslots.empty()) {
+		uint32_t index = uring->freeslots.back();
+		uring->freeslots.pop_back();
+
+		uring_t::slot_t& s = uring->slots[index];
+		s.request = uring->pending.front();
+		uring->pending.pop_front();
+		s.buffer = pool.Acquire(s.request.length, s.capacity);
+		s.done = 0;
+
+		UringPrepRead(uring->ring, uring->fd, index, s.buffer, s.request.length, s.request.offset);
+		added = true;
+	}
+
+	if(added)
+		io_uring_submit(&uring->ring);
+}
+
+void AsyncFileReader::UringReap()
+{
+	io_uring_cqe* cqe = nullptr;
+	if(io_uring_wait_cqe(&uring->ring, &cqe) != 0)
+		return;
+
+	bool resubmit = false;
+	do {
+		uint32_t index = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+		int result = cqe->res;
+		io_uring_cqe_seen(&uring->ring, cqe);
+
+		uring_t::slot_t& s = uring->slots[index];
+		bool failed = result < 0 || (result == 0 && s.done < s.request.length);
+		if(!failed)
+			s.done += static_cast<size_t>(result);
+
+		if (!failed && s.done < s.request.length) {
+			UringPrepRead(uring->ring, uring->fd, index, s.buffer + s.done, s.request.length - s.done, s.request.offset + s.done);
+			resubmit = true;
+			continue;
+		}
+
+		completion_t c;
+		c.userdata = s.request.userdata;
+		c.buffer = s.buffer;
+		c.capacity = s.capacity;
+		c.length = s.request.length;
+		c.okay = !failed;
+		completed.push_back(c);
+		uring->freeslots.push_back(index);
+	} while(io_uring_peek_cqe(&uring->ring, &cqe) == 0);
+
+	if(resubmit)
+		io_uring_submit(&uring->ring);
+	UringFill();
+}
+
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+
+/*
+* Pool of reusable read buffers. Thread-safe
+*/
+class IOBufferPool {
+	private:
+	struct buffer_t {
+		char* data;
+		size_t capacity;
+	};
+
+	std::mutex lock;
+	std::vector<buffer_t> available;
+
+	public:
+	IOBufferPool() = default;
+	IOBufferPool(const IOBufferPool& b) = delete;
+	void operator=(const IOBufferPool& b) = delete;
+	~IOBufferPool();
+
+	// Returns a buffer holding at least length bytes. It's true capacity is written to capacity
+	char* Acquire(size_t length, size_t& capacity);
+
+	void Release(char* buffer, size_t capacity);
+};
+
+/*
+* Issues many positional reads against one file at once
+*
+* Reads are submitted in bulk and complete, in any order, into buffers drawn
+* from a pool. Every completion must be released once the caller is done with it.
+*
+* Backends:
+* - io_uring: Linux builds with ATLAN_IO_URING defined (links against liburing)
+* - Thread pool: every other build, or if the ring can't be created. Each thread
+*   owns a file handle and issues blocking reads, keeping several requests queued on the disk
+*/
+class AsyncFileReader {
+	public:
+	static const int DEFAULT_QUEUE_DEPTH = 32;
+	static const int MAX_READ_THREADS = 16;
+
+	struct request_t {
+		uint64_t offset;
+		size_t length;
+		uint64_t userdata; // Returned with the completion
+	};
+
+	struct completion_t {
+		uint64_t userdata = 0;
+		char* buffer = nullptr;
+		size_t length = 0;
+		size_t capacity = 0;
+		bool okay = false;
+	};
+
+	private:
+	std::filesystem::path filepath;
+	IOBufferPool pool;
+	int queuedepth;
+	size_t inflight = 0; // Submitted and not yet returned by Wait
+
+	// Completed reads not yet returned by Wait. Shared by both backends
+	std::deque<completion_t> completed;
+
+	// Thread pool backend
+	std::vector<std::thread> threads;
+	std::mutex queuelock;
+	std::condition_variable queuesignal;
+	std::condition_variable completesignal;
+	std::deque<request_t> queue;
+	bool stopping = false;
+
+	void ReadThread();
+
+	#ifdef ATLAN_IO_URING
+	struct uring_t;
+	uring_t* uring = nullptr;
+
+	bool UringOpen();
+	void UringFill();
+	void UringReap();
+	#endif
+
+	public:
+	AsyncFileReader(int p_queuedepth = DEFAULT_QUEUE_DEPTH);
+
+	AsyncFileReader(const AsyncFileReader& b) = delete;
+	void operator=(const AsyncFileReader& b) = delete;
+
+	~AsyncFileReader() {
+		Close();
+	}
+
+	bool Open(const std::filesystem::path& path);
+
+	// Waits for outstanding reads to finish, then shuts down the backend
+	void Close();
+
+	// Number of reads submitted that Wait hasn't returned yet
+	size_t InFlight() const {return inflight;}
+
+	// Name of the backend serving reads: "io_uring", "thread pool", or "none" if no file is open
+	const char* Backend() const;
+
+	void Submit(const request_t& request);
+
+	/*
+	* Blocks until a read completes and writes it to c.
+	* Returns false if no reads are in flight
+	*/
+	bool Wait(completion_t& c);
+
+	// Returns a completion's buffer to the pool
+	void Release(const completion_t& c) {
+		pool.Release(c.buffer, c.capacity);
+	}
+};
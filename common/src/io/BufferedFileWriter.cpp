@@ -0,0 +1,94 @@
+#include "BufferedFileWriter.h"
+#include <cstring>
+#include <new>
+
+BufferedFileWriter::BufferedFileWriter(size_t buffercapacity)
+{
+	// Round up so the buffer fills whole pages
+	capacity = (buffercapacity + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+	buffer = static_cast<char*>(operator new[](capacity, std::align_val_t(BUFFER_ALIGNMENT)));
+}
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+	if(file.is_open())
+		Close();
+	operator delete[](buffer, std::align_val_t(BUFFER_ALIGNMENT));
+}
+
+bool BufferedFileWriter::Open(const std::filesystem::path& path)
+{
+	file.open(path, std::ios_base::binary);
+	filled = 0;
+	bufferstart = 0;
+	return file.good();
+}
+
+bool BufferedFileWriter::Flush()
+{
+	if (filled > 0) {
+		file.write(buffer, filled);
+		bufferstart += filled;
+		filled = 0;
+	}
+	return file.good();
+}
+
+bool BufferedFileWriter::Write(const char* data, size_t length)
+{
+	if (length > capacity - filled) {
+		if(!Flush())
+			return false;
+
+		// Too large to be worth buffering
+		if (length >= capacity) {
+			file.write(data, length);
+			bufferstart += length;
+			return file.good();
+		}
+	}
+
+	memcpy(buffer + filled, data, length);
+	filled += length;
+	return true;
+}
+
+bool BufferedFileWriter::WriteZeros(size_t count)
+{
+	while (count > 0) {
+		if (filled == capacity && !Flush())
+			return false;
+
+		size_t chunk = capacity - filled;
+		if(chunk > count)
+			chunk = count;
+
+		memset(buffer + filled, 0, chunk);
+		filled += chunk;
+		count -= chunk;
+	}
+	return true;
+}
+
+bool BufferedFileWriter::PadTo(uint64_t position)
+{
+	if(position < Position())
+		return false;
+	return WriteZeros(static_cast<size_t>(position - Position()));
+}
+
+bool BufferedFileWriter::Seek(uint64_t position)
+{
+	if(!Flush())
+		return false;
+	file.seekp(position, std::ios_base::beg);
+	bufferstart = position;
+	return file.good();
+}
+
+bool BufferedFileWriter::Close()
+{
+	bool okay = Flush();
+	file.close(); // Sets failbit if the final write to disk fails
+	return okay && !file.fail();
+}
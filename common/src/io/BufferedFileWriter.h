@@ -0,0 +1,57 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+
+/*
+* Streams data to a file through a large aligned buffer
+*
+* Small writes and zero padding are coalesced in memory and reach the
+* file as a few large sequential writes. Writes larger than the buffer
+* bypass it. Seeking flushes the buffer
+*/
+class BufferedFileWriter {
+	private:
+	std::ofstream file;
+	char* buffer = nullptr;
+	size_t capacity = 0;
+	size_t filled = 0;
+	uint64_t bufferstart = 0; // File position of the first byte in the buffer
+
+	public:
+	static const size_t DEFAULT_CAPACITY = 8 * 1024 * 1024;
+	static const size_t BUFFER_ALIGNMENT = 4096;
+
+	BufferedFileWriter(size_t buffercapacity = DEFAULT_CAPACITY);
+
+	BufferedFileWriter(const BufferedFileWriter& b) = delete;
+	void operator=(const BufferedFileWriter& b) = delete;
+
+	~BufferedFileWriter();
+
+	bool Open(const std::filesystem::path& path);
+
+	bool Okay() const {
+		return file.good();
+	}
+
+	// Current write position in the file
+	uint64_t Position() const {
+		return bufferstart + filled;
+	}
+
+	bool Write(const char* data, size_t length);
+
+	// Writes the given number of zero bytes
+	bool WriteZeros(size_t count);
+
+	// Writes zeros up to an absolute position. Position must not be behind the current one
+	bool PadTo(uint64_t position);
+
+	bool Seek(uint64_t position);
+
+	bool Flush();
+
+	// Flushes remaining data and closes the file. Returns false if any write failed
+	bool Close();
+};
@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return;
+	filehandle = file;
+
+	// Zero-length files cannot be mapped
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx(file, &filesize) || filesize.QuadPart == 0) {
+		Close();
+		return;
+	}
+
+	maphandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (maphandle == nullptr) {
+		Close();
+		return;
+	}
+
+	view = static_cast<const char*>(MapViewOfFile(maphandle, FILE_MAP_READ, 0, 0, 0));
+	if (view == nullptr) {
+		Close();
+		return;
+	}
+	length = static_cast<size_t>(filesize.QuadPart);
+}
+
+void MappedFile::Close()
+{
+	if(view)
+		UnmapViewOfFile(view);
+	if(maphandle)
+		CloseHandle(maphandle);
+	if(filehandle)
+		CloseHandle(filehandle);
+
+	view = nullptr;
+	maphandle = nullptr;
+	filehandle = nullptr;
+	length = 0;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t count) const
+{
+	if(offset >= length)
+		return;
+	if(count > length - offset)
+		count = length - offset;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<char*>(view + offset);
+	range.NumberOfBytes = count;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	filedescriptor = open(path.c_str(), O_RDONLY);
+	if(filedescriptor == -1)
+		return;
+
+	struct stat filestats;
+	if (fstat(filedescriptor, &filestats) != 0 || filestats.st_size == 0) {
+		Close();
+		return;
+	}
+
+	void* mapping = mmap(nullptr, filestats.st_size, PROT_READ, MAP_PRIVATE, filedescriptor, 0);
+	if (mapping == MAP_FAILED) {
+		Close();
+		return;
+	}
+	view = static_cast<const char*>(mapping);
+	length = static_cast<size_t>(filestats.st_size);
+}
+
+void MappedFile::Close()
+{
+	if(view)
+		munmap(const_cast<char*>(view), length);
+	if(filedescriptor != -1)
+		close(filedescriptor);
+
+	view = nullptr;
+	filedescriptor = -1;
+	length = 0;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t count) const
+{
+	if(offset >= length)
+		return;
+	if(count > length - offset)
+		count = length - offset;
+
+	// madvise requires a page-aligned address
+	size_t pagestart = offset & ~(static_cast<size_t>(sysconf(_SC_PAGESIZE)) - 1);
+	madvise(const_cast<char*>(view + pagestart), count + (offset - pagestart), MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <filesystem>
+
+/*
+* Read-only memory mapping of an entire file
+*
+* Pointers obtained from data() remain valid for the lifetime of this object.
+* The mapping is read-only: writing through a pointer into it will crash
+*/
+class MappedFile {
+	private:
+	const char* view = nullptr;
+	size_t length = 0;
+
+	#ifdef _WIN32
+	void* filehandle = nullptr;
+	void* maphandle = nullptr;
+	#else
+	int filedescriptor = -1;
+	#endif
+
+	void Close();
+
+	public:
+	MappedFile(const std::filesystem::path& path);
+
+	MappedFile(const MappedFile& b) = delete;
+	void operator=(const MappedFile& b) = delete;
+
+	~MappedFile() {
+		Close();
+	}
+
+	bool Okay() const {
+		return view != nullptr;
+	}
+
+	const char* data() const {return view;}
+
+	size_t len() const {return length;}
+
+	/*
+	* Hints to the operating system that the given range of the mapping
+	* will be read soon, so it may be paged in ahead of time
+	*/
+	void Prefetch(size_t offset, size_t count) const;
+};
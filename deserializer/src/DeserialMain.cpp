@@ -4,8 +4,11 @@
 #include <cassert>
 #include <set>
 #include "archives/ResourceStructs.h"
+#include "archives/ResourceBatch.h"
+#include "archives/ResourceVFS.h"
 #include "archives/PackageMapSpec.h"
 #include "archives/ResourceEnums.h"
+#include "archives/ExtractionManifest.h"
 #include "staticsparser.h"
 #include "io/BinaryReader.h"
 #include "deserialcore.h"
@@ -34,115 +37,128 @@ void StaticsTest() {
 	StaticsParser::Parse(r);
 }
 
-void Deserializer::DeserialInit(const fspath& gamedir, const fspath& filedir, bool p_include_originals) {
+bool Deserializer::DeserialInit(const fspath& gamedir, const fspath& filedir, bool p_include_originals) {
 	atlog << "Building Decl Farmhash Map\n";
 	deserial::include_originals = p_include_originals;
 
-	const fspath basepath = gamedir / "base";
 	const fspath entitydir = filedir / "entityDef";
-	const std::set<std::string> ValidTypes = { "mapentities", "entityDef", "logicFX", "logicLibrary", "logicClass", "logicUIWidget", "logicEntity" };
-	const std::vector<std::string> archiveList = PackageMapSpec::GetPrioritizedArchiveList(gamedir, false);
+	// mapentities, entityDef and every logic decl type
+	const uint32_t ValidTypes = rtc_serialized;
 	
+	ResourceVFS vfs;
+	if (!vfs.Build(gamedir)) {
+		atlog << "FATAL ERROR: Could not read container.mask or build the resource catalog\n";
+		return false;
+	}
+	const ResourceCatalog& catalog = vfs.Catalog();
+
 	deserial::declHashMap.reserve(15000);
 	deserial::entityclassmap.reserve(5000);
 
 	// For entitydef data
-	size_t rawsize = 24000;
-	size_t decompsize = 24000;
-	char* raw = new char[rawsize];
-	char* decomp = new char [decompsize];
+	ResourceBatchDecompressor decompressor;
+	std::vector<uint32_t> batchentries;
+	std::vector<entityclass_t*> batchclassdefs;
 
+	for (uint32_t archiveindex = 0; archiveindex < catalog.ArchiveCount(); archiveindex++) {
+		const ResourceCatalog::archive_t& a = catalog.Archive(archiveindex);
 
-	for (const std::string& archivename : archiveList) {
-		ResourceArchive r;
-		Read_ResourceArchive(r, basepath / archivename, RF_SkipData);
-		std::ifstream archivestream(basepath / archivename, std::ios_base::binary);
-
-		for (uint32_t i = 0; i < r.header.numResources; i++) {
-			const ResourceEntry& e = r.entries[i];
+		batchentries.clear();
+		batchclassdefs.clear();
 
-			const char* typestring, *namestring;
-			Get_EntryStrings(r, e, typestring, namestring);
+		for (uint32_t i = a.firstEntry; i < a.firstEntry + a.numEntries; i++) {
+			const ResourceCatalog::entry_t& e = catalog.Entry(i);
+			const char* namestring = catalog.String(e.nameString);
 
-			if(ValidTypes.count(typestring) == 0)
+			if((e.resourceType & ValidTypes) == 0)
 				continue;
 			
 			/* The dependency list gives us a complete hashmap for resource paths */
+			const uint64_t* dephashes = catalog.EntryDependencies(e);
 			for (uint32_t k = 0; k < e.numDependencies; k++) {
-				uint32_t depindex = r.dependencyIndex[e.depIndices + k];
-				const ResourceDependency& d = r.dependencies[depindex];
+				const ResourceCatalog::dependency_t* d = catalog.FindDependency(dephashes[k]);
 
-				const char* deptypestring = r.stringChunk.dataBlock + r.stringChunk.offsets[d.type];
-				const char* depnamestring = r.stringChunk.dataBlock + r.stringChunk.offsets[d.name];
-
-				uint64_t depfarmhash = HashLib::DeclHash(deptypestring, depnamestring);
-				std::string hashString = deptypestring;
+				uint64_t depfarmhash = d->hash;
+				std::string hashString = catalog.String(d->typeString);
 				hashString.push_back('/');
-				hashString.append(depnamestring);
+				hashString.append(catalog.String(d->nameString));
 
 				const auto& iter = deserial::declHashMap.find(depfarmhash);
 				assert(iter == deserial::declHashMap.end() || iter->second == hashString);
 				deserial::declHashMap.emplace(depfarmhash, hashString);
 			}
 
-			/* If this is an entitydef, put it's data into the entity class map */
-			if (strcmp(typestring, "entityDef") == 0) {
-				uint64_t farmhash = HashLib::DeclHash(typestring, namestring);
+			/* If this is an entitydef, queue it's data for the entity class map */
+			if (e.resourceType == rt_entityDef) {
+				uint64_t farmhash = e.declHash;
 
-				// Don't allow older file versions to have priority in the class map
-				{
-					const auto& iter = deserial::entityclassmap.find(farmhash);
-					if(iter != deserial::entityclassmap.end())
-						continue;
-				}
+				// Only the copy the game loads goes in the class map
+				if(!vfs.IsResolved(i))
+					continue;
 
-				entityclass_t classdef;
+				const auto& tryresult = deserial::entityclassmap.try_emplace(farmhash);
+				if(!tryresult.second)
+					continue;
 
+				entityclass_t& classdef = tryresult.first->second;
+				// The binary may be absent if an earlier run deserialized it and nothing changed since
 				classdef.filepath = (entitydir / namestring).replace_extension(".bin").string();
-				assert(std::filesystem::exists(classdef.filepath));
-
-				const ResourceEntryData_t entrydata = Get_EntryData(e, archivestream, raw, rawsize, decomp, decompsize);
-				assert(entrydata.returncode == EntryDataCode::OK);
-
-				/*
-				* Do a hacky read-through of the entitydef
-				* to extract the inheritance hash and class hash (if it exists)
-				*/
-				uint64_t temphash;
-				uint32_t length;
-
-				BinaryReader reader(entrydata.buffer, entrydata.length);
-				assert(reader.GoRight(5));              // Skip null byte and file length
-				assert(reader.ReadLE(classdef.parent)); // Read the inherit hash
-				assert(reader.GoRight(6)); // ExpandInheritance(?), 5 padding bytes
-				assert(reader.ReadLE(length)); // Length of editorVars block
-				assert(reader.GoRight(length)); // Skip editorVars block
-				assert(reader.GoRight(5));      // Skip padding
-				assert(reader.ReadLE(length)); // Read system variables block length
-
-
-				if (length > 0) {
-					assert(length > 14); // Ensure there's at least one property
-					assert(reader.GoRight(15)); // Edit block hash + sub-length of block + 0 byte code
-					assert(reader.ReadLE(temphash));
-
-					// Farmhash of "entityClass" - *should* always be first if it exists
-					// Todo: might be risky to assume it will always be first
-					if (temphash == 17091029760865742588UL) {
-						assert(reader.GoRight(5)); // Leaf node byte + Length
-						assert(reader.ReadLE(classdef.typehash));
-					}
-				}
-				deserial::entityclassmap.emplace(farmhash, classdef);
-				//std::cout << declpath << " " << classdef.typehash << "\n";
-				//if (classdef.typehash == 0)
-				//	std::cout << "MISSING\n";
+				classdef.archivepath = catalog.ArchivePath(a).string();
+				classdef.entryindex = e.entryIndex;
+
+				// Map nodes are never relocated, so these pointers survive further insertions
+				batchentries.push_back(e.entryIndex);
+				batchclassdefs.push_back(&classdef);
 			}
 		}
-	}
 
-	delete[] raw;
-	delete[] decomp;
+		// Only archives containing new entitydefs need to be opened
+		if(batchentries.empty())
+			continue;
+
+		ResourceArchive r;
+		if (!Read_ResourceArchive(r, catalog.ArchivePath(a), RF_MapFile)) {
+			atlog << "FATAL ERROR: Could not read archive " << catalog.ArchivePath(a) << "\n";
+			return false;
+		}
+
+		// Each classdef is written by exactly one worker
+		decompressor.Run(r, batchentries, [&](const ResourceBatchItem_t& item) {
+			const ResourceEntryData_t& entrydata = item.data;
+			assert(entrydata.returncode == EntryDataCode::OK);
+			entityclass_t& classdef = *batchclassdefs[item.batchindex];
+
+			/*
+			* Do a hacky read-through of the entitydef
+			* to extract the inheritance hash and class hash (if it exists)
+			*/
+			uint64_t temphash;
+			uint32_t length;
+
+			BinaryReader reader(entrydata.buffer, entrydata.length);
+			assert(reader.GoRight(5));              // Skip null byte and file length
+			assert(reader.ReadLE(classdef.parent)); // Read the inherit hash
+			assert(reader.GoRight(6)); // ExpandInheritance(?), 5 padding bytes
+			assert(reader.ReadLE(length)); // Length of editorVars block
+			assert(reader.GoRight(length)); // Skip editorVars block
+			assert(reader.GoRight(5));      // Skip padding
+			assert(reader.ReadLE(length)); // Read system variables block length
+
+
+			if (length > 0) {
+				assert(length > 14); // Ensure there's at least one property
+				assert(reader.GoRight(15)); // Edit block hash + sub-length of block + 0 byte code
+				assert(reader.ReadLE(temphash));
+
+				// Farmhash of "entityClass" - *should* always be first if it exists
+				// Todo: might be risky to assume it will always be first
+				if (temphash == 17091029760865742588UL) {
+					assert(reader.GoRight(5)); // Leaf node byte + Length
+					assert(reader.ReadLE(classdef.typehash));
+				}
+			}
+		}, false);
+	}
 
 	/*
 	* STEP 2: Populate inherited typehash information
@@ -171,6 +187,7 @@ void Deserializer::DeserialInit(const fspath& gamedir, const fspath& filedir, bo
 	}
 
 	atlog << "Decl Hash Map Size: " << deserial::declHashMap.size() << "\n";
+	return true;
 }
 
 void AddIndentation(const std::string& path) {
@@ -184,14 +201,122 @@ void AddIndentation(const std::string& path) {
 	}
 }
 
-void DeserializeEntitydefs(bool remove_binaries, bool add_indent) {
+/*
+* Decompresses entitydefs from the game's archives into the given map's values.
+* Used for unchanged entitydefs, whose binaries may have been removed after they were deserialized
+*/
+bool ReadEntitydefBinaries(std::unordered_map<uint64_t, std::string>& binaries) {
+	std::unordered_map<std::string, std::vector<uint64_t>> archivemap;
+	for (const auto& pair : binaries)
+		archivemap[deserial::entityclassmap[pair.first].archivepath].push_back(pair.first);
+
+	ResourceBatchDecompressor decompressor;
+	std::vector<uint32_t> batchentries;
+	std::vector<std::string*> batchbinaries;
+	for (const auto& archive : archivemap) {
+		ResourceArchive r;
+		if (!Read_ResourceArchive(r, archive.first, RF_MapFile)) {
+			atlog << "ERROR: Could not read archive " << archive.first << "\n";
+			return false;
+		}
+
+		batchentries.clear();
+		batchbinaries.clear();
+		for (uint64_t hash : archive.second) {
+			batchentries.push_back(deserial::entityclassmap[hash].entryindex);
+			batchbinaries.push_back(&binaries[hash]);
+		}
+
+		bool okay = true;
+		decompressor.Run(r, batchentries, [&](const ResourceBatchItem_t& item) {
+			if(item.data.returncode == EntryDataCode::OK)
+				batchbinaries[item.batchindex]->assign(item.data.buffer, item.data.length);
+			else okay = false;
+		}, true);
+
+		if (!okay) {
+			atlog << "ERROR: Could not decompress entitydefs from " << archive.first << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+void DeserializeEntitydefs(bool remove_binaries, bool add_indent, ExtractionManifest* manifest) {
 	deserial::deserialmode = DeserialMode::entitydef;
 	deserial::warning_count = 0;
 
 	std::string writeto;
 	writeto.reserve(500000);
 
-	int totaldeserialized = 0;
+	// Entitydefs that are unchanged since they were last deserialized still count
+	// as deserialized parents, so their children can proceed
+	int totaldeserialized = 0, totalskipped = 0;
+	std::unordered_map<uint64_t, std::string> historybinaries;
+	if (manifest) {
+		for (auto& entitydef : deserial::entityclassmap) {
+			if (manifest->IsDeserialized(entitydef.second.filepath)) {
+				entitydef.second.deserialized = true;
+				totaldeserialized++;
+				totalskipped++;
+			}
+		}
+
+		/*
+		* Children may inherit their className, which is resolved through the typeinfo history
+		* of their ancestors. So an unchanged entitydef with a changed ancestor is deserialized
+		* again, and unchanged ancestors of a changed entitydef are read to rebuild that history
+		* without writing anything. Binaries of both may have been removed, so they're read from the archives
+		*/
+		std::vector<uint64_t> redo;
+		for (const auto& entitydef : deserial::entityclassmap) {
+			if(!entitydef.second.deserialized)
+				continue;
+
+			auto parententity = deserial::entityclassmap.find(entitydef.second.parent);
+			while (parententity != deserial::entityclassmap.end() && parententity->second.deserialized)
+				parententity = deserial::entityclassmap.find(parententity->second.parent);
+			if(parententity != deserial::entityclassmap.end())
+				redo.push_back(entitydef.first);
+		}
+		for (uint64_t hash : redo) {
+			deserial::entityclassmap[hash].deserialized = false;
+			totaldeserialized--;
+			totalskipped--;
+		}
+
+		for (const auto& entitydef : deserial::entityclassmap) {
+			if(entitydef.second.deserialized)
+				continue;
+
+			auto parententity = deserial::entityclassmap.find(entitydef.second.parent);
+			while (parententity != deserial::entityclassmap.end() && parententity->second.deserialized) {
+				if(!historybinaries.try_emplace(parententity->first).second)
+					break; // It's ancestors were added with it
+				parententity = deserial::entityclassmap.find(parententity->second.parent);
+			}
+		}
+
+		for (const auto& pair : historybinaries) {
+			deserial::entityclassmap[pair.first].deserialized = false;
+			totaldeserialized--;
+		}
+
+		for(uint64_t hash : redo)
+			historybinaries.try_emplace(hash);
+		if (!ReadEntitydefBinaries(historybinaries)) {
+			atlog << "Aborting entitydef extraction\n";
+			return;
+		}
+
+		// Entitydefs being deserialized again get their binary back, and are then handled like any other
+		for (uint64_t hash : redo) {
+			std::ofstream binarywriter(deserial::entityclassmap[hash].filepath, std::ios_base::binary);
+			binarywriter << historybinaries[hash];
+			historybinaries.erase(hash);
+		}
+	}
+
 	while (totaldeserialized < deserial::entityclassmap.size()) {
 
 		for (auto& entitydef : deserial::entityclassmap) {
@@ -210,6 +335,17 @@ void DeserializeEntitydefs(bool remove_binaries, bool add_indent) {
 			writeto.clear();
 			int previousWarningCount = deserial::warning_count;
 
+			// Unchanged entitydefs only rebuild their history. Their warnings were reported when they were first deserialized
+			const auto historyiter = historybinaries.find(entitydef.first);
+			if (historyiter != historybinaries.end()) {
+				BinaryReader reader(historyiter->second.data(), historyiter->second.size());
+				deserial::ds_start_entitydef(reader, writeto, entitydef.first);
+				deserial::warning_count = previousWarningCount;
+				totaldeserialized++;
+				entitydef.second.deserialized = true;
+				continue;
+			}
+
 			BinaryOpener opener = BinaryOpener(entitydef.second.filepath);
 			if (!opener.Okay()) {
 				atlog << "ERROR: Failed to read entitydef " << entitydef.second.filepath
@@ -232,6 +368,9 @@ void DeserializeEntitydefs(bool remove_binaries, bool add_indent) {
 			output << writeto;
 			output.close();
 
+			if(manifest)
+				manifest->SetDeserialized(entitydef.second.filepath, outpath);
+
 			if (remove_binaries) {
 				std::filesystem::remove(entitydef.second.filepath);
 			}
@@ -241,10 +380,11 @@ void DeserializeEntitydefs(bool remove_binaries, bool add_indent) {
 			}
 		}
 	}
-	atlog << "EntityDef Warning Count: " << deserial::warning_count << " Files: " << totaldeserialized << "\n";
+	atlog << "EntityDef Warning Count: " << deserial::warning_count << " Files: " << totaldeserialized - totalskipped
+		<< " Unchanged: " << totalskipped << "\n";
 }
 
-void DeserializeMapEntities(const fspath filedir, bool remove_binaries, bool add_indent) {
+void DeserializeMapEntities(const fspath filedir, bool remove_binaries, bool add_indent, ExtractionManifest* manifest) {
 	deserial::deserialmode = DeserialMode::mapentities;
 	deserial::warning_count = 0;
 
@@ -262,6 +402,8 @@ void DeserializeMapEntities(const fspath filedir, bool remove_binaries, bool add
 			continue;
 
 		if (entry.path().extension() == ".bin") {
+			if(manifest && manifest->IsDeserialized(entry.path()))
+				continue;
 			binpaths.push_back(entry.path());
 		}
 	}
@@ -285,6 +427,9 @@ void DeserializeMapEntities(const fspath filedir, bool remove_binaries, bool add
 		outfile << outtext;
 		outfile.close();
 
+		if(manifest)
+			manifest->SetDeserialized(file, outpath);
+
 		if (remove_binaries) {
 			std::filesystem::remove(file);
 		}
@@ -297,7 +442,7 @@ void DeserializeMapEntities(const fspath filedir, bool remove_binaries, bool add
 	atlog << "Map Entities Warning Count: " << deserial::warning_count << " Files: " << binpaths.size() << "\n";
 }
 
-void DeserializeLogicdecls(const fspath filedir, bool remove_binaries, bool add_indent) {
+void DeserializeLogicdecls(const fspath filedir, bool remove_binaries, bool add_indent, ExtractionManifest* manifest) {
 	deserial::deserialmode = DeserialMode::logic;
 
 	struct logicfolder_t {
@@ -332,6 +477,8 @@ void DeserializeLogicdecls(const fspath filedir, bool remove_binaries, bool add_
 				continue;
 
 			if (entry.path().extension() == ".bin") {
+				if(manifest && manifest->IsDeserialized(entry.path()))
+					continue;
 				binpaths.push_back(entry.path());
 			}
 		}
@@ -360,6 +507,9 @@ void DeserializeLogicdecls(const fspath filedir, bool remove_binaries, bool add_
 			outwriter << outputText;
 			outwriter.close();
 
+			if(manifest)
+				manifest->SetDeserialized(filepath, outpath);
+
 			if (remove_binaries) {
 				std::filesystem::remove(filepath);
 			}
@@ -388,11 +538,12 @@ void Deserializer::DeserialSingle(BinaryReader& reader, std::string& writeto, Re
 
 void Deserializer::DeserialMain(const fspath& gamedir, const fspath& filedir, deserialconfig_t config)
 {
-	DeserialInit(gamedir, filedir, config.include_original);
+	if(!DeserialInit(gamedir, filedir, config.include_original))
+		return;
 
 	if (config.deserial_entitydefs) {
 		atlog << "Deserializing EntityDefs\n";
-		DeserializeEntitydefs(config.remove_binaries, config.indent);
+		DeserializeEntitydefs(config.remove_binaries, config.indent, config.manifest);
 		atlog << "Finished EntityDefs\n";
 	}
 	else {
@@ -402,7 +553,7 @@ void Deserializer::DeserialMain(const fspath& gamedir, const fspath& filedir, de
 
 	if (config.deserial_logicdecls) {
 		atlog << "Deserializing Logic Decls\n";
-		DeserializeLogicdecls(filedir, config.remove_binaries, config.indent);
+		DeserializeLogicdecls(filedir, config.remove_binaries, config.indent, config.manifest);
 		atlog << "Finished Logic Decls\n";
 	}
 	else {
@@ -412,7 +563,7 @@ void Deserializer::DeserialMain(const fspath& gamedir, const fspath& filedir, de
 
 	if (config.deserial_mapentities) {
 		atlog << "Deserializing Map Entities\n";
-		DeserializeMapEntities(filedir, config.remove_binaries, config.indent);
+		DeserializeMapEntities(filedir, config.remove_binaries, config.indent, config.manifest);
 		atlog << "Finished Map Entities\n";
 	}
 	else {
@@ -3,6 +3,7 @@
 
 enum ResourceType : unsigned;
 class BinaryReader;
+class ExtractionManifest;
 typedef std::filesystem::path fspath;
 
 struct deserialconfig_t
@@ -13,13 +14,18 @@ struct deserialconfig_t
 	bool remove_binaries = true;
 	bool include_original = false;
 	bool indent = true;
+
+	// If set, files the manifest records as already deserialized are skipped,
+	// and newly deserialized files are recorded in it. The caller saves it
+	ExtractionManifest* manifest = nullptr;
 };
 
 namespace Deserializer
 {
 	// Will be called by DeserialMain automatically
 	// This is here for using the Deserializer independently of DeserialMain
-	void DeserialInit(const fspath& gamedir, const fspath& filedir, bool p_include_originals);
+	// Returns false if the game's resources could not be read
+	bool DeserialInit(const fspath& gamedir, const fspath& filedir, bool p_include_originals);
 
 	void DeserialSingle(BinaryReader& reader, std::string& writeto, ResourceType restype);
 
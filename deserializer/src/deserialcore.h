@@ -25,6 +25,8 @@ struct deserialTypeInfo {
 
 struct entityclass_t {
 	std::string filepath;
+	std::string archivepath; // Game archive the entitydef is read from
+	uint32_t entryindex = 0; // Index of the entitydef within that archive
 	uint64_t parent = 0;
 	uint32_t typehash = 0;
 	bool deserialized = false;
@@ -131,7 +131,7 @@ struct inheritanceFlags {
 class idlibCleaner2 
 {
 	private:
-	EntityParser parser = EntityParser("idlibcleaned_pass1.txt", ParsingMode::PERMISSIVE);
+	EntityParser parser = EntityParser("idlibcleaned_pass1.txt", ParsingMode::PERMISSIVE, false, true);
 	std::unordered_map<std::string, TypeMap> typelib;
 
 	public:
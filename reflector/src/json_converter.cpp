@@ -245,7 +245,7 @@ void idlibCleaning::JsonToHeader()
 	std::string writeto;
 	writeto.reserve(15000000);
 
-	EntityParser parser("idlib.json", ParsingMode::JSON);
+	EntityParser parser("idlib.json", ParsingMode::JSON, false, true);
 	entnode& root = *parser.getRoot();
 	assert(root.getChildCount() == 1);
 
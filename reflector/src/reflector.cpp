@@ -492,7 +492,7 @@ class idlibReflector {
 void idlibReflection::Generate() {
 
     printf("Engaging idlib Reflector shields\n");
-    EntityParser parser = EntityParser("idlibcleaned.txt", ParsingMode::PERMISSIVE);
+    EntityParser parser = EntityParser("idlibcleaned.txt", ParsingMode::PERMISSIVE, false, true);
     EntNode* root = parser.getRoot();
 
     
@@ -1,6 +1,7 @@
 #include "serialcore.h"
 #include <string_view>
 #include <chrono>
+#include <fstream>
 #include "io/BinaryWriter.h"
 #include "entityslayer/EntityParser.h"
 #include "archives/ResourceEnums.h"
@@ -33,10 +34,77 @@ int Reserializer::Serialize(const EntNode& root, BinaryWriter& writer, ResourceT
 	return reserial::warningcount;
 }
 
+int Reserializer::Serialize(EntityParser& parser, BinaryWriter& writer, ResourceType restype)
+{
+	const EntNode& root = *parser.getRoot();
+	if (restype != rt_mapentities)
+		return Serialize(root, writer, restype, parser.eofblob, parser.eofbloblength);
+
+	reserial::warningcount = 0;
+	reserial::rs_mapentitystream stream;
+	BinaryWriter entitywriter(100000);
+
+	for (int i = 0, max = root.getChildCount(); i < max; i++) {
+		const EntNode& node = root[i];
+		if (node.getName() != "entity") {
+			stream.Block(node);
+			continue;
+		}
+
+		// Warnings are stored with the binary, so cached entities report the same count
+		EntityParser::EntityCache& cache = parser.GetEntityCache(node);
+		if (!cache.hasBinary) {
+			int warnings = reserial::warningcount;
+			entitywriter.Empty();
+			cache.binaryInfo = reserial::rs_mapentity(node, entitywriter);
+			cache.binary.assign(entitywriter.GetBuffer(), entitywriter.GetFilledSize());
+			cache.binaryWarnings = reserial::warningcount - warnings;
+			cache.hasBinary = true;
+		}
+		else reserial::warningcount += cache.binaryWarnings;
+
+		stream.Entity(node, cache.binary.data(), cache.binary.length(), static_cast<uint16_t>(cache.binaryInfo));
+	}
+
+	stream.Finish(writer);
+	return reserial::warningcount;
+}
+
+/*
+* Mapentities are serialized as they're parsed, one top-level node at a time,
+* so the whole file's node tree is never built. Returns false if the text can't be parsed
+*/
+bool SerializeMapentities(std::string_view text, BinaryWriter& writer, std::string& error)
+{
+	reserial::warningcount = 0;
+	reserial::rs_mapentitystream stream;
+
+	EntityParser parser(ParsingMode::PERMISSIVE);
+	ParseResult result = parser.ParseBlocks(text, [&stream](const EntNode& node) {
+		stream.Block(node);
+	});
+	if (!result.success) {
+		error = result.errorMessage;
+		return false;
+	}
+
+	stream.Finish(writer);
+	return true;
+}
+
 int Reserializer::Serialize(const char* data, size_t length, BinaryWriter& writer, ResourceType restype)
 {
 	try {
-		EntityParser parser(ParsingMode::PERMISSIVE, std::string_view(data, length), false);
+		if (restype == rt_mapentities) {
+			std::string error;
+			if (!SerializeMapentities(std::string_view(data, length), writer, error)) {
+				atlog << "ERROR: Failed to read data stream into EntityParser\nMessage: " << error;
+				return 1;
+			}
+			return reserial::warningcount;
+		}
+
+		EntityParser parser(ParsingMode::PERMISSIVE, std::string_view(data, length), false, true);
 		return Serialize(*parser.getRoot(), writer, restype, parser.eofblob, parser.eofbloblength);
 	}
 	catch (std::exception e) {
@@ -48,7 +116,28 @@ int Reserializer::Serialize(const char* data, size_t length, BinaryWriter& write
 int Reserializer::Serialize(const char* filepath, BinaryWriter& writer, ResourceType restype)
 {
 	try {
-		EntityParser parser(std::string(filepath), ParsingMode::PERMISSIVE);
+		if (restype == rt_mapentities) {
+			size_t length = 0;
+			bool compressed = false;
+			std::unique_ptr<char[]> text = EntityParser::ReadText(std::string(filepath), length, compressed);
+
+			std::string error;
+			if (!SerializeMapentities(std::string_view(text.get(), length), writer, error)) {
+				atlog << "ERROR: Failed to read file into EntityParser\nMessage: " << error;
+
+				// Matches EntityParser, which decompresses files it fails to parse
+				if (compressed) {
+					atlog << "Decompressing " << filepath << " so you can find and fix errors.\n";
+					std::ofstream decompressor(filepath, std::ios_base::binary);
+					decompressor.write(text.get(), length);
+					decompressor.close();
+				}
+				return 1;
+			}
+			return reserial::warningcount;
+		}
+
+		EntityParser parser(std::string(filepath), ParsingMode::PERMISSIVE, false, true);
 		return Serialize(*parser.getRoot(), writer, restype, parser.eofblob, parser.eofbloblength);
 	}
 	catch (std::exception e) {
@@ -3,6 +3,7 @@
 enum ResourceType : unsigned;
 class BinaryWriter;
 class EntNode;
+class EntityParser;
 
 namespace Reserializer
 {
@@ -10,6 +11,11 @@ namespace Reserializer
 	// A return value of 0 means no warnings
 	int Serialize(const EntNode& root, BinaryWriter& writer, ResourceType restype, const char* eofblob, size_t eofbloblength);
 
+	// Returns the number of warnings thrown when reserializing the file
+	// A return value of 0 means no warnings
+	// Mapentities reuse the binary cached in the parser for every entity that hasn't been edited
+	int Serialize(EntityParser& parser, BinaryWriter& writer, ResourceType restype);
+
 	// Returns the number of warnings thrown when reserializing the file
 	// A return value of 0 means no warnings
 	int Serialize(const char* data, size_t length, BinaryWriter& writer, ResourceType restype);
@@ -197,6 +197,107 @@ void rs_submap(const std::vector<EntNode*> entities, BinaryWriter& layermask, Bi
 
 }
 
+// Decodes the header chunk's text back into the binary header. Returns false if it's malformed
+bool rs_headerchunk(const EntNode& headerchunk, BinaryWriter& entities)
+{
+	for(int childindex = 0; childindex < headerchunk.getChildCount(); childindex++) 
+	{
+		const EntNode& headerline = headerchunk[childindex];
+		if (headerline.NameLength() % 2) {
+			reserial::LogWarning("[FATAL]: headerchunk malformed");
+			return false;
+		}
+
+		const uint8_t* lineptr = reinterpret_cast<const uint8_t*>(headerline.NamePtr());
+		const uint8_t* linemax = lineptr + headerline.NameLength();
+		while(lineptr < linemax) {
+				
+			uint8_t lower = *lineptr - static_cast<uint8_t>('a');
+			uint8_t upper = *(lineptr + 1) - static_cast<uint8_t>('a');
+
+			uint8_t value = (upper << 4) + lower;
+			entities << value;
+
+			lineptr += 2;
+		}
+	}
+	return true;
+}
+
+// Writes the start of a submap's entity list, up to and including the entity count
+void rs_entitylistheader(BinaryWriter& entities, uint32_t entitycount)
+{
+	entities << static_cast<uint32_t>(0x0A) << static_cast<uint8_t>(1) << static_cast<uint32_t>(0);
+
+	// Metadata is left empty (see Step 2 of rs_start_mapentity)
+	entities << static_cast<uint32_t>(0);
+
+	entities << static_cast<uint32_t>(0);
+	entities << entitycount;
+}
+
+// Writes an entity of a submap's entity list, returning it's entry in the layer index mask
+uint16_t reserial::rs_mapentity(const EntNode& e, BinaryWriter& entities)
+{
+	uint16_t layermask = 0;
+
+	// Write the layer information, if it exists
+	{
+		uint16_t layerindex = 0;
+		const EntNode& layerindnode = e["layerIndex"];
+		if (ParseWholeNumber(layerindnode.ValuePtr(), layerindnode.ValueLength(), layerindex)) {
+			std::string_view layerstring = e["layers"][0].getNameUQ();
+					
+			layermask = layerindex;
+			entities << static_cast<uint32_t>(1) << static_cast<uint32_t>(layerstring.length());
+			entities.WriteBytes(layerstring.data(), layerstring.length());
+		}
+		else {
+			entities << static_cast<uint32_t>(0);
+		}
+	}
+
+	// Write the instance id information, if it exists
+	{
+		const EntNode& instidnode = e["instanceId"];
+		uint32_t instanceid = 0;
+		if (ParseWholeNumber(instidnode.ValuePtr(), instidnode.ValueLength(), instanceid)) {
+			std::string_view originalname = e["originalName"].getValueUQ();
+
+			entities << instanceid << static_cast<uint32_t>(originalname.length());
+			entities.WriteBytes(originalname.data(), originalname.length());
+		}
+		else {
+			entities << static_cast<uint32_t>(0);
+		}
+	}
+
+	const EntNode& defnode = e["entityDef"];
+	std::string_view defname = defnode.getValue();
+	entities << static_cast<uint32_t>(defname.length());
+	entities.WriteBytes(defname.data(), defname.length());
+
+	entities.pushSizeStack();
+	reserial::rs_start_entitydef(defnode, entities);
+	entities.popSizeStack();
+
+	return layermask;
+}
+
+// Inserts the new entity counts + submap chunk lengths into the header chunk
+void rs_patchheader(BinaryWriter& entities, int32_t submapcount, const uint32_t* entitycounts, const uint32_t* newlengths)
+{
+	uint32_t* headerchunk = reinterpret_cast<uint32_t*>(entities.GetEditableBuffer());
+	headerchunk += 2; // Align to entity count of first submap
+
+	for (int i = 0; i < submapcount; i++) {
+		*headerchunk = entitycounts[i];
+		headerchunk += 4;
+		*headerchunk = newlengths[i];
+		headerchunk += 4;
+	}
+}
+
 void reserial::rs_start_mapentity(const EntNode& root, BinaryWriter& entities, const char* eofblob, size_t eofbloblength)
 {
 	// New approach: Parse the eof blob
@@ -208,27 +309,8 @@ void reserial::rs_start_mapentity(const EntNode& root, BinaryWriter& entities, c
 			return;
 		}
 
-		for(int childindex = 0; childindex < headerchunk.getChildCount(); childindex++) 
-		{
-			const EntNode& headerline = headerchunk[childindex];
-			if (headerline.NameLength() % 2) {
-				LogWarning("[FATAL]: headerchunk malformed");
-				return;
-			}
-
-			const uint8_t* lineptr = reinterpret_cast<const uint8_t*>(headerline.NamePtr());
-			const uint8_t* linemax = lineptr + headerline.NameLength();
-			while(lineptr < linemax) {
-				
-				uint8_t lower = *lineptr - static_cast<uint8_t>('a');
-				uint8_t upper = *(lineptr + 1) - static_cast<uint8_t>('a');
-
-				uint8_t value = (upper << 4) + lower;
-				entities << value;
-
-				lineptr += 2;
-			}
-		}
+		if(!rs_headerchunk(headerchunk, entities))
+			return;
 	}
 	#else
 
@@ -244,6 +326,7 @@ void reserial::rs_start_mapentity(const EntNode& root, BinaryWriter& entities, c
 	*/
 	int32_t submapcount = *reinterpret_cast<const int32_t*>(entities.GetBuffer());
 	std::vector<std::vector<const EntNode*>> submapnodes;
+	std::vector<uint32_t> entitycounts;
 	std::vector<uint32_t> newlengths;
 	
 	{
@@ -297,16 +380,7 @@ void reserial::rs_start_mapentity(const EntNode& root, BinaryWriter& entities, c
 		entities.AddBytes(submapnodes[i].size() * sizeof(short)); // Reserve bytes for the layer index mask
 		size_t entitylist_position = entities.GetPosition();
 
-		entities << static_cast<uint32_t>(0x0A) << static_cast<uint8_t>(1) << static_cast<uint32_t>(0);
-
-		#if 0
-		entities.WriteBytes(metawriter.GetBuffer(), metawriter.GetFilledSize());
-		#else
-		entities << static_cast<uint32_t>(0);
-		#endif
-
-		entities << static_cast<uint32_t>(0);
-		entities << static_cast<uint32_t>(submapnodes[i].size()); // Entity count
+		rs_entitylistheader(entities, static_cast<uint32_t>(submapnodes[i].size()));
 
 		const EntNode** nodebuffer = submapnodes[i].data();
 		const EntNode** nodemax = nodebuffer + submapnodes[i].size();
@@ -323,71 +397,113 @@ void reserial::rs_start_mapentity(const EntNode& root, BinaryWriter& entities, c
 			const EntNode& e = **nodebuffer;
 			nodebuffer++;
 
-			// Write the layer information, if it exists
-			{
-				uint16_t layerindex = 0;
-				const EntNode& layerindnode = e["layerIndex"];
-				if (ParseWholeNumber(layerindnode.ValuePtr(), layerindnode.ValueLength(), layerindex)) {
-					std::string_view layerstring = e["layers"][0].getNameUQ();
-					
-					*reinterpret_cast<uint16_t*>(entities.GetEditableBuffer() + layermask_position) = layerindex;
-					entities << static_cast<uint32_t>(1) << static_cast<uint32_t>(layerstring.length());
-					entities.WriteBytes(layerstring.data(), layerstring.length());
-				}
-				else {
-					*reinterpret_cast<uint16_t*>(entities.GetEditableBuffer() + layermask_position) = static_cast<uint16_t>(0);
-					entities << static_cast<uint32_t>(0);
-				}
-				layermask_position += sizeof(uint16_t);
-			}
-
-			// Write the instance id information, if it exists
-			
-			{
-				const EntNode& instidnode = e["instanceId"];
-				uint32_t instanceid = 0;
-				if (ParseWholeNumber(instidnode.ValuePtr(), instidnode.ValueLength(), instanceid)) {
-					std::string_view originalname = e["originalName"].getValueUQ();
-
-					entities << instanceid << static_cast<uint32_t>(originalname.length());
-					entities.WriteBytes(originalname.data(), originalname.length());
-				}
-				else {
-					entities << static_cast<uint32_t>(0);
-				}
-			}
-
-			const EntNode& defnode = e["entityDef"];
-			std::string_view defname = defnode.getValue();
-			entities << static_cast<uint32_t>(defname.length());
-			entities.WriteBytes(defname.data(), defname.length());
-
-			entities.pushSizeStack();
-			rs_start_entitydef(defnode, entities);
-			entities.popSizeStack();
+			uint16_t layerindex = rs_mapentity(e, entities);
+			*reinterpret_cast<uint16_t*>(entities.GetEditableBuffer() + layermask_position) = layerindex;
+			layermask_position += sizeof(uint16_t);
 		}
 
 
 		entities << static_cast<uint32_t>(0); // Final 4 null bytes of the file
 
 		// Length does NOT include the layer mask
+		entitycounts.push_back(static_cast<uint32_t>(submapnodes[i].size()));
 		newlengths.push_back(static_cast<uint32_t>(entities.GetPosition() - entitylist_position));
 	}
 
 	/*
 	* FINAL STEP: Edit the header chunk to insert the new entity counts + submap chunk lengths
 	*/
-	uint32_t* headerchunk = reinterpret_cast<uint32_t*>(entities.GetEditableBuffer());
-	headerchunk += 2; // Align to entity count of first submap
+	rs_patchheader(entities, submapcount, entitycounts.data(), newlengths.data());
+}
 
-	for (int i = 0; i < submapcount; i++) {
-		*headerchunk = submapnodes[i].size();
-		headerchunk += 4;
-		*headerchunk = newlengths[i];
-		headerchunk += 4;
+void reserial::rs_mapentitystream::Block(const EntNode& node)
+{
+	std::string_view name = node.getName();
+	headerlast = false;
+
+	if (name == "entity") {
+		submap_t* submap = EntitySubmap(node);
+		if(submap != nullptr)
+			submap->layermask.push_back(rs_mapentity(node, submap->entities));
+	}
+	else if (name == "headerchunk") {
+		header.Empty();
+		headervalid = rs_headerchunk(node, header);
+		headerlast = true;
 	}
 }
 
+void reserial::rs_mapentitystream::Entity(const EntNode& node, const char* data, size_t length, uint16_t layermask)
+{
+	headerlast = false;
+	submap_t* submap = EntitySubmap(node);
+	if (submap != nullptr) {
+		submap->entities.WriteBytes(data, length);
+		submap->layermask.push_back(layermask);
+	}
+}
+
+reserial::rs_mapentitystream::submap_t* reserial::rs_mapentitystream::EntitySubmap(const EntNode& node)
+{
+	int submapindex = -999;
+	node.ValueInt(submapindex, -999, 999);
+	if (submapindex < 0) {
+		LogWarning("Submap index out of range. Skipping entity");
+		return nullptr;
+	}
+
+	while(submaps.size() <= static_cast<size_t>(submapindex))
+		submaps.emplace_back(new submap_t);
+	submap_t& submap = *submaps[submapindex];
+
+	// The entity count occupies the first 4 bytes of the world entity
+	// So we must skip writing those first 4 null bytes for the world entity
+	if(!submap.layermask.empty())
+		submap.entities << static_cast<uint32_t>(0);
+	return &submap;
+}
+
+void reserial::rs_mapentitystream::Finish(BinaryWriter& entities)
+{
+	if (!headerlast) {
+		LogWarning("[FATAL]: headerchunk node expected at end of file");
+		return;
+	}
+
+	entities.WriteBytes(header.GetBuffer(), header.GetFilledSize());
+	if(!headervalid)
+		return;
+
+	int32_t submapcount = *reinterpret_cast<const int32_t*>(entities.GetBuffer());
+	for (size_t i = submapcount < 0 ? 0 : submapcount; i < submaps.size(); i++) {
+		for(size_t n = 0; n < submaps[i]->layermask.size(); n++)
+			LogWarning("Submap index out of range. Skipping entity");
+	}
+
+	while(submaps.size() < static_cast<size_t>(submapcount))
+		submaps.emplace_back(new submap_t);
+
+	std::vector<uint32_t> entitycounts;
+	std::vector<uint32_t> newlengths;
+	for (int i = 0; i < submapcount; i++)
+	{
+		const submap_t& submap = *submaps[i];
+
+		entities.WriteBytes(reinterpret_cast<const char*>(submap.layermask.data()), submap.layermask.size() * sizeof(uint16_t));
+		size_t entitylist_position = entities.GetPosition();
+
+		rs_entitylistheader(entities, static_cast<uint32_t>(submap.layermask.size()));
+		entities.WriteBytes(submap.entities.GetBuffer(), submap.entities.GetFilledSize());
+		entities << static_cast<uint32_t>(0); // Final 4 null bytes of the file
+
+		// Length does NOT include the layer mask
+		entitycounts.push_back(static_cast<uint32_t>(submap.layermask.size()));
+		newlengths.push_back(static_cast<uint32_t>(entities.GetPosition() - entitylist_position));
+	}
+
+	rs_patchheader(entities, submapcount, entitycounts.data(), newlengths.data());
+}
+
 void reserial::rs_start_logicdecl(const EntNode& root, BinaryWriter& writer, ResourceType declclass)
 {
 	writer << static_cast<uint8_t>(0);
@@ -1,10 +1,12 @@
 #pragma once
 #include <unordered_map>
 #include <set>
+#include <vector>
+#include <memory>
+#include "io/BinaryWriter.h"
 
 enum ResourceType : unsigned;
 class EntNode;
-class BinaryWriter;
 struct reserializer;
 
 typedef void rsfunc_t(const EntNode&, BinaryWriter&);
@@ -37,6 +39,43 @@ namespace reserial {
 	void rs_start_mapentity(const EntNode& root, BinaryWriter& writer, const char* eofblob, size_t eofbloblength);
 	void rs_start_logicdecl(const EntNode& root, BinaryWriter& writer, ResourceType declclass);
 
+	// Writes one mapentities entity, returning it's layer index
+	uint16_t rs_mapentity(const EntNode& e, BinaryWriter& entities);
+
+	/*
+	* Reserializes a mapentities file one top-level node at a time, producing the same output
+	* as rs_start_mapentity without a tree of the whole file. Entities are serialized into their
+	* submap's buffer as soon as they're complete. Finish assembles the buffers behind the header
+	* chunk, which is expected to be the final node.
+	* 
+	* Since the submap count is only known from the header chunk, out of range submap
+	* indices are warned about by Finish, after their entities have been serialized. Warnings
+	* raised while serializing those entities are still counted, though their output is discarded
+	*/
+	class rs_mapentitystream {
+		private:
+		struct submap_t {
+			BinaryWriter entities;          // Entity list, without the list header
+			std::vector<uint16_t> layermask; // Layer index of each entity
+		};
+
+		std::vector<std::unique_ptr<submap_t>> submaps;
+		BinaryWriter header;
+		bool headervalid = false;
+		bool headerlast = false;
+
+		// Returns the submap an entity node belongs to, ready for the entity to be written
+		submap_t* EntitySubmap(const EntNode& node);
+
+		public:
+		void Block(const EntNode& node);
+
+		// In place of Block, adds an entity node that was serialized earlier by rs_mapentity
+		void Entity(const EntNode& node, const char* data, size_t length, uint16_t layermask);
+
+		void Finish(BinaryWriter& entities);
+	};
+
 	/* Pointers */
 	rsfunc_t rs_pointerbase;
 	rsfunc_t rs_pointerdeclinfo;
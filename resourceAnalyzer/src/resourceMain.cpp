@@ -5,6 +5,7 @@
 #include "entityslayer/Oodle.h"
 #include "archives/PackageMapSpec.h"
 #include "entityslayer/EntityParser.h"
+#include "entityslayer/CompactTree.h"
 #include <cassert>
 #include <filesystem>
 #include <fstream>
@@ -13,6 +14,7 @@
 #include <set>
 #include <thread>
 #include <chrono>
+#include <algorithm>
 
 #ifndef _DEBUG
 #undef assert
@@ -342,7 +344,7 @@ void Test_DumpPriorityManifest()
 				Get_EntryStrings(archive, e, typeString, nameString);
 				int nameLength = (int)strlen(nameString);
 				if(nameLength > maxNameLength){
-					if(strcmp(typeString, "image") == 0) {
+					if(archive.entryTypes[entryIndex] == rt_image) {
 						maxNameLength = nameLength;
 						longestName = nameString;
 					}
@@ -893,6 +895,193 @@ void compresstest()
 	outwriter.close();
 }
 
+// Both node layouts share these accessors, so the same pass runs on either
+template<typename Node>
+size_t WalkTree(const Node& node)
+{
+	size_t sum = node.NameLength() + node.ValueLength();
+	for(int i = 0, max = node.getChildCount(); i < max; i++)
+		sum += WalkTree(node[i]);
+	return sum;
+}
+
+template<typename Node>
+size_t LookupEntityClasses(const Node& root)
+{
+	size_t sum = 0;
+	for(int i = 0, max = root.getChildCount(); i < max; i++)
+		sum += root[i]["entityDef"]["class"].ValueLength();
+	return sum;
+}
+
+/*
+* Compares the EntNode tree against a CompactTree parsed from the same text, on a
+* real .entities file. Each pass runs several times and the fastest run is reported
+*/
+void Test_CompactTreeBenchmark(const fspath entitiesfile)
+{
+	typedef std::chrono::steady_clock clock;
+	auto milliseconds = [](clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	};
+	const int RUNS = 5;
+
+	size_t length = 0;
+	bool compressed = false;
+	std::unique_ptr<char[]> filetext = EntityParser::ReadText(entitiesfile.string(), length, compressed);
+	const std::string_view data(filetext.get(), length);
+
+	clock::time_point start = clock::now();
+	EntityParser parser(ParsingMode::PERMISSIVE, data, false);
+	std::cout << "EntityParser parse: " << milliseconds(start) << "ms\n";
+	const EntNode& root = *parser.getRoot();
+
+	start = clock::now();
+	CompactTree compact;
+	ParseResult result = compact.Parse(data);
+	if (!result.success) {
+		std::cout << "CompactTree parse failed on line " << result.errorLineNum << ": " << result.errorMessage << "\n";
+		return;
+	}
+	std::cout << "CompactTree parse: " << milliseconds(start) << "ms\n";
+
+	size_t nodes = compact.NodeCount();
+	size_t textLength = WalkTree(root);
+	std::cout << "Nodes: " << nodes << "\n";
+	std::cout << "EntNode memory (nodes + child pointers + text): " << nodes * (sizeof(EntNode) + sizeof(EntNode*)) + textLength << "\n";
+	std::cout << "CompactTree memory: " << compact.MemoryUsage() << "\n";
+
+	std::string entText, compactText;
+	double entTime[3] = {1e9, 1e9, 1e9}, compactTime[3] = {1e9, 1e9, 1e9};
+	size_t entSums[2] = {}, compactSums[2] = {};
+	for (int run = 0; run < RUNS; run++) {
+		entText.clear();
+		start = clock::now();
+		root.generateText(entText);
+		entTime[0] = std::min(entTime[0], milliseconds(start));
+
+		compactText.clear();
+		start = clock::now();
+		compact.Root().generateText(compactText);
+		compactTime[0] = std::min(compactTime[0], milliseconds(start));
+
+		start = clock::now();
+		entSums[0] = WalkTree(root);
+		entTime[1] = std::min(entTime[1], milliseconds(start));
+
+		start = clock::now();
+		compactSums[0] = WalkTree(compact.Root());
+		compactTime[1] = std::min(compactTime[1], milliseconds(start));
+
+		start = clock::now();
+		entSums[1] = LookupEntityClasses(root);
+		entTime[2] = std::min(entTime[2], milliseconds(start));
+
+		start = clock::now();
+		compactSums[1] = LookupEntityClasses(compact.Root());
+		compactTime[2] = std::min(compactTime[2], milliseconds(start));
+	}
+
+	const char* passes[3] = {"generateText", "Full walk", "Entity class lookups"};
+	for(int i = 0; i < 3; i++)
+		std::cout << passes[i] << ": EntNode " << entTime[i] << "ms, CompactTree " << compactTime[i] << "ms\n";
+
+	if(entText != compactText || entSums[0] != compactSums[0] || entSums[1] != compactSums[1])
+		std::cout << "MISMATCH between the two layouts\n";
+}
+
+/*
+* Replays an editing session on a real .entities file: pastes of copied entities,
+* deletions and renames, in the proportions of heavy use of the editor. Reports
+* the time taken and the state of the parser's allocators afterwards
+*/
+void Test_EditTreeStress(const fspath entitiesfile, int edits = 20000)
+{
+	EntityParser parser(entitiesfile.string(), ParsingMode::PERMISSIVE, false);
+	EntNode& root = *parser.getRoot();
+	uint32_t seed = 12345;
+	auto random = [&seed](uint32_t range) {
+		seed = seed * 1664525 + 1013904223;
+		return range == 0 ? 0 : (seed >> 8) % range;
+	};
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < edits; i++) {
+		int childCount = root.getChildCount();
+		uint32_t op = random(10);
+
+		if (op < 4 || childCount < 2) { // Paste copies of 1 - 8 entities
+			std::string pasted;
+			for (uint32_t k = 0, count = 1 + random(8); k < count && childCount > 0; k++) {
+				root[random(childCount)].generateText(pasted);
+				pasted.push_back('\n');
+			}
+			parser.EditTree(pasted, &root, random(childCount + 1), 0, false, false);
+		}
+		else if (op < 8) { // Delete 1 - 8 entities
+			int index = random(childCount);
+			int count = 1 + random(8);
+			parser.EditTree("", &root, index, count < childCount - index ? count : childCount - index, false, false);
+		}
+		else { // Rename a node inside an entity
+			EntNode& entity = root[random(childCount)];
+			if(entity.getChildCount() == 0)
+				continue;
+			EntNode& node = entity[random(entity.getChildCount())];
+			std::string text(node.getName());
+			text.append("_renamed");
+			text.append(node.getValue());
+			parser.EditText(text, &node, node.NameLength() + 8, false);
+		}
+	}
+	std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+	std::cout << edits << " edits: " << duration.count() << "ms\n";
+	parser.logAllocatorInfo(false, true, false);
+}
+
+void Test_GenerateTextBenchmark(const fspath entitiesfile)
+{
+	EntityParser parser(entitiesfile.string(), ParsingMode::PERMISSIVE, false);
+	const EntNode& root = *parser.getRoot();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::string serial;
+	root.generateText(serial);
+	std::chrono::duration<double, std::milli> serialDuration = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	std::string parallel;
+	root.generateTextParallel(parallel);
+	std::chrono::duration<double, std::milli> parallelDuration = std::chrono::steady_clock::now() - start;
+
+	std::cout << "Serial: " << serialDuration.count() << "ms\n";
+	std::cout << "Parallel: " << parallelDuration.count() << "ms\n";
+	std::cout << "Text Matches: " << (serial == parallel) << "\n";
+}
+
+void Test_SearchIndexBenchmark(const fspath entitiesfile, const std::string key)
+{
+	EntityParser parser(entitiesfile.string(), ParsingMode::PERMISSIVE, false);
+	EntNode* root = parser.getRoot();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EntNode* fullResult = parser.Search(key, root, false, false, false);
+	std::chrono::duration<double, std::milli> fullDuration = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	parser.BuildSearchIndex();
+	std::chrono::duration<double, std::milli> buildDuration = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	EntNode* indexedResult = parser.Search(key, root, false, false, false);
+	std::chrono::duration<double, std::milli> indexedDuration = std::chrono::steady_clock::now() - start;
+
+	std::cout << "Index Build: " << buildDuration.count() << "ms\n";
+	std::cout << "Full Search: " << fullDuration.count() << "ms\n";
+	std::cout << "Indexed Search: " << indexedDuration.count() << "ms\n";
+	std::cout << "Results Match: " << (fullResult == indexedResult) << "\n";
+}
+
 int main(int argc, char* argv[]) {
 	//#define DOOMETERNAL
 
@@ -906,12 +1095,20 @@ int main(int argc, char* argv[]) {
 
 	fspath testgamedir = "../input/darkages/injectortest";
 
+	if (argc == 3 && std::string_view(argv[1]) == "--compactbench") {
+		Test_CompactTreeBenchmark(argv[2]);
+		return 0;
+	}
+
 
 	//uint64_t hash = HashLib::ResourceMurmurHash("idPlayer");
 	//std::cout << hash;
 
 	//eventmaphash();
 	Test_AuditAllArchives(gamedir);
+	//Test_SearchIndexBenchmark("../input/darkages/mapentities/maps@game@sp@m6_hell@m6_hell.entities", "idTarget_Relay");
+	//Test_GenerateTextBenchmark("../input/darkages/mapentities/maps@game@sp@m6_hell@m6_hell.entities");
+	//Test_EditTreeStress("../input/darkages/mapentities/maps@game@sp@m6_hell@m6_hell.entities");
 
 
 	//std::cout << sizeof(ResourceMetaHeader);